@@ -3,11 +3,13 @@
 #include <cstdlib>
 #include <ctime>
 #include <chrono>
+#include <optional>
 
 #include "villainy/villainy.hpp"
 #include "villainy/render.hpp"
 #include "villainy/shader.hpp"
 #include "villainy/buffer.hpp"
+#include "villainy/startupScheduler.hpp"
 
 // demo application
 int main(){
@@ -18,13 +20,14 @@ int main(){
     }
 
     try{
+        vlny::StartupScheduler startup;
         vlny::ContextConfig cfg;
         vlny::WindowConfig winCfg;
         cfg.enableValidationLayers = true;
         cfg.minLogSeverity = vlny::LogSeverity::VERBOSE;
         winCfg.preferredSwapchainImagePresentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
         vlny::Context context(cfg);
-        vlny::Window window(winCfg, &context);
+        std::optional<vlny::Window> window;
 
         {
             struct DummyUbo {
@@ -49,37 +52,51 @@ int main(){
                 {0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT}
             };
 
-            vlny::ShaderProgram shaderProgram(context, shaderInfos, shaderLayout);
-            vlny::GraphicsPipelineConfig pipelineCfg;
-            pipelineCfg.cullMode = VK_CULL_MODE_NONE;
-            vlny::GraphicsPipeline pipeline(pipelineCfg, context, window.getSwapchain(), shaderProgram);
-
-            vlny::VertexBuffer<vlny::ColorVertex> vertexBuffer(context, vertices);
-            vlny::IndexBuffer indexBuffer(context, indices);
-
-            VkDescriptorPoolSize poolSize{};
-            poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-            poolSize.descriptorCount = static_cast<uint32_t>(window.getConfig().maxFramesInFlight);
-
-            vlny::UniformBuffer uniformBuffer(context, window.getConfig(), sizeof(DummyUbo), {poolSize});
-            uniformBuffer.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT);
-            uniformBuffer.createDescriptorSetLayout();
-            uniformBuffer.allocateDescriptorSets();
-            uniformBuffer.updateDescriptorSets();
-
-            DummyUbo dummy{};
-            for(uint32_t i = 0; i < static_cast<uint32_t>(window.getConfig().maxFramesInFlight); ++i){
-                uniformBuffer.updateBuffer(i, &dummy);
-            }
+            // the window (and with it the device) and anything touching the queues stay on the main thread,
+            // shader modules and the pipeline build on workers meanwhile
+            std::optional<vlny::ShaderProgram> shaderProgram;
+            std::optional<vlny::GraphicsPipeline> pipeline;
+            std::optional<vlny::VertexBuffer<vlny::ColorVertex>> vertexBuffer;
+            std::optional<vlny::IndexBuffer> indexBuffer;
+            std::optional<vlny::UniformBuffer> uniformBuffer;
+
+            auto windowTask = startup.addMainThreadTask("window + device", [&](){
+                window.emplace(winCfg, &context);
+            });
+            auto shaderTask = startup.addTask("shader program", [&](){
+                shaderProgram.emplace(context, shaderInfos, shaderLayout);
+            }, {windowTask});
+            startup.addTask("pipeline", [&](){
+                vlny::GraphicsPipelineConfig pipelineCfg;
+                pipelineCfg.cullMode = VK_CULL_MODE_NONE;
+                pipeline.emplace(pipelineCfg, context, window->getSwapchain(), *shaderProgram);
+            }, {shaderTask});
+            startup.addMainThreadTask("buffers", [&](){
+                vertexBuffer.emplace(context, window->getConfig(), vlny::BufferUsage::DYNAMIC, vertices);
+                indexBuffer.emplace(context, std::move(indices));
+
+                uniformBuffer.emplace(context, window->getConfig(), sizeof(DummyUbo));
+                uniformBuffer->addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT);
+                uniformBuffer->createDescriptorSetLayout();
+                uniformBuffer->allocateDescriptorSets();
+                uniformBuffer->updateDescriptorSets();
+
+                DummyUbo dummy{};
+                for(uint32_t i = 0; i < static_cast<uint32_t>(window->getConfig().maxFramesInFlight); ++i){
+                    uniformBuffer->updateBuffer(i, &dummy);
+                }
+            }, {windowTask});
+            startup.run();
 
-            vlny::Renderer renderer(context, window, window.getSwapchain());
-            vlny::RenderObject renderObject{vertexBuffer, indexBuffer, uniformBuffer};
+            vlny::Renderer renderer(context, *window, window->getSwapchain());
+            vlny::RenderObject renderObject{*vertexBuffer, *indexBuffer, *uniformBuffer};
             renderer.addRenderObject(renderObject);
         
             int frames = 0;
+            bool startedUp = false;
             auto startTime = std::chrono::high_resolution_clock::now();
             auto motionStart = std::chrono::high_resolution_clock::now();
-            while(window.windowOpen()){
+            while(window->windowOpen()){
                 glfwPollEvents();
                 
                 auto now = std::chrono::high_resolution_clock::now();
@@ -96,10 +113,19 @@ int main(){
                         baseVertices[i].pos[1] +
                         std::cos(t + phase) * maxOffset;
                 }
-                vertexBuffer.updateBuffer(vertices.data(), vertices.size() * sizeof(vlny::ColorVertex));
+                vertexBuffer->updateBuffer(vertices.data(), vertices.size() * sizeof(vlny::ColorVertex));
                 
                 // draw frame
-                renderer.drawFrame(pipeline);
+                renderer.drawFrame(*pipeline);
+                if(!startedUp){
+                    startup.mark("first frame");
+                    context.logger.log(vlny::LogSeverity::INFO, "Startup took " + std::to_string(startup.elapsed()) + " ms.");
+                    // opt-in, e.g. VILLAINY_STARTUP_TRACE=startup.json, then load it into chrome://tracing
+                    if(const char* tracePath = std::getenv("VILLAINY_STARTUP_TRACE")){
+                        startup.writeTimeline(tracePath);
+                    }
+                    startedUp = true;
+                }
 
                 // fps logging
                 float elapsed = std::chrono::duration<float, std::chrono::seconds::period>(now - startTime).count();
@@ -115,7 +141,7 @@ int main(){
             context.waitIdle();
         }
 
-        vlny::cleanup(window, context);
+        vlny::cleanup(*window, context);
     }
     catch(const std::exception& e){
         std::cerr << "Error: " << e.what() << std::endl;
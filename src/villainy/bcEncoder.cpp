@@ -0,0 +1,330 @@
+#include "bcEncoder.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+namespace vlny{
+
+namespace{
+
+struct BitWriter{
+    uint8_t* out;
+    uint32_t pos = 0;
+
+    void write(uint32_t value, uint32_t bits){
+        for(uint32_t i = 0; i < bits; i++){
+            if((value >> i) & 1){
+                out[pos >> 3] |= static_cast<uint8_t>(1 << (pos & 7));
+            }
+            pos++;
+        }
+    }
+};
+
+// mean + principal axis of the block's texels (power iteration on the covariance matrix)
+void fitLine(const float (*px)[4], uint32_t channels, float* mean, float* axis){
+    for(uint32_t c = 0; c < channels; c++){
+        mean[c] = 0.0f;
+        for(int i = 0; i < 16; i++){ mean[c] += px[i][c]; }
+        mean[c] /= 16.0f;
+    }
+
+    float cov[4][4] = {};
+    for(int i = 0; i < 16; i++){
+        for(uint32_t a = 0; a < channels; a++){
+            for(uint32_t b = 0; b < channels; b++){
+                cov[a][b] += (px[i][a] - mean[a]) * (px[i][b] - mean[b]);
+            }
+        }
+    }
+
+    for(uint32_t c = 0; c < channels; c++){ axis[c] = 1.0f; }
+    for(int iter = 0; iter < 8; iter++){
+        float next[4] = {};
+        for(uint32_t a = 0; a < channels; a++){
+            for(uint32_t b = 0; b < channels; b++){
+                next[a] += cov[a][b] * axis[b];
+            }
+        }
+        float len = 0.0f;
+        for(uint32_t c = 0; c < channels; c++){ len += next[c] * next[c]; }
+        if(len < 1e-8f){ break; } // flat block, any axis works
+        len = std::sqrt(len);
+        for(uint32_t c = 0; c < channels; c++){ axis[c] = next[c] / len; }
+    }
+}
+
+// endpoints at the extremes of the texels projected onto the principal axis
+void fitEndpoints(const float (*px)[4], uint32_t channels, float* lo, float* hi){
+    float mean[4], axis[4];
+    fitLine(px, channels, mean, axis);
+
+    float minT = std::numeric_limits<float>::max();
+    float maxT = std::numeric_limits<float>::lowest();
+    for(int i = 0; i < 16; i++){
+        float t = 0.0f;
+        for(uint32_t c = 0; c < channels; c++){ t += (px[i][c] - mean[c]) * axis[c]; }
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+    for(uint32_t c = 0; c < channels; c++){
+        lo[c] = std::clamp(mean[c] + minT * axis[c], 0.0f, 255.0f);
+        hi[c] = std::clamp(mean[c] + maxT * axis[c], 0.0f, 255.0f);
+    }
+}
+
+uint16_t pack565(const float* c){
+    uint32_t r = static_cast<uint32_t>(c[0] * 31.0f / 255.0f + 0.5f);
+    uint32_t g = static_cast<uint32_t>(c[1] * 63.0f / 255.0f + 0.5f);
+    uint32_t b = static_cast<uint32_t>(c[2] * 31.0f / 255.0f + 0.5f);
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+void unpack565(uint16_t v, float* c){
+    uint32_t r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+    c[0] = static_cast<float>((r << 3) | (r >> 2));
+    c[1] = static_cast<float>((g << 2) | (g >> 4));
+    c[2] = static_cast<float>((b << 3) | (b >> 2));
+}
+
+template<typename T>
+void writeLE(uint8_t* out, T value){
+    for(size_t i = 0; i < sizeof(T); i++){
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+void loadBlock(const uint8_t* block, float (*px)[4]){
+    for(int i = 0; i < 16; i++){
+        for(int c = 0; c < 4; c++){ px[i][c] = block[4 * i + c]; }
+    }
+}
+
+const uint32_t bc7Weights4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+}
+
+size_t bcBlockBytes(BCFormat format){
+    return (format == BCFormat::BC1 || format == BCFormat::BC4) ? 8 : 16;
+}
+
+size_t bcImageSize(BCFormat format, uint32_t width, uint32_t height){
+    size_t blocksX = (std::max(1u, width) + 3) / 4;
+    size_t blocksY = (std::max(1u, height) + 3) / 4;
+    return blocksX * blocksY * bcBlockBytes(format);
+}
+
+void encodeBlockBC1(const uint8_t* block, uint8_t* out){
+    float px[16][4];
+    loadBlock(block, px);
+
+    float lo[4], hi[4];
+    fitEndpoints(px, 3, lo, hi);
+
+    uint16_t c0 = pack565(hi);
+    uint16_t c1 = pack565(lo);
+    if(c0 < c1){ std::swap(c0, c1); } // c0 > c1 selects the opaque 4 color mode
+
+    uint32_t indices = 0;
+    if(c0 != c1){
+        float palette[4][3];
+        unpack565(c0, palette[0]);
+        unpack565(c1, palette[1]);
+        for(int c = 0; c < 3; c++){
+            palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+            palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+        }
+
+        for(int i = 0; i < 16; i++){
+            uint32_t best = 0;
+            float bestErr = std::numeric_limits<float>::max();
+            for(uint32_t p = 0; p < 4; p++){
+                float err = 0.0f;
+                for(int c = 0; c < 3; c++){
+                    float d = px[i][c] - palette[p][c];
+                    err += d * d;
+                }
+                if(err < bestErr){ bestErr = err; best = p; }
+            }
+            indices |= best << (2 * i);
+        }
+    }
+
+    writeLE<uint16_t>(out, c0);
+    writeLE<uint16_t>(out + 2, c1);
+    writeLE<uint32_t>(out + 4, indices);
+}
+
+void encodeBlockBC4(const uint8_t* block, uint8_t* out, uint32_t channel){
+    uint8_t mn = 255, mx = 0;
+    for(int i = 0; i < 16; i++){
+        mn = std::min(mn, block[4 * i + channel]);
+        mx = std::max(mx, block[4 * i + channel]);
+    }
+
+    std::memset(out, 0, 8);
+    out[0] = mx;
+    out[1] = mn;
+    if(mx == mn){ return; } // every index 0 -> a0
+
+    // a0 > a1 selects the 8 value mode: a0, a1, then 6 interpolated steps
+    float palette[8];
+    palette[0] = mx;
+    palette[1] = mn;
+    for(int k = 1; k < 7; k++){
+        palette[k + 1] = ((7 - k) * mx + k * mn) / 7.0f;
+    }
+
+    uint64_t bits = 0;
+    for(int i = 0; i < 16; i++){
+        float v = block[4 * i + channel];
+        uint64_t best = 0;
+        float bestErr = std::numeric_limits<float>::max();
+        for(uint64_t p = 0; p < 8; p++){
+            float err = std::abs(v - palette[p]);
+            if(err < bestErr){ bestErr = err; best = p; }
+        }
+        bits |= best << (3 * i);
+    }
+    for(int i = 0; i < 6; i++){
+        out[2 + i] = static_cast<uint8_t>(bits >> (8 * i));
+    }
+}
+
+void encodeBlockBC3(const uint8_t* block, uint8_t* out){
+    encodeBlockBC4(block, out, 3);
+    encodeBlockBC1(block, out + 8);
+}
+
+void encodeBlockBC5(const uint8_t* block, uint8_t* out){
+    encodeBlockBC4(block, out, 0);
+    encodeBlockBC4(block, out + 8, 1);
+}
+
+// mode 6 only: one subset, rgba 7777 endpoints with a p-bit each, 4 bit indices
+void encodeBlockBC7(const uint8_t* block, uint8_t* out){
+    float px[16][4];
+    loadBlock(block, px);
+
+    float ends[2][4];
+    fitEndpoints(px, 4, ends[0], ends[1]);
+
+    // quantize each endpoint to 7 bits + shared p-bit, keeping whichever p-bit is closer
+    uint32_t q[2][4], pbit[2];
+    for(int e = 0; e < 2; e++){
+        float bestErr = std::numeric_limits<float>::max();
+        for(uint32_t p = 0; p < 2; p++){
+            uint32_t cand[4];
+            float err = 0.0f;
+            for(int c = 0; c < 4; c++){
+                float v = std::round((ends[e][c] - p) / 2.0f);
+                cand[c] = static_cast<uint32_t>(std::clamp(v, 0.0f, 127.0f));
+                float d = static_cast<float>((cand[c] << 1) | p) - ends[e][c];
+                err += d * d;
+            }
+            if(err < bestErr){
+                bestErr = err;
+                pbit[e] = p;
+                std::copy(cand, cand + 4, q[e]);
+            }
+        }
+    }
+
+    float palette[16][4];
+    for(int c = 0; c < 4; c++){
+        uint32_t d0 = (q[0][c] << 1) | pbit[0];
+        uint32_t d1 = (q[1][c] << 1) | pbit[1];
+        for(int w = 0; w < 16; w++){
+            palette[w][c] = static_cast<float>(((64 - bc7Weights4[w]) * d0 + bc7Weights4[w] * d1 + 32) >> 6);
+        }
+    }
+
+    uint32_t indices[16];
+    for(int i = 0; i < 16; i++){
+        float bestErr = std::numeric_limits<float>::max();
+        for(uint32_t w = 0; w < 16; w++){
+            float err = 0.0f;
+            for(int c = 0; c < 4; c++){
+                float d = px[i][c] - palette[w][c];
+                err += d * d;
+            }
+            if(err < bestErr){ bestErr = err; indices[i] = w; }
+        }
+    }
+
+    // the anchor index only stores 3 bits, so its msb has to be 0
+    if(indices[0] & 8){
+        std::swap(q[0], q[1]);
+        std::swap(pbit[0], pbit[1]);
+        for(int i = 0; i < 16; i++){ indices[i] = 15 - indices[i]; }
+    }
+
+    std::memset(out, 0, 16);
+    BitWriter writer{out};
+    writer.write(1 << 6, 7); // mode 6
+    for(int c = 0; c < 4; c++){
+        writer.write(q[0][c], 7);
+        writer.write(q[1][c], 7);
+    }
+    writer.write(pbit[0], 1);
+    writer.write(pbit[1], 1);
+    writer.write(indices[0], 3);
+    for(int i = 1; i < 16; i++){
+        writer.write(indices[i], 4);
+    }
+}
+
+std::vector<uint8_t> compressImageBC(const uint8_t* rgba, uint32_t width, uint32_t height, BCFormat format, uint32_t threadCount){
+    uint32_t blocksX = (width + 3) / 4;
+    uint32_t blocksY = (height + 3) / 4;
+    size_t blockBytes = bcBlockBytes(format);
+    std::vector<uint8_t> out(static_cast<size_t>(blocksX) * blocksY * blockBytes);
+
+    std::atomic<uint32_t> nextRow{0};
+    auto worker = [&](){
+        uint8_t block[64];
+        for(uint32_t by = nextRow++; by < blocksY; by = nextRow++){
+            for(uint32_t bx = 0; bx < blocksX; bx++){
+                // gather the 4x4 block, clamping at the right/bottom edges
+                for(uint32_t y = 0; y < 4; y++){
+                    uint32_t sy = std::min(by * 4 + y, height - 1);
+                    for(uint32_t x = 0; x < 4; x++){
+                        uint32_t sx = std::min(bx * 4 + x, width - 1);
+                        std::memcpy(block + 4 * (4 * y + x), rgba + (static_cast<size_t>(sy) * width + sx) * 4, 4);
+                    }
+                }
+
+                uint8_t* dst = out.data() + (static_cast<size_t>(by) * blocksX + bx) * blockBytes;
+                switch(format){
+                    case BCFormat::BC1: encodeBlockBC1(block, dst); break;
+                    case BCFormat::BC3: encodeBlockBC3(block, dst); break;
+                    case BCFormat::BC4: encodeBlockBC4(block, dst); break;
+                    case BCFormat::BC5: encodeBlockBC5(block, dst); break;
+                    case BCFormat::BC7: encodeBlockBC7(block, dst); break;
+                }
+            }
+        }
+    };
+
+    if(threadCount == 0){
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threadCount = std::min(threadCount, blocksY);
+
+    std::vector<std::thread> threads;
+    for(uint32_t i = 1; i < threadCount; i++){
+        threads.emplace_back(worker);
+    }
+    worker();
+    for(auto& t : threads){
+        t.join();
+    }
+
+    return out;
+}
+
+}
@@ -0,0 +1,33 @@
+#ifndef VILLAINY_BC_ENCODER
+#define VILLAINY_BC_ENCODER
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace vlny{
+
+enum class BCFormat{
+    BC1, // rgb, 4 bpp
+    BC3, // rgba (bc1 color + bc4 alpha), 8 bpp
+    BC4, // r, 4 bpp
+    BC5, // rg (two bc4 channels), 8 bpp, good for normal maps
+    BC7  // rgba, 8 bpp, highest quality
+};
+
+size_t bcBlockBytes(BCFormat format);
+size_t bcImageSize(BCFormat format, uint32_t width, uint32_t height);
+
+// single 4x4 block encoders, `block` is 16 rgba8 texels in row-major order
+void encodeBlockBC1(const uint8_t* block, uint8_t* out);
+void encodeBlockBC3(const uint8_t* block, uint8_t* out);
+void encodeBlockBC4(const uint8_t* block, uint8_t* out, uint32_t channel = 0);
+void encodeBlockBC5(const uint8_t* block, uint8_t* out);
+void encodeBlockBC7(const uint8_t* block, uint8_t* out);
+
+// compresses a whole rgba8 image, block rows are spread over `threadCount` threads (0 = hardware concurrency)
+std::vector<uint8_t> compressImageBC(const uint8_t* rgba, uint32_t width, uint32_t height, BCFormat format, uint32_t threadCount = 0);
+
+}
+
+#endif
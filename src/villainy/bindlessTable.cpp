@@ -0,0 +1,238 @@
+#include "bindlessTable.hpp"
+
+#include "context.hpp"
+#include "texture.hpp"
+
+#include <algorithm>
+
+namespace vlny{
+
+BindlessTable::BindlessTable(Context& context, Window& window, BindlessTableConfig config) :
+    context(context), config(config), maxFramesInFlight(window.getConfig().maxFramesInFlight) {
+    if(!context.descriptorIndexingEnabled){
+        throw std::runtime_error("BindlessTable needs ContextConfig::descriptorIndexing!");
+    }
+    this->config.maxTextures = std::max(1u, std::min(config.maxTextures, context.maxBindlessSampledImages));
+    this->config.maxStorageBuffers = std::max(1u, std::min(config.maxStorageBuffers, context.maxBindlessStorageBuffers));
+
+    createLayout();
+    createPool();
+    allocateSets();
+}
+
+BindlessTable::~BindlessTable(){
+    if(pool != VK_NULL_HANDLE){
+        vkDestroyDescriptorPool(context.logicalDevice, pool, nullptr);
+    }
+}
+
+void BindlessTable::createLayout(){
+    std::vector<VkDescriptorSetLayoutBinding> bindings(2);
+    bindings[0].binding = textureBinding;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[0].descriptorCount = config.maxTextures;
+    bindings[0].stageFlags = config.stageFlags;
+    bindings[1].binding = storageBufferBinding;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[1].descriptorCount = config.maxStorageBuffers;
+    bindings[1].stageFlags = config.stageFlags;
+
+    // unused slots never have to be valid, written slots may change after the set was bound
+    std::vector<VkDescriptorBindingFlagsEXT> bindingFlags(2,
+        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT);
+
+    layout = context.getDescriptorLayoutCache().get(bindings, VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT, bindingFlags);
+}
+
+void BindlessTable::createPool(){
+    VkDescriptorPoolSize poolSizes[2]{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[0].descriptorCount = config.maxTextures * maxFramesInFlight;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[1].descriptorCount = config.maxStorageBuffers * maxFramesInFlight;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+    poolInfo.maxSets = maxFramesInFlight;
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes = poolSizes;
+
+    if(vkCreateDescriptorPool(context.logicalDevice, &poolInfo, nullptr, &pool) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create bindless descriptor pool!");
+    }
+}
+
+void BindlessTable::allocateSets(){
+    std::vector<VkDescriptorSetLayout> layouts(maxFramesInFlight, layout);
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = pool;
+    allocInfo.descriptorSetCount = maxFramesInFlight;
+    allocInfo.pSetLayouts = layouts.data();
+
+    descriptorSets.resize(maxFramesInFlight);
+    if(vkAllocateDescriptorSets(context.logicalDevice, &allocInfo, descriptorSets.data()) != VK_SUCCESS){
+        throw std::runtime_error("Failed to allocate bindless descriptor sets!");
+    }
+}
+
+uint32_t BindlessTable::addTexture(std::shared_ptr<Texture> texture, std::shared_ptr<Sampler> sampler){
+    uint32_t index;
+    if(!freeTextures.empty()){
+        index = freeTextures.back();
+        freeTextures.pop_back();
+    }
+    else{
+        if(textures.size() >= config.maxTextures){
+            throw std::runtime_error("Bindless texture table is full!");
+        }
+        index = scast_ui32(textures.size());
+        textures.emplace_back();
+    }
+    updateTexture(index, std::move(texture), std::move(sampler));
+    return index;
+}
+
+void BindlessTable::updateTexture(uint32_t index, std::shared_ptr<Texture> texture, std::shared_ptr<Sampler> sampler){
+    if(index >= textures.size() || textures[index].removed){
+        throw std::runtime_error("Invalid bindless texture index!");
+    }
+    TextureSlot& slot = textures[index];
+    if(slot.texture){
+        // frames in flight may still sample the old pair through their copy of the set
+        retiredTextures.push_back({std::move(slot.texture), std::move(slot.sampler), frameCounter + maxFramesInFlight});
+    }
+    slot.texture = std::move(texture);
+    slot.sampler = std::move(sampler);
+    slot.writtenGeneration.assign(maxFramesInFlight, unwritten);
+}
+
+void BindlessTable::removeTexture(uint32_t index){
+    if(index >= textures.size() || textures[index].removed || !textures[index].texture){
+        throw std::runtime_error("Invalid bindless texture index!");
+    }
+    textures[index].removed = true;
+    textures[index].retireFrame = frameCounter + maxFramesInFlight;
+    retiringTextures.push_back(index);
+}
+
+uint32_t BindlessTable::addStorageBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range){
+    uint32_t index;
+    if(!freeBuffers.empty()){
+        index = freeBuffers.back();
+        freeBuffers.pop_back();
+    }
+    else{
+        if(buffers.size() >= config.maxStorageBuffers){
+            throw std::runtime_error("Bindless storage buffer table is full!");
+        }
+        index = scast_ui32(buffers.size());
+        buffers.emplace_back();
+    }
+    BufferSlot& slot = buffers[index];
+    slot.buffer = buffer;
+    slot.offset = offset;
+    slot.range = range;
+    slot.written.assign(maxFramesInFlight, false);
+    return index;
+}
+
+void BindlessTable::removeStorageBuffer(uint32_t index){
+    if(index >= buffers.size() || buffers[index].removed || buffers[index].buffer == VK_NULL_HANDLE){
+        throw std::runtime_error("Invalid bindless storage buffer index!");
+    }
+    buffers[index].removed = true;
+    buffers[index].retireFrame = frameCounter + maxFramesInFlight;
+    retiringBuffers.push_back(index);
+}
+
+void BindlessTable::recycleSlots(){
+    auto retire = [this](std::vector<uint32_t>& retiring, auto& slots, std::vector<uint32_t>& freeList){
+        retiring.erase(std::remove_if(retiring.begin(), retiring.end(), [&](uint32_t index){
+            if(slots[index].retireFrame > frameCounter){
+                return false;
+            }
+            slots[index] = {};
+            freeList.push_back(index);
+            return true;
+        }), retiring.end());
+    };
+    retire(retiringTextures, textures, freeTextures);
+    retire(retiringBuffers, buffers, freeBuffers);
+
+    retiredTextures.erase(std::remove_if(retiredTextures.begin(), retiredTextures.end(), [this](const RetiredTexture& retired){
+        return retired.retireFrame <= frameCounter;
+    }), retiredTextures.end());
+}
+
+void BindlessTable::prepareFrame(uint32_t frame){
+    frameCounter++;
+    recycleSlots();
+
+    std::vector<VkWriteDescriptorSet> writes;
+    std::vector<VkDescriptorImageInfo> imageInfos;
+    std::vector<VkDescriptorBufferInfo> bufferInfos;
+    imageInfos.reserve(textures.size());
+    bufferInfos.reserve(buffers.size());
+
+    // a plain scan, generations change behind our back when streamed textures become resident
+    for(uint32_t i = 0; i < textures.size(); i++){
+        TextureSlot& slot = textures[i];
+        if(!slot.texture || slot.removed){
+            continue;
+        }
+        uint32_t generation = slot.texture->getGeneration();
+        if(slot.writtenGeneration[frame] == generation){
+            continue;
+        }
+        slot.writtenGeneration[frame] = generation;
+
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        imageInfo.imageView = slot.texture->imageView;
+        imageInfo.sampler = slot.sampler->vkSampler;
+        imageInfos.push_back(imageInfo);
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = descriptorSets[frame];
+        write.dstBinding = textureBinding;
+        write.dstArrayElement = i;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        write.descriptorCount = 1;
+        write.pImageInfo = &imageInfos.back();
+        writes.push_back(write);
+    }
+
+    for(uint32_t i = 0; i < buffers.size(); i++){
+        BufferSlot& slot = buffers[i];
+        if(slot.buffer == VK_NULL_HANDLE || slot.removed || slot.written[frame]){
+            continue;
+        }
+        slot.written[frame] = true;
+
+        VkDescriptorBufferInfo bufferInfo{};
+        bufferInfo.buffer = slot.buffer;
+        bufferInfo.offset = slot.offset;
+        bufferInfo.range = slot.range;
+        bufferInfos.push_back(bufferInfo);
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = descriptorSets[frame];
+        write.dstBinding = storageBufferBinding;
+        write.dstArrayElement = i;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        write.descriptorCount = 1;
+        write.pBufferInfo = &bufferInfos.back();
+        writes.push_back(write);
+    }
+
+    if(!writes.empty()){
+        vkUpdateDescriptorSets(context.logicalDevice, scast_ui32(writes.size()), writes.data(), 0, nullptr);
+    }
+}
+
+}
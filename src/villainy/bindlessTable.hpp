@@ -0,0 +1,113 @@
+#ifndef VILLAINY_BINDLESS_TABLE
+#define VILLAINY_BINDLESS_TABLE
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "command.hpp"
+#include "window.hpp"
+
+namespace vlny{
+
+class Context;
+class Sampler;
+class Texture;
+
+struct BindlessTableConfig{
+    uint32_t maxTextures = 16384; // clamped to the device's update-after-bind limits
+    uint32_t maxStorageBuffers = 4096;
+    VkShaderStageFlags stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS;
+};
+
+// one big descriptor set every draw shares, resources are addressed by index from the shader:
+//   layout(set = 1, binding = 0) uniform sampler2D textures[];
+//   layout(set = 1, binding = 1) buffer Buffers { ... } buffers[];
+//   texture(textures[nonuniformEXT(index)], uv)
+// the index usually travels in a push constant or a per-object storage buffer
+//
+// needs ContextConfig::descriptorIndexing, arrays are partially bound and update-after-bind so slots can change
+// while the set stays bound. Every frame in flight gets its own copy of the set, changes reach each copy in
+// prepareFrame() once that frame's fence was waited on, register the table with Renderer::addFrameResource
+class BindlessTable : public FrameResource{
+public:
+    static constexpr uint32_t textureBinding = 0;
+    static constexpr uint32_t storageBufferBinding = 1;
+    static constexpr uint32_t invalidIndex = UINT32_MAX;
+
+    BindlessTable(Context& context, Window& window, BindlessTableConfig config = {});
+    ~BindlessTable();
+
+    BindlessTable(const BindlessTable&) = delete;
+    BindlessTable& operator=(const BindlessTable&) = delete;
+
+    // returns the array index the shader samples with, streamed textures are picked up when they become resident
+    uint32_t addTexture(std::shared_ptr<Texture> texture, std::shared_ptr<Sampler> sampler);
+    // the previous texture and sampler are kept alive until no frame in flight can still read them
+    void updateTexture(uint32_t index, std::shared_ptr<Texture> texture, std::shared_ptr<Sampler> sampler);
+    // the slot (and the texture) stay alive until no frame in flight can still read it
+    void removeTexture(uint32_t index);
+
+    uint32_t addStorageBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+    void removeStorageBuffer(uint32_t index);
+
+    void prepareFrame(uint32_t frame) override;
+
+    VkDescriptorSetLayout getLayout() const { return layout; }
+    VkDescriptorSet getDescriptorSet(uint32_t frame) const { return descriptorSets[frame]; }
+    uint32_t getTextureCapacity() const { return config.maxTextures; }
+    uint32_t getStorageBufferCapacity() const { return config.maxStorageBuffers; }
+private:
+    Context& context;
+    BindlessTableConfig config;
+    uint32_t maxFramesInFlight;
+    uint64_t frameCounter = 0;
+
+    VkDescriptorSetLayout layout = VK_NULL_HANDLE; // owned by the context's DescriptorLayoutCache
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSet> descriptorSets;
+
+    static constexpr uint32_t unwritten = UINT32_MAX;
+
+    struct TextureSlot{
+        std::shared_ptr<Texture> texture;
+        std::shared_ptr<Sampler> sampler;
+        std::vector<uint32_t> writtenGeneration; // per frame, `unwritten` = needs a write
+        uint64_t retireFrame = 0; // slot is free again once frameCounter reaches this
+        bool removed = false;
+    };
+    struct BufferSlot{
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize range = 0;
+        std::vector<bool> written;
+        uint64_t retireFrame = 0;
+        bool removed = false;
+    };
+    std::vector<TextureSlot> textures;
+    std::vector<BufferSlot> buffers;
+    std::vector<uint32_t> freeTextures;
+    std::vector<uint32_t> freeBuffers;
+    std::vector<uint32_t> retiringTextures;
+    std::vector<uint32_t> retiringBuffers;
+
+    // replaced by updateTexture, dropped once frameCounter reaches retireFrame
+    struct RetiredTexture{
+        std::shared_ptr<Texture> texture;
+        std::shared_ptr<Sampler> sampler;
+        uint64_t retireFrame;
+    };
+    std::vector<RetiredTexture> retiredTextures;
+
+    void createLayout();
+    void createPool();
+    void allocateSets();
+    void recycleSlots();
+};
+
+}
+
+#endif
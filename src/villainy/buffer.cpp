@@ -7,28 +7,111 @@
 #include "logger.hpp"
 #include "command.hpp"
 
+#include <algorithm>
+
 namespace vlny{
 
-IndexBuffer::IndexBuffer(Context& context, std::vector<uint16_t> indices) : context(context), indices(indices){
-    bufferSize = sizeof(indices[0]) * indices.size();
+namespace{
 
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    createBuffer(context, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+template <typename T>
+VkIndexType sourceIndexType(){
+    if(sizeof(T) == 1){
+        return VK_INDEX_TYPE_UINT8_EXT;
+    }
+    return sizeof(T) == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+}
 
-    void* data;
-    vkMapMemory(context.logicalDevice, stagingBufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, indices.data(), (size_t) bufferSize);
-    vkUnmapMemory(context.logicalDevice, stagingBufferMemory);
-    
+uint32_t indexTypeSize(VkIndexType type){
+    if(type == VK_INDEX_TYPE_UINT8_EXT){
+        return 1;
+    }
+    return type == VK_INDEX_TYPE_UINT16 ? 2 : 4;
+}
+
+template <typename Dst, typename Src>
+std::vector<uint8_t> convertIndices(ArrayView<Src> indices){
+    std::vector<uint8_t> converted(indices.size() * sizeof(Dst));
+    Dst* dst = reinterpret_cast<Dst*>(converted.data());
+    for(size_t i = 0; i < indices.size(); i++){
+        dst[i] = static_cast<Dst>(indices[i]);
+    }
+    return converted;
+}
+
+}
+
+template <typename T>
+void IndexBuffer::upload(ArrayView<T> indices, bool keepCpuCopy){
+    indexCount = scast_ui32(indices.size());
+
+    uint32_t maxIndex = 0;
+    for(T index : indices){
+        maxIndex = std::max<uint32_t>(maxIndex, index);
+    }
+
+    indexType = sourceIndexType<T>();
+    if(indexType == VK_INDEX_TYPE_UINT8_EXT && !context.supportsUint8Indices()){
+        indexType = VK_INDEX_TYPE_UINT16;
+        if(maxIndex == 0xFF){
+            VILLAINY_VERBOSE_LOG(context.logger, "8 bit indices widened to 16 bit, 0xFF no longer restarts primitives.");
+        }
+    }
+    // a type's all-ones value is its restart index, narrower types only when every index stays below theirs
+    if(indexType == VK_INDEX_TYPE_UINT32 && maxIndex < 0xFFFF){
+        indexType = VK_INDEX_TYPE_UINT16;
+    }
+    if(indexType == VK_INDEX_TYPE_UINT16 && maxIndex < 0xFF && context.supportsUint8Indices()){
+        indexType = VK_INDEX_TYPE_UINT8_EXT;
+    }
+
+    uint32_t stride = indexTypeSize(indexType);
+    bufferSize = static_cast<VkDeviceSize>(stride) * std::max<size_t>(indices.size(), 1);
     createBuffer(context, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, 
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferMemory);
-    
-    copyBuffer(context, stagingBuffer, indexBuffer, bufferSize);
-    
-    vkDestroyBuffer(context.logicalDevice, stagingBuffer, nullptr);
-    vkFreeMemory(context.logicalDevice, stagingBufferMemory, nullptr);
+
+    if(!indices.empty()){
+        if(indexType == sourceIndexType<T>()){
+            uploadBuffer(context, indexBuffer, indices.data(), sizeof(T) * indices.size());
+        }
+        else{
+            // only ever narrowed, or 8 bit widened to 16
+            std::vector<uint8_t> converted = indexType == VK_INDEX_TYPE_UINT8_EXT ?
+                convertIndices<uint8_t>(indices) : convertIndices<uint16_t>(indices);
+            uploadBuffer(context, indexBuffer, converted.data(), converted.size());
+        }
+    }
+
+    if(keepCpuCopy){
+        std::get<std::vector<T>>(this->indices).assign(indices.begin(), indices.end());
+    }
+    VILLAINY_VERBOSE_LOG(context.logger, "Made index buffer (" + std::to_string(indexCount) + " indices, " +
+        std::to_string(stride * 8) + " bit).");
+}
+
+IndexBuffer::IndexBuffer(Context& context, ArrayView<uint32_t> indices, bool keepCpuCopy) : context(context){
+    upload(indices, keepCpuCopy);
+}
+
+IndexBuffer::IndexBuffer(Context& context, ArrayView<uint16_t> indices, bool keepCpuCopy) : context(context){
+    upload(indices, keepCpuCopy);
+}
+
+IndexBuffer::IndexBuffer(Context& context, ArrayView<uint8_t> indices, bool keepCpuCopy) : context(context){
+    upload(indices, keepCpuCopy);
+}
+
+IndexBuffer::IndexBuffer(Context& context, std::vector<uint32_t>&& indices, bool keepCpuCopy) :
+    IndexBuffer(context, ArrayView<uint32_t>(indices)){
+    if(keepCpuCopy){
+        std::get<std::vector<uint32_t>>(this->indices) = std::move(indices);
+    }
+}
+
+IndexBuffer::IndexBuffer(Context& context, std::vector<uint16_t>&& indices, bool keepCpuCopy) :
+    IndexBuffer(context, ArrayView<uint16_t>(indices)){
+    if(keepCpuCopy){
+        std::get<std::vector<uint16_t>>(this->indices) = std::move(indices);
+    }
 }
 
 IndexBuffer::~IndexBuffer(){
@@ -42,12 +125,10 @@ IndexBuffer::~IndexBuffer(){
     }
 }
 
-UniformBuffer::UniformBuffer(Context& context, WindowConfig windowconfig, size_t bufferSize, std::vector<VkDescriptorPoolSize> poolSizes)
+UniformBuffer::UniformBuffer(Context& context, WindowConfig windowconfig, size_t bufferSize)
     : context(context)
     , maxFramesInFlight(windowconfig.maxFramesInFlight)
     , bufferSize(bufferSize)
-    , poolSizes(std::move(poolSizes))
-    , descriptorPool(VK_NULL_HANDLE)
     , descriptorSetLayout(VK_NULL_HANDLE)
 {
     createUniformBuffers();
@@ -89,45 +170,12 @@ void UniformBuffer::addBinding(uint32_t binding, VkDescriptorType descriptorType
 }
 
 void UniformBuffer::createDescriptorSetLayout() {
-    VkDescriptorSetLayoutCreateInfo layoutInfo{};
-    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
-    layoutInfo.pBindings = bindings.data();
-
-    if (vkCreateDescriptorSetLayout(context.logicalDevice, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create descriptor set layout!");
-    }
-}
-
-void UniformBuffer::createDescriptorPool() {
-    VkDescriptorPoolCreateInfo poolInfo{};
-    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-    poolInfo.pPoolSizes = poolSizes.data();
-    poolInfo.maxSets = maxFramesInFlight;
-
-    if (vkCreateDescriptorPool(context.logicalDevice, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create descriptor pool!");
-    }
+    descriptorSetLayout = context.getDescriptorSetLayout(bindings);
 }
 
 void UniformBuffer::allocateDescriptorSets() {
-    if (descriptorPool == VK_NULL_HANDLE) {
-        createDescriptorPool();
-    }
-
-    std::vector<VkDescriptorSetLayout> layouts(maxFramesInFlight, descriptorSetLayout);
-    
-    VkDescriptorSetAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = descriptorPool;
-    allocInfo.descriptorSetCount = maxFramesInFlight;
-    allocInfo.pSetLayouts = layouts.data();
-
     descriptorSets.resize(maxFramesInFlight);
-    if (vkAllocateDescriptorSets(context.logicalDevice, &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to allocate descriptor sets!");
-    }
+    context.getDescriptorAllocator().allocate(descriptorSetLayout, maxFramesInFlight, descriptorSets.data());
 }
 
 void UniformBuffer::updateDescriptorSets() {
@@ -168,14 +216,10 @@ void UniformBuffer::cleanup() {
         }
     }
 
-    // Destroy descriptor pool (this also frees descriptor sets)
-    if (descriptorPool != VK_NULL_HANDLE) {
-        vkDestroyDescriptorPool(context.logicalDevice, descriptorPool, nullptr);
-    }
-
-    // Destroy descriptor set layout
-    if (descriptorSetLayout != VK_NULL_HANDLE) {
-        vkDestroyDescriptorSetLayout(context.logicalDevice, descriptorSetLayout, nullptr);
+    // Give the descriptor sets back, the layout belongs to the context's cache
+    // after vlny::cleanup the allocator's pools are gone and the sets went with them
+    if (!descriptorSets.empty() && context.descriptorAllocator.has_value()) {
+        context.getDescriptorAllocator().free(static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data());
     }
 }
 
@@ -184,18 +228,34 @@ void UniformBuffer::cleanup() {
 
 // ------------------------------------------------------------------------------------------------------------------------
 
-void copyBuffer(Context& context, VkBuffer srcBuf, VkBuffer dstBuf, VkDeviceSize size){
+void copyBuffer(Context& context, VkBuffer srcBuf, VkBuffer dstBuf, VkDeviceSize size, VkDeviceSize dstOffset){
     CommandBuffer cmdBuf(context, context.getTransientCommandPool());
     cmdBuf.beginSingletimeCommands();
 
     VkBufferCopy copyRegion{};
     copyRegion.srcOffset = 0;
-    copyRegion.dstOffset = 0;
+    copyRegion.dstOffset = dstOffset;
     copyRegion.size = size;
     vkCmdCopyBuffer(cmdBuf.vkCommandBuffer, srcBuf, dstBuf, 1, &copyRegion);
 
     cmdBuf.endSingletimeCommands();
 }
+void uploadBuffer(Context& context, VkBuffer dstBuf, const void* data, VkDeviceSize size, VkDeviceSize dstOffset){
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    createBuffer(context, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+
+    void* mapped;
+    vkMapMemory(context.getLogicalDevice(), stagingBufferMemory, 0, size, 0, &mapped);
+    memcpy(mapped, data, static_cast<size_t>(size));
+    vkUnmapMemory(context.getLogicalDevice(), stagingBufferMemory);
+
+    copyBuffer(context, stagingBuffer, dstBuf, size, dstOffset);
+
+    vkDestroyBuffer(context.getLogicalDevice(), stagingBuffer, nullptr);
+    vkFreeMemory(context.getLogicalDevice(), stagingBufferMemory, nullptr);
+}
 void copyBufferToImage(Context& context, CommandPool commandPool, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height){
     CommandBuffer cmdBuf(context, commandPool);
     cmdBuf.beginSingletimeCommands();
@@ -237,6 +297,14 @@ void createBuffer(Context& context, VkDeviceSize size, VkBufferUsageFlags usage,
     allocInfo.allocationSize = memRequirements.size;
     allocInfo.memoryTypeIndex = findMemoryType(context.physicalDevice, memRequirements.memoryTypeBits, properties);
 
+    // buffers read through a device address (descriptor buffers and what their descriptors point at)
+    VkMemoryAllocateFlagsInfo allocFlags{};
+    if(usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT){
+        allocFlags.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+        allocFlags.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
+        allocInfo.pNext = &allocFlags;
+    }
+
     if(vkAllocateMemory(context.logicalDevice, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS){
         throw std::runtime_error("Failed to allocate buffer memory!");
     }
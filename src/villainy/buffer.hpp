@@ -5,11 +5,14 @@
 #include <GLFW/glfw3.h>
 
 #include <vector>
+#include <tuple>
+#include <utility>
 #include <stdint.h>
 #include <cstring>
 
 #include "logger.hpp"
 #include "context.hpp"
+#include "utils.hpp"
 #include "window.hpp"
 
 namespace vlny{
@@ -21,42 +24,115 @@ class Swapchain;
 class Renderer;
 template <typename Vertex> struct RenderObject;
 
+enum class BufferUsage{
+    STATIC, // device local, uploaded once through a staging buffer, updates wait for the device
+    DYNAMIC, // persistently mapped, one region per frame in flight, updates copy only the dirty ranges of a cpu copy
+    STREAMING // persistently mapped, one region per frame in flight, rewritten whole every frame from a staging copy
+};
+
 template<typename Vertex>
 struct VertexBuffer{
-    VertexBuffer(Context& context, std::vector<Vertex> vertices);
+    // static, the cpu copy is only kept (getVertices) when asked for, an rvalue is moved into it instead of copied
+    VertexBuffer(Context& context, ArrayView<Vertex> vertices, bool keepCpuCopy = false);
+    VertexBuffer(Context& context, std::vector<Vertex>&& vertices, bool keepCpuCopy = false);
+    // DYNAMIC: updates go to the cpu copy (always kept, it's what the regions are brought up to date from) and only the
+    // dirty vertex ranges are copied into a frame's region when it's drawn (its fence was waited on, so the gpu is done with it)
+    // STREAMING: write the frame about to be drawn with updateFrame / map (Renderer::getCurrentFrame), the vertices are
+    // staged on the cpu and copied into the frame's region when it's drawn, after its fence like DYNAMIC
+    // growing past `capacity` (defaults to the vertex count) reallocates with doubled capacity and waits for the device
+    VertexBuffer(Context& context, const WindowConfig& windowConfig, BufferUsage usage, ArrayView<Vertex> vertices, size_t capacity = 0);
     
+    // STATIC and DYNAMIC, dynamic buffers diff against the cpu copy and only mark the vertices that changed
     void updateBuffer(const void* data, size_t size);
+    // DYNAMIC only, writes `count` vertices from `first` on, growing the buffer if needed
+    void updateVertices(size_t first, const Vertex* data, size_t count);
+    // STREAMING only, replaces the frame's vertices
+    void updateFrame(uint32_t frame, const Vertex* data, size_t count);
+    Vertex* map(uint32_t frame); // STREAMING only, getCapacity() staged vertices to write into
+
+    size_t getVertexCount() const { return vertexCount; }
+    size_t getCapacity() const { return capacity; }
+    BufferUsage getUsage() const { return usage; }
+    // empty without a cpu copy, the last staged frame for STREAMING
+    const std::vector<Vertex>& getVertices() const { return vertices; }
 
     ~VertexBuffer();
+
+    VertexBuffer(const VertexBuffer&) = delete;
+    VertexBuffer& operator=(const VertexBuffer&) = delete;
 private:
     Context& context;
+    BufferUsage usage = BufferUsage::STATIC;
 
+    bool cpuCopy;
     std::vector<Vertex> vertices;
+    size_t vertexCount = 0;
 
     VkDeviceSize bufferSize;
     VkBuffer vertexBuffer = VK_NULL_HANDLE;
     VkDeviceMemory vertexBufferMemory = VK_NULL_HANDLE;
 
+    size_t capacity = 0; // vertices per region
+    // dynamic and streaming
+    uint32_t regionCount = 1;
+    VkDeviceSize regionSize = 0;
+    uint8_t* mapped = nullptr;
+    std::vector<std::vector<std::pair<size_t, size_t>>> dirty; // [region] vertex ranges [begin, end) not copied yet
+
+    // past this many ranges per region they're merged into one
+    static constexpr size_t maxDirtyRanges = 16;
+
+    void createStaticBuffer(const Vertex* data, size_t count);
+    void createMappedBuffer();
+    void destroyBuffer();
+    void grow(size_t needed);
+    void markDirty(size_t begin, size_t end);
+    // copies the region's dirty (DYNAMIC) or staged (STREAMING) ranges and returns its offset, 0 for static buffers
+    VkDeviceSize syncFrame(uint32_t frame);
+
     template <typename V> friend struct RenderObject;
 };
 
+// device local, stored as the narrowest index type the largest index fits in: uint8 (Context::supportsUint8Indices),
+// uint16 or uint32, so small meshes use less index bandwidth and big ones don't have to be split
+// indices holding their type's all-ones value (primitive restart) keep that type
+// the cpu copy is opt-in like for static vertex buffers, it keeps the type the indices were given in:
+// getIndices<uint16_t>() for a uint16_t mesh, the other types' copies stay empty
 struct IndexBuffer{
-    IndexBuffer(Context& context, std::vector<uint16_t> indices);
+    IndexBuffer(Context& context, ArrayView<uint32_t> indices, bool keepCpuCopy = false);
+    IndexBuffer(Context& context, ArrayView<uint16_t> indices, bool keepCpuCopy = false);
+    IndexBuffer(Context& context, ArrayView<uint8_t> indices, bool keepCpuCopy = false);
+    IndexBuffer(Context& context, std::vector<uint32_t>&& indices, bool keepCpuCopy = false);
+    IndexBuffer(Context& context, std::vector<uint16_t>&& indices, bool keepCpuCopy = false);
     ~IndexBuffer();
+
+    IndexBuffer(const IndexBuffer&) = delete;
+    IndexBuffer& operator=(const IndexBuffer&) = delete;
+
+    uint32_t getIndexCount() const { return indexCount; }
+    VkIndexType getIndexType() const { return indexType; }
+    template <typename T>
+    const std::vector<T>& getIndices() const { return std::get<std::vector<T>>(indices); } // empty without a cpu copy
 private:
     Context& context;
 
-    std::vector<uint16_t> indices;
+    std::tuple<std::vector<uint32_t>, std::vector<uint16_t>, std::vector<uint8_t>> indices;
+    uint32_t indexCount;
+    VkIndexType indexType = VK_INDEX_TYPE_UINT16;
 
     VkDeviceSize bufferSize;
     VkBuffer indexBuffer = VK_NULL_HANDLE;
     VkDeviceMemory indexBufferMemory = VK_NULL_HANDLE;
 
+    template <typename T>
+    void upload(ArrayView<T> indices, bool keepCpuCopy);
+
     template <typename V> friend struct RenderObject;
 };
 
 struct UniformBuffer {
-    UniformBuffer(Context& context, WindowConfig windowconfig, size_t bufferSize, std::vector<VkDescriptorPoolSize> poolSizes);
+    // the sets come from Context::getDescriptorAllocator
+    UniformBuffer(Context& context, WindowConfig windowconfig, size_t bufferSize);
     ~UniformBuffer();
 
     // Delete copy constructor and assignment operator
@@ -83,22 +159,21 @@ private:
     std::vector<VkDeviceMemory> uniformBuffersMemory;
     std::vector<void*> uniformBuffersMapped;
 
-    VkDescriptorPool descriptorPool;
-    VkDescriptorSetLayout descriptorSetLayout;
+    VkDescriptorSetLayout descriptorSetLayout; // owned by the context's DescriptorLayoutCache
     std::vector<VkDescriptorSet> descriptorSets;
 
-    std::vector<VkDescriptorPoolSize> poolSizes;
     std::vector<VkDescriptorSetLayoutBinding> bindings;
     
     void createUniformBuffers();
-    void createDescriptorPool();
     void cleanup();
 
     template <typename V> friend struct RenderObject;
 };
 
 
-void copyBuffer(Context& context, VkBuffer srcBuf, VkBuffer dstBuf, VkDeviceSize size);
+void copyBuffer(Context& context, VkBuffer srcBuf, VkBuffer dstBuf, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+// through a temporary staging buffer, blocks until the copy is done
+void uploadBuffer(Context& context, VkBuffer dstBuf, const void* data, VkDeviceSize size, VkDeviceSize dstOffset = 0);
 void copyBufferToImage(Context& context, CommandPool commandPool, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
 void createBuffer(VkDevice device, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
 uint32_t findMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties);
@@ -1,94 +1,252 @@
 #include "buffer.hpp"
 //#include "context.hpp"
 
+#include <algorithm>
+#include <stdexcept>
+
 namespace vlny{
 
 template <typename Vertex>
-VertexBuffer<Vertex>::VertexBuffer(Context& context, std::vector<Vertex> vertices) : context(context), vertices(vertices) {
-    bufferSize = sizeof(vertices[0]) * vertices.size();
+VertexBuffer<Vertex>::VertexBuffer(Context& context, ArrayView<Vertex> vertices, bool keepCpuCopy) : context(context), cpuCopy(keepCpuCopy) {
+    createStaticBuffer(vertices.data(), vertices.size());
+    if(keepCpuCopy){
+        this->vertices.assign(vertices.begin(), vertices.end());
+    }
+}
 
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    createBuffer(context, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+template <typename Vertex>
+VertexBuffer<Vertex>::VertexBuffer(Context& context, std::vector<Vertex>&& vertices, bool keepCpuCopy) :
+    VertexBuffer(context, ArrayView<Vertex>(vertices)) {
+    cpuCopy = keepCpuCopy;
+    if(keepCpuCopy){
+        this->vertices = std::move(vertices);
+    }
+}
 
-    void* data;
-    vkMapMemory(context.getLogicalDevice(), stagingBufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, vertices.data(), (size_t) bufferSize);
-    vkUnmapMemory(context.getLogicalDevice(), stagingBufferMemory);
-    
-    createBuffer(context, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, 
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, vertexBuffer, vertexBufferMemory);
-    
-    copyBuffer(context, stagingBuffer, vertexBuffer, bufferSize);
-    
-    vkDestroyBuffer(context.getLogicalDevice(), stagingBuffer, nullptr);
-    vkFreeMemory(context.getLogicalDevice(), stagingBufferMemory, nullptr);
+template <typename Vertex>
+VertexBuffer<Vertex>::VertexBuffer(Context& context, const WindowConfig& windowConfig, BufferUsage usage, ArrayView<Vertex> vertices, size_t capacity) :
+    context(context), usage(usage), cpuCopy(usage == BufferUsage::DYNAMIC) {
+    if(usage == BufferUsage::STATIC){
+        createStaticBuffer(vertices.data(), vertices.size());
+        return;
+    }
+
+    regionCount = static_cast<uint32_t>(windowConfig.maxFramesInFlight);
+    this->capacity = std::max<size_t>({capacity, vertices.size(), 1});
+    createMappedBuffer();
+    vertexCount = vertices.size();
+    if(usage == BufferUsage::DYNAMIC){
+        this->vertices.assign(vertices.begin(), vertices.end());
+        markDirty(0, vertexCount);
+    }
+    else{
+        // every region starts out with the initial vertices, after that the frames write their own
+        for(uint32_t region = 0; region < regionCount; region++){
+            memcpy(mapped + regionSize * region, vertices.data(), vertices.size() * sizeof(Vertex));
+        }
+    }
 }
 
 template <typename Vertex>
-void VertexBuffer<Vertex>::updateBuffer(const void* dataPtr, size_t size){
-    void* data;
-    vkMapMemory(context.getLogicalDevice(),
-                vertexBufferMemory,
-                0,
-                size,
-                0,
-                &data);
+void VertexBuffer<Vertex>::createStaticBuffer(const Vertex* data, size_t count){
+    capacity = std::max<size_t>(count, 1);
+    vertexCount = count;
+    bufferSize = sizeof(Vertex) * capacity;
+    createBuffer(context, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferMemory);
+    if(count > 0){
+        uploadBuffer(context, vertexBuffer, data, sizeof(Vertex) * count);
+    }
+}
 
-    memcpy(data, dataPtr, size);
+template <typename Vertex>
+void VertexBuffer<Vertex>::createMappedBuffer(){
+    regionSize = sizeof(Vertex) * capacity;
+    bufferSize = regionSize * regionCount;
+    createBuffer(context, bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, vertexBuffer, vertexBufferMemory);
 
-    vkUnmapMemory(context.getLogicalDevice(),
-                  vertexBufferMemory);
+    void* data;
+    vkMapMemory(context.getLogicalDevice(), vertexBufferMemory, 0, VK_WHOLE_SIZE, 0, &data);
+    mapped = static_cast<uint8_t*>(data);
+    dirty.assign(regionCount, {});
 }
 
-/*
 template <typename Vertex>
 void VertexBuffer<Vertex>::updateBuffer(const void* dataPtr, size_t size){
-    if(size == 0) return; 
-
-    // update CPU-side vertices
-    size_t numVertices = size / sizeof(Vertex);
-    vertices.resize(numVertices);
-    memcpy(vertices.data(), dataPtr, size);
-
-    // recreate buffer if needed
-    if(size > bufferSize){
-        if(vertexBuffer != VK_NULL_HANDLE){
-            vkDestroyBuffer(context.getLogicalDevice(), vertexBuffer, nullptr);
-            vertexBuffer = VK_NULL_HANDLE;
+    size_t count = size / sizeof(Vertex);
+    const Vertex* src = static_cast<const Vertex*>(dataPtr);
+
+    if(usage == BufferUsage::STREAMING){
+        throw std::runtime_error("Streaming vertex buffers are written per frame with updateFrame!");
+    }
+    if(usage == BufferUsage::STATIC){
+        // the frames in flight may still read it
+        context.waitIdle();
+        if(count > capacity){
+            destroyBuffer();
+            createStaticBuffer(src, count);
         }
-        if(vertexBufferMemory != VK_NULL_HANDLE){
-            vkFreeMemory(context.getLogicalDevice(), vertexBufferMemory, nullptr);
-            vertexBufferMemory = VK_NULL_HANDLE;
+        else{
+            vertexCount = count;
+            if(count > 0){
+                uploadBuffer(context, vertexBuffer, src, size);
+            }
         }
+        if(cpuCopy){
+            vertices.assign(src, src + count);
+        }
+        return;
+    }
 
-        bufferSize = size;
-        createBuffer(context, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, 
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, vertexBuffer, vertexBufferMemory);
+    if(count > capacity){
+        grow(count);
     }
-    else{
-        bufferSize = size;
+
+    // only what differs from the cpu copy is marked, unchanged vertices are never copied again
+    size_t common = std::min(count, vertices.size());
+    size_t first = 0;
+    while(first < common && memcmp(&vertices[first], &src[first], sizeof(Vertex)) == 0){
+        first++;
+    }
+    size_t last = common;
+    while(last > first && memcmp(&vertices[last - 1], &src[last - 1], sizeof(Vertex)) == 0){
+        last--;
     }
 
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    createBuffer(context, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-    void* data;
-    vkMapMemory(context.getLogicalDevice(), stagingBufferMemory, 0, size, 0, &data);
-    memcpy(data, dataPtr, size);
-    vkUnmapMemory(context.getLogicalDevice(), stagingBufferMemory);
+    if(count < vertices.size()){
+        // ranges marked before the shrink may reach past the new end
+        for(auto& ranges : dirty){
+            for(auto& range : ranges){
+                range.second = std::min(range.second, count);
+            }
+            ranges.erase(std::remove_if(ranges.begin(), ranges.end(),
+                [](const auto& range){ return range.first >= range.second; }), ranges.end());
+        }
+    }
+    vertices.resize(count);
+    vertexCount = count;
+    if(first < last){
+        memcpy(&vertices[first], &src[first], (last - first) * sizeof(Vertex));
+        markDirty(first, last);
+    }
+    if(count > common){
+        memcpy(&vertices[common], &src[common], (count - common) * sizeof(Vertex));
+        markDirty(common, count);
+    }
+}
 
-    copyBuffer(context, stagingBuffer, vertexBuffer, size);
+template <typename Vertex>
+void VertexBuffer<Vertex>::updateVertices(size_t first, const Vertex* data, size_t count){
+    if(usage != BufferUsage::DYNAMIC){
+        throw std::runtime_error("updateVertices needs a dynamic vertex buffer!");
+    }
+    if(count == 0){
+        return;
+    }
+    if(first + count > capacity){
+        grow(first + count);
+    }
+    if(first + count > vertices.size()){
+        vertices.resize(first + count);
+        vertexCount = vertices.size();
+    }
+    memcpy(&vertices[first], data, count * sizeof(Vertex));
+    markDirty(first, first + count);
+}
+
+template <typename Vertex>
+void VertexBuffer<Vertex>::updateFrame(uint32_t frame, const Vertex* data, size_t count){
+    if(usage != BufferUsage::STREAMING){
+        throw std::runtime_error("updateFrame needs a streaming vertex buffer!");
+    }
+    if(count > capacity){
+        grow(count);
+    }
+    // the region may still be read by the frame that last drew it, syncFrame copies once its fence was waited on
+    vertices.assign(data, data + count);
+    vertexCount = count;
+    dirty[frame % regionCount].assign(1, {0, count});
+}
 
+template <typename Vertex>
+Vertex* VertexBuffer<Vertex>::map(uint32_t frame){
+    if(usage != BufferUsage::STREAMING){
+        throw std::runtime_error("Only streaming vertex buffers can be mapped!");
+    }
+    vertices.resize(capacity);
+    dirty[frame % regionCount].assign(1, {0, capacity});
+    return vertices.data();
+}
 
-    vkDestroyBuffer(context.getLogicalDevice(), stagingBuffer, nullptr);
-    vkFreeMemory(context.getLogicalDevice(), stagingBufferMemory, nullptr);
-}*/
+// dynamic and streaming, frames in flight may still read the old buffer, growing is rare enough to wait for them
+// streaming regions come back empty, the frames rewrite them anyway
+template <typename Vertex>
+void VertexBuffer<Vertex>::grow(size_t needed){
+    context.waitIdle();
+    destroyBuffer();
+
+    capacity = std::max(needed, capacity * 2);
+    createMappedBuffer();
+    if(usage == BufferUsage::DYNAMIC){
+        markDirty(0, vertices.size());
+    }
+    VILLAINY_VERBOSE_LOG(context.logger, "Grew vertex buffer to " + std::to_string(capacity) + " vertices.");
+}
 
 template <typename Vertex>
-VertexBuffer<Vertex>::~VertexBuffer(){
+void VertexBuffer<Vertex>::markDirty(size_t begin, size_t end){
+    if(begin >= end){
+        return;
+    }
+    for(auto& ranges : dirty){
+        // overlapping or touching ranges are merged right away
+        bool merged = false;
+        for(auto& range : ranges){
+            if(begin <= range.second && range.first <= end){
+                range.first = std::min(range.first, begin);
+                range.second = std::max(range.second, end);
+                merged = true;
+                break;
+            }
+        }
+        if(!merged){
+            ranges.emplace_back(begin, end);
+        }
+        if(ranges.size() > maxDirtyRanges){
+            size_t first = ranges[0].first, last = ranges[0].second;
+            for(const auto& range : ranges){
+                first = std::min(first, range.first);
+                last = std::max(last, range.second);
+            }
+            ranges.assign(1, {first, last});
+        }
+    }
+}
+
+template <typename Vertex>
+VkDeviceSize VertexBuffer<Vertex>::syncFrame(uint32_t frame){
+    if(usage == BufferUsage::STATIC){
+        return 0;
+    }
+    uint32_t region = frame % regionCount;
+    uint8_t* dst = mapped + regionSize * region;
+    for(const auto& [begin, end] : dirty[region]){
+        size_t last = std::min(end, vertices.size());
+        if(begin < last){
+            memcpy(dst + begin * sizeof(Vertex), &vertices[begin], (last - begin) * sizeof(Vertex));
+        }
+    }
+    dirty[region].clear();
+    return regionSize * region;
+}
+
+template <typename Vertex>
+void VertexBuffer<Vertex>::destroyBuffer(){
+    if(mapped != nullptr){
+        vkUnmapMemory(context.getLogicalDevice(), vertexBufferMemory);
+        mapped = nullptr;
+    }
     if(vertexBuffer != VK_NULL_HANDLE){
         vkDestroyBuffer(context.getLogicalDevice(), vertexBuffer, nullptr);
         vertexBuffer = VK_NULL_HANDLE;
@@ -99,4 +257,9 @@ VertexBuffer<Vertex>::~VertexBuffer(){
     }
 }
 
+template <typename Vertex>
+VertexBuffer<Vertex>::~VertexBuffer(){
+    destroyBuffer();
+}
+
 }
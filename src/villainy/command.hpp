@@ -1,6 +1,7 @@
 #ifndef VILLAINY_COMMAND
 #define VILLAINY_COMMAND
 
+#include <cstdint>
 #include <vector>
 
 #define GLFW_INCLUDE_VULKAN
@@ -21,6 +22,16 @@ struct CommandPool{
     std::vector<CommandBuffer> createCommandBuffers(Context& context, uint32_t n);
 };
 
+// per-frame hook, register with Renderer::addFrameResource
+// prepareFrame runs on the render thread after the frame's fence was waited on and before anything is recorded,
+// so whatever that frame slot used last time is free to be rewritten
+// recordFrameCommands records into the frame's command buffer before the render pass begins (uploads, copies, barriers)
+struct FrameResource{
+    virtual ~FrameResource() = default;
+    virtual void prepareFrame(uint32_t /*frame*/) {}
+    virtual void recordFrameCommands(VkCommandBuffer /*commandBuffer*/, uint32_t /*frame*/) {}
+};
+
 class CommandBuffer{
 public:
     CommandBuffer(Context& context, CommandPool& commandPool);
@@ -36,8 +47,9 @@ private:
 
     friend struct CommandPool;
     friend class Renderer;
+    friend class Texture;
     friend void copyBufferToImage(Context& context, CommandPool commandPool, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
-    friend void transitionImageLayout(Context& context, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
+    friend void transitionImageLayout(Context& context, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels);
     friend void copyBuffer(Context& context, VkBuffer srcBuf, VkBuffer dstBuf, VkDeviceSize size);
 };
 
@@ -4,6 +4,8 @@
 
 #include <GLFW/glfw3.h>
 
+#include <algorithm>
+
 namespace vlny{
 
 bool QueueFamilyIndices::isComplete(){
@@ -22,6 +24,42 @@ CommandPool& Context::getTransientCommandPool(){
     return transientCommandPool.value();
 }
 
+std::shared_ptr<Texture> Context::loadTexture(const std::string& path, const TextureConfig& config){
+    return textureCache.value().load(path, config);
+}
+
+std::shared_ptr<Sampler> Context::getSampler(const SamplerConfig& config){
+    return samplerCache.value().get(config);
+}
+
+TextureCache& Context::getTextureCache(){
+    return textureCache.value();
+}
+
+SamplerCache& Context::getSamplerCache(){
+    return samplerCache.value();
+}
+
+VkDescriptorSetLayout Context::getDescriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings, VkDescriptorSetLayoutCreateFlags flags){
+    return descriptorLayoutCache.value().get(bindings, flags);
+}
+
+DescriptorLayoutCache& Context::getDescriptorLayoutCache(){
+    return descriptorLayoutCache.value();
+}
+
+DescriptorAllocator& Context::getDescriptorAllocator(){
+    return descriptorAllocator.value();
+}
+
+ShaderModuleCache& Context::getShaderModuleCache(){
+    return shaderModuleCache.value();
+}
+
+DescriptorBufferHeap& Context::getDescriptorBufferHeap(){
+    return descriptorBufferHeap.value();
+}
+
 void Context::waitIdle(){
     if(logicalDevice != VK_NULL_HANDLE){
         vkDeviceWaitIdle(logicalDevice);
@@ -45,6 +83,36 @@ Context& Context::operator=(Context&& other) {
     debugMessenger = other.debugMessenger;
     queueFamilyIndices = other.queueFamilyIndices;
     maxAnisotropy = other.maxAnisotropy;
+    multiDrawIndirectEnabled = other.multiDrawIndirectEnabled;
+    indexTypeUint8Enabled = other.indexTypeUint8Enabled;
+    descriptorIndexingEnabled = other.descriptorIndexingEnabled;
+    maxBindlessSampledImages = other.maxBindlessSampledImages;
+    maxBindlessStorageBuffers = other.maxBindlessStorageBuffers;
+    enabledDeviceExtensions = std::move(other.enabledDeviceExtensions);
+    pfnCreateDescriptorUpdateTemplate = other.pfnCreateDescriptorUpdateTemplate;
+    pfnDestroyDescriptorUpdateTemplate = other.pfnDestroyDescriptorUpdateTemplate;
+    pfnUpdateDescriptorSetWithTemplate = other.pfnUpdateDescriptorSetWithTemplate;
+    pfnCmdPushDescriptorSet = other.pfnCmdPushDescriptorSet;
+    descriptorBufferEnabled = other.descriptorBufferEnabled;
+    descriptorBufferProperties = other.descriptorBufferProperties;
+    pfnGetDescriptorSetLayoutSize = other.pfnGetDescriptorSetLayoutSize;
+    pfnGetDescriptorSetLayoutBindingOffset = other.pfnGetDescriptorSetLayoutBindingOffset;
+    pfnGetDescriptor = other.pfnGetDescriptor;
+    pfnCmdBindDescriptorBuffers = other.pfnCmdBindDescriptorBuffers;
+    pfnCmdSetDescriptorBufferOffsets = other.pfnCmdSetDescriptorBufferOffsets;
+    pfnGetBufferDeviceAddress = other.pfnGetBufferDeviceAddress;
+    pipelineLibraryEnabled = other.pipelineLibraryEnabled;
+    pipelineLibraryFastLinking = other.pipelineLibraryFastLinking;
+    extendedDynamicStates = std::move(other.extendedDynamicStates);
+    pfnCmdSetCullMode = other.pfnCmdSetCullMode;
+    pfnCmdSetFrontFace = other.pfnCmdSetFrontFace;
+    pfnCmdSetPrimitiveTopology = other.pfnCmdSetPrimitiveTopology;
+    pfnCmdSetDepthTestEnable = other.pfnCmdSetDepthTestEnable;
+    pfnCmdSetDepthWriteEnable = other.pfnCmdSetDepthWriteEnable;
+    pfnCmdSetDepthCompareOp = other.pfnCmdSetDepthCompareOp;
+    pfnCmdSetPrimitiveRestartEnable = other.pfnCmdSetPrimitiveRestartEnable;
+    pfnCmdSetPolygonMode = other.pfnCmdSetPolygonMode;
+    pfnCmdSetDepthClampEnable = other.pfnCmdSetDepthClampEnable;
 
     // null out the other so its destructor doesn't double-destroy
     other.vkInstance = VK_NULL_HANDLE;
@@ -72,6 +140,14 @@ void Context::renderInit(Window& window){
     selectPhysicalDevice(window.windowSurface);
     makeLogicalDevice(queueFamilyIndices);
     transientCommandPool.emplace(*this);
+    textureCache.emplace(*this, config.textureCacheBudget);
+    samplerCache.emplace(*this);
+    shaderModuleCache.emplace(*this);
+    descriptorLayoutCache.emplace(*this);
+    descriptorAllocator.emplace(*this, true);
+    if(descriptorBufferEnabled){
+        descriptorBufferHeap.emplace(*this, config.descriptorBufferSize);
+    }
 }
 
 void Context::createInstance(){
@@ -85,9 +161,13 @@ void Context::createInstance(){
     appInfo.applicationVersion = VK_MAKE_VERSION(config.appVersionMajor, config.appVersionMinor, config.appVersionPatch);
     appInfo.pEngineName = config.engineName.c_str();
     appInfo.engineVersion = VK_MAKE_VERSION(config.engineVersionMajor, config.engineVersionMinor, config.engineVersionPatch);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    appInfo.apiVersion = config.apiVersion;
 
     std::vector<const char*> extensions = getRequiredExtensions();
+    if(config.apiVersion < VK_API_VERSION_1_1 && (config.descriptorIndexing ||
+        (config.pushDescriptors && instanceExtensionAvailable(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME)))){
+        extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME); // feature/property chains, push descriptors
+    }
     extensions.insert(extensions.end(), config.vulkanExts.begin(), config.vulkanExts.end());
 
     VkInstanceCreateInfo instanceInfo{};
@@ -182,6 +262,65 @@ void Context::makeLogicalDevice(QueueFamilyIndices indices){
         vkGetPhysicalDeviceProperties(physicalDevice, &properties);
         maxAnisotropy = properties.limits.maxSamplerAnisotropy;
     }
+    if(supportedFeatures.multiDrawIndirect && supportedFeatures.drawIndirectFirstInstance){
+        deviceFeatures.multiDrawIndirect = VK_TRUE;
+        deviceFeatures.drawIndirectFirstInstance = VK_TRUE;
+        multiDrawIndirectEnabled = true;
+    }
+
+    std::vector<const char*> deviceExtensions = getDeviceExtensions();
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+    for(const char* optional : getOptionalDeviceExtensions()){
+        for(const auto& extension : availableExtensions){
+            if(std::string(optional) == extension.extensionName){
+                deviceExtensions.push_back(optional);
+                break;
+            }
+        }
+    }
+
+    // the extension alone isn't enough, drop it again when the features it needs are missing
+    VkPhysicalDeviceDescriptorBufferFeaturesEXT descriptorBufferFeatures{};
+    VkPhysicalDeviceBufferDeviceAddressFeatures addressFeatures{};
+    auto descriptorBufferExt = std::find_if(deviceExtensions.begin(), deviceExtensions.end(), [](const char* name){
+        return std::string(name) == VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME;
+    });
+    bool descriptorBufferFeaturesEnabled = false;
+    if(descriptorBufferExt != deviceExtensions.end()){
+        descriptorBufferFeaturesEnabled = enableDescriptorBuffer(descriptorBufferFeatures, addressFeatures);
+        if(!descriptorBufferFeaturesEnabled){
+            deviceExtensions.erase(descriptorBufferExt);
+        }
+    }
+    // graphics pipeline libraries come as a pair, both go when either is missing
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT pipelineLibraryFeatures{};
+    auto isLibraryExt = [](const char* name){
+        return std::string(name) == VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME || std::string(name) == VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME;
+    };
+    if(config.pipelineLibraries){
+        bool bothAvailable = std::count_if(deviceExtensions.begin(), deviceExtensions.end(), isLibraryExt) == 2;
+        if(!bothAvailable || !enablePipelineLibrary(pipelineLibraryFeatures)){
+            deviceExtensions.erase(std::remove_if(deviceExtensions.begin(), deviceExtensions.end(), isLibraryExt), deviceExtensions.end());
+            VILLAINY_VERBOSE_LOG(logger, "Graphics pipeline libraries unavailable, pipelines are compiled whole.");
+        }
+    }
+    VkPhysicalDeviceExtendedDynamicStateFeaturesEXT dynamicStateFeatures{};
+    VkPhysicalDeviceExtendedDynamicState2FeaturesEXT dynamicState2Features{};
+    VkPhysicalDeviceExtendedDynamicState3FeaturesEXT dynamicState3Features{};
+    if(config.extendedDynamicState){
+        enableExtendedDynamicState(deviceExtensions, dynamicStateFeatures, dynamicState2Features, dynamicState3Features);
+    }
+    VkPhysicalDeviceIndexTypeUint8FeaturesEXT indexTypeUint8Features{};
+    auto indexTypeUint8Ext = std::find_if(deviceExtensions.begin(), deviceExtensions.end(), [](const char* name){
+        return std::string(name) == VK_EXT_INDEX_TYPE_UINT8_EXTENSION_NAME;
+    });
+    if(indexTypeUint8Ext != deviceExtensions.end() && !enableIndexTypeUint8(indexTypeUint8Features)){
+        deviceExtensions.erase(indexTypeUint8Ext);
+    }
+    enabledDeviceExtensions = std::set<std::string>(deviceExtensions.begin(), deviceExtensions.end());
     
     VkDeviceCreateInfo deviceCreateInfo{};
 
@@ -189,8 +328,41 @@ void Context::makeLogicalDevice(QueueFamilyIndices indices){
     deviceCreateInfo.queueCreateInfoCount = scast_ui32(queueCreateInfos.size());
     deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
     deviceCreateInfo.pEnabledFeatures = &deviceFeatures;
-    deviceCreateInfo.enabledExtensionCount = scast_ui32(config.deviceExts.size());
-    deviceCreateInfo.ppEnabledExtensionNames = config.deviceExts.data();
+    deviceCreateInfo.enabledExtensionCount = scast_ui32(deviceExtensions.size());
+    deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();
+
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures{};
+    if(config.descriptorIndexing){
+        enableDescriptorIndexing(indexingFeatures);
+        indexingFeatures.pNext = const_cast<void*>(deviceCreateInfo.pNext);
+        deviceCreateInfo.pNext = &indexingFeatures;
+    }
+    if(descriptorBufferFeaturesEnabled){
+        addressFeatures.pNext = const_cast<void*>(deviceCreateInfo.pNext);
+        descriptorBufferFeatures.pNext = &addressFeatures;
+        deviceCreateInfo.pNext = &descriptorBufferFeatures;
+    }
+    if(pipelineLibraryEnabled){
+        pipelineLibraryFeatures.pNext = const_cast<void*>(deviceCreateInfo.pNext);
+        deviceCreateInfo.pNext = &pipelineLibraryFeatures;
+    }
+    // left zeroed (sType too) when their extension was dropped
+    if(dynamicStateFeatures.sType != 0){
+        dynamicStateFeatures.pNext = const_cast<void*>(deviceCreateInfo.pNext);
+        deviceCreateInfo.pNext = &dynamicStateFeatures;
+    }
+    if(dynamicState2Features.sType != 0){
+        dynamicState2Features.pNext = const_cast<void*>(deviceCreateInfo.pNext);
+        deviceCreateInfo.pNext = &dynamicState2Features;
+    }
+    if(dynamicState3Features.sType != 0){
+        dynamicState3Features.pNext = const_cast<void*>(deviceCreateInfo.pNext);
+        deviceCreateInfo.pNext = &dynamicState3Features;
+    }
+    if(indexTypeUint8Enabled){
+        indexTypeUint8Features.pNext = const_cast<void*>(deviceCreateInfo.pNext);
+        deviceCreateInfo.pNext = &indexTypeUint8Features;
+    }
 
     if(config.enableValidationLayers){
         deviceCreateInfo.enabledLayerCount = scast_ui32(config.validationLayers.size());
@@ -206,6 +378,358 @@ void Context::makeLogicalDevice(QueueFamilyIndices indices){
 
     vkGetDeviceQueue(logicalDevice, indices.graphicsFamily.value(), 0, &graphicsQueue);
     vkGetDeviceQueue(logicalDevice, indices.presentFamily.value(), 0, &presentQueue);
+
+    loadDeviceFunctions();
+}
+
+void Context::loadDeviceFunctions(){
+    if(config.descriptorUpdateTemplates){
+        bool core = config.apiVersion >= VK_API_VERSION_1_1;
+        if(core || isDeviceExtensionEnabled(VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME)){
+            pfnCreateDescriptorUpdateTemplate = (PFN_vkCreateDescriptorUpdateTemplateKHR) vkGetDeviceProcAddr(logicalDevice,
+                core ? "vkCreateDescriptorUpdateTemplate" : "vkCreateDescriptorUpdateTemplateKHR");
+            pfnDestroyDescriptorUpdateTemplate = (PFN_vkDestroyDescriptorUpdateTemplateKHR) vkGetDeviceProcAddr(logicalDevice,
+                core ? "vkDestroyDescriptorUpdateTemplate" : "vkDestroyDescriptorUpdateTemplateKHR");
+            pfnUpdateDescriptorSetWithTemplate = (PFN_vkUpdateDescriptorSetWithTemplateKHR) vkGetDeviceProcAddr(logicalDevice,
+                core ? "vkUpdateDescriptorSetWithTemplate" : "vkUpdateDescriptorSetWithTemplateKHR");
+        }
+        if(pfnCreateDescriptorUpdateTemplate == nullptr || pfnDestroyDescriptorUpdateTemplate == nullptr || pfnUpdateDescriptorSetWithTemplate == nullptr){
+            pfnCreateDescriptorUpdateTemplate = nullptr;
+            pfnDestroyDescriptorUpdateTemplate = nullptr;
+            pfnUpdateDescriptorSetWithTemplate = nullptr;
+            VILLAINY_VERBOSE_LOG(logger, "Descriptor update templates unavailable, using plain descriptor writes.");
+        }
+    }
+
+    if(config.pushDescriptors && isDeviceExtensionEnabled(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME)){
+        pfnCmdPushDescriptorSet = (PFN_vkCmdPushDescriptorSetKHR) vkGetDeviceProcAddr(logicalDevice, "vkCmdPushDescriptorSetKHR");
+    }
+
+    if(isDeviceExtensionEnabled(VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME)){
+        pfnGetDescriptorSetLayoutSize = (PFN_vkGetDescriptorSetLayoutSizeEXT) vkGetDeviceProcAddr(logicalDevice, "vkGetDescriptorSetLayoutSizeEXT");
+        pfnGetDescriptorSetLayoutBindingOffset = (PFN_vkGetDescriptorSetLayoutBindingOffsetEXT) vkGetDeviceProcAddr(logicalDevice, "vkGetDescriptorSetLayoutBindingOffsetEXT");
+        pfnGetDescriptor = (PFN_vkGetDescriptorEXT) vkGetDeviceProcAddr(logicalDevice, "vkGetDescriptorEXT");
+        pfnCmdBindDescriptorBuffers = (PFN_vkCmdBindDescriptorBuffersEXT) vkGetDeviceProcAddr(logicalDevice, "vkCmdBindDescriptorBuffersEXT");
+        pfnCmdSetDescriptorBufferOffsets = (PFN_vkCmdSetDescriptorBufferOffsetsEXT) vkGetDeviceProcAddr(logicalDevice, "vkCmdSetDescriptorBufferOffsetsEXT");
+        pfnGetBufferDeviceAddress = (PFN_vkGetBufferDeviceAddress) vkGetDeviceProcAddr(logicalDevice, "vkGetBufferDeviceAddress");
+        descriptorBufferEnabled = pfnGetDescriptorSetLayoutSize != nullptr && pfnGetDescriptorSetLayoutBindingOffset != nullptr &&
+            pfnGetDescriptor != nullptr && pfnCmdBindDescriptorBuffers != nullptr && pfnCmdSetDescriptorBufferOffsets != nullptr &&
+            pfnGetBufferDeviceAddress != nullptr;
+    }
+    if(config.descriptorBuffers && !descriptorBufferEnabled){
+        VILLAINY_VERBOSE_LOG(logger, "Descriptor buffers unavailable, DescriptorManager keeps using descriptor sets.");
+    }
+
+    if(isDeviceExtensionEnabled(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME)){
+        pfnCmdSetCullMode = (PFN_vkCmdSetCullModeEXT) vkGetDeviceProcAddr(logicalDevice, "vkCmdSetCullModeEXT");
+        pfnCmdSetFrontFace = (PFN_vkCmdSetFrontFaceEXT) vkGetDeviceProcAddr(logicalDevice, "vkCmdSetFrontFaceEXT");
+        pfnCmdSetPrimitiveTopology = (PFN_vkCmdSetPrimitiveTopologyEXT) vkGetDeviceProcAddr(logicalDevice, "vkCmdSetPrimitiveTopologyEXT");
+        pfnCmdSetDepthTestEnable = (PFN_vkCmdSetDepthTestEnableEXT) vkGetDeviceProcAddr(logicalDevice, "vkCmdSetDepthTestEnableEXT");
+        pfnCmdSetDepthWriteEnable = (PFN_vkCmdSetDepthWriteEnableEXT) vkGetDeviceProcAddr(logicalDevice, "vkCmdSetDepthWriteEnableEXT");
+        pfnCmdSetDepthCompareOp = (PFN_vkCmdSetDepthCompareOpEXT) vkGetDeviceProcAddr(logicalDevice, "vkCmdSetDepthCompareOpEXT");
+    }
+    if(isDeviceExtensionEnabled(VK_EXT_EXTENDED_DYNAMIC_STATE_2_EXTENSION_NAME)){
+        pfnCmdSetPrimitiveRestartEnable = (PFN_vkCmdSetPrimitiveRestartEnableEXT) vkGetDeviceProcAddr(logicalDevice, "vkCmdSetPrimitiveRestartEnableEXT");
+    }
+    if(isDeviceExtensionEnabled(VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME)){
+        pfnCmdSetPolygonMode = (PFN_vkCmdSetPolygonModeEXT) vkGetDeviceProcAddr(logicalDevice, "vkCmdSetPolygonModeEXT");
+        pfnCmdSetDepthClampEnable = (PFN_vkCmdSetDepthClampEnableEXT) vkGetDeviceProcAddr(logicalDevice, "vkCmdSetDepthClampEnableEXT");
+    }
+    // a state whose command didn't load can't be dynamic
+    const std::pair<VkDynamicState, bool> loaded[] = {
+        {VK_DYNAMIC_STATE_CULL_MODE_EXT, pfnCmdSetCullMode != nullptr},
+        {VK_DYNAMIC_STATE_FRONT_FACE_EXT, pfnCmdSetFrontFace != nullptr},
+        {VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_EXT, pfnCmdSetPrimitiveTopology != nullptr},
+        {VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT, pfnCmdSetDepthTestEnable != nullptr},
+        {VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT, pfnCmdSetDepthWriteEnable != nullptr},
+        {VK_DYNAMIC_STATE_DEPTH_COMPARE_OP_EXT, pfnCmdSetDepthCompareOp != nullptr},
+        {VK_DYNAMIC_STATE_PRIMITIVE_RESTART_ENABLE_EXT, pfnCmdSetPrimitiveRestartEnable != nullptr},
+        {VK_DYNAMIC_STATE_POLYGON_MODE_EXT, pfnCmdSetPolygonMode != nullptr},
+        {VK_DYNAMIC_STATE_DEPTH_CLAMP_ENABLE_EXT, pfnCmdSetDepthClampEnable != nullptr},
+    };
+    for(const auto& [state, available] : loaded){
+        if(!available){
+            extendedDynamicStates.erase(state);
+        }
+    }
+}
+
+bool Context::supportsPushDescriptors() const{
+    return pfnCmdPushDescriptorSet != nullptr;
+}
+
+bool Context::supportsDescriptorBuffers() const{
+    return descriptorBufferEnabled;
+}
+
+bool Context::supportsPipelineLibraries() const{
+    return pipelineLibraryEnabled;
+}
+
+bool Context::hasFastPipelineLinking() const{
+    return pipelineLibraryFastLinking;
+}
+
+bool Context::supportsMultiDrawIndirect() const{
+    return multiDrawIndirectEnabled;
+}
+
+bool Context::supportsUint8Indices() const{
+    return indexTypeUint8Enabled;
+}
+
+bool Context::supportsDynamicState(VkDynamicState state) const{
+    // viewport through stencil reference are 1.0
+    if(state >= VK_DYNAMIC_STATE_VIEWPORT && state <= VK_DYNAMIC_STATE_STENCIL_REFERENCE){
+        return true;
+    }
+    return extendedDynamicStates.count(state) > 0;
+}
+
+bool Context::instanceExtensionAvailable(const char* name){
+    uint32_t extensionCount;
+    vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, availableExtensions.data());
+    for(const auto& extension : availableExtensions){
+        if(std::string(name) == extension.extensionName){
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Context::isDeviceExtensionEnabled(const std::string& name) const{
+    return enabledDeviceExtensions.count(name) > 0;
+}
+
+void Context::enableDescriptorIndexing(VkPhysicalDeviceDescriptorIndexingFeaturesEXT& features){
+    // core in 1.1, KHR suffixed before that
+    bool core = config.apiVersion >= VK_API_VERSION_1_1;
+    auto getFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2KHR) vkGetInstanceProcAddr(vkInstance,
+        core ? "vkGetPhysicalDeviceFeatures2" : "vkGetPhysicalDeviceFeatures2KHR");
+    auto getProperties2 = (PFN_vkGetPhysicalDeviceProperties2KHR) vkGetInstanceProcAddr(vkInstance,
+        core ? "vkGetPhysicalDeviceProperties2" : "vkGetPhysicalDeviceProperties2KHR");
+    if(getFeatures2 == nullptr || getProperties2 == nullptr){
+        throw std::runtime_error("Descriptor indexing needs vkGetPhysicalDeviceFeatures2!");
+    }
+
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT supported{};
+    supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    VkPhysicalDeviceFeatures2KHR features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+    features2.pNext = &supported;
+    getFeatures2(physicalDevice, &features2);
+
+    if(!supported.runtimeDescriptorArray || !supported.descriptorBindingPartiallyBound ||
+        !supported.shaderSampledImageArrayNonUniformIndexing || !supported.descriptorBindingSampledImageUpdateAfterBind ||
+        !supported.descriptorBindingStorageBufferUpdateAfterBind){
+        throw std::runtime_error("Descriptor indexing is not supported by this GPU!");
+    }
+
+    features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    features.runtimeDescriptorArray = VK_TRUE;
+    features.descriptorBindingPartiallyBound = VK_TRUE;
+    features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    features.shaderStorageBufferArrayNonUniformIndexing = supported.shaderStorageBufferArrayNonUniformIndexing;
+    features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    features.descriptorBindingUpdateUnusedWhilePending = supported.descriptorBindingUpdateUnusedWhilePending;
+    features.descriptorBindingVariableDescriptorCount = supported.descriptorBindingVariableDescriptorCount;
+
+    VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexingProps{};
+    indexingProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+    VkPhysicalDeviceProperties2KHR props2{};
+    props2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
+    props2.pNext = &indexingProps;
+    getProperties2(physicalDevice, &props2);
+
+    maxBindlessSampledImages = std::min(indexingProps.maxPerStageDescriptorUpdateAfterBindSampledImages,
+        indexingProps.maxDescriptorSetUpdateAfterBindSampledImages);
+    maxBindlessStorageBuffers = std::min(indexingProps.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+        indexingProps.maxDescriptorSetUpdateAfterBindStorageBuffers);
+    descriptorIndexingEnabled = true;
+    VILLAINY_VERBOSE_LOG(logger, "Enabled descriptor indexing (" + std::to_string(maxBindlessSampledImages) + " bindless images).");
+}
+
+bool Context::enableDescriptorBuffer(VkPhysicalDeviceDescriptorBufferFeaturesEXT& features, VkPhysicalDeviceBufferDeviceAddressFeatures& addressFeatures){
+    // only requested on 1.2+, where both the feature queries and buffer device addresses are core
+    auto getFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2) vkGetInstanceProcAddr(vkInstance, "vkGetPhysicalDeviceFeatures2");
+    auto getProperties2 = (PFN_vkGetPhysicalDeviceProperties2) vkGetInstanceProcAddr(vkInstance, "vkGetPhysicalDeviceProperties2");
+    if(getFeatures2 == nullptr || getProperties2 == nullptr){
+        return false;
+    }
+
+    VkPhysicalDeviceBufferDeviceAddressFeatures supportedAddress{};
+    supportedAddress.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES;
+    VkPhysicalDeviceDescriptorBufferFeaturesEXT supported{};
+    supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_FEATURES_EXT;
+    supported.pNext = &supportedAddress;
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &supported;
+    getFeatures2(physicalDevice, &features2);
+
+    if(!supported.descriptorBuffer || !supportedAddress.bufferDeviceAddress){
+        return false;
+    }
+
+    features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_FEATURES_EXT;
+    features.descriptorBuffer = VK_TRUE;
+    addressFeatures = {};
+    addressFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES;
+    addressFeatures.bufferDeviceAddress = VK_TRUE;
+
+    descriptorBufferProperties = {};
+    descriptorBufferProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_PROPERTIES_EXT;
+    VkPhysicalDeviceProperties2 props2{};
+    props2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    props2.pNext = &descriptorBufferProperties;
+    getProperties2(physicalDevice, &props2);
+    descriptorBufferProperties.pNext = nullptr;
+    return true;
+}
+
+bool Context::enablePipelineLibrary(VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT& features){
+    // only requested on 1.1+, where the feature queries are core
+    auto getFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2) vkGetInstanceProcAddr(vkInstance, "vkGetPhysicalDeviceFeatures2");
+    auto getProperties2 = (PFN_vkGetPhysicalDeviceProperties2) vkGetInstanceProcAddr(vkInstance, "vkGetPhysicalDeviceProperties2");
+    if(getFeatures2 == nullptr || getProperties2 == nullptr){
+        return false;
+    }
+
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT supported{};
+    supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &supported;
+    getFeatures2(physicalDevice, &features2);
+
+    if(!supported.graphicsPipelineLibrary){
+        return false;
+    }
+
+    features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+    features.graphicsPipelineLibrary = VK_TRUE;
+
+    VkPhysicalDeviceGraphicsPipelineLibraryPropertiesEXT libraryProps{};
+    libraryProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_PROPERTIES_EXT;
+    VkPhysicalDeviceProperties2 props2{};
+    props2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    props2.pNext = &libraryProps;
+    getProperties2(physicalDevice, &props2);
+    pipelineLibraryFastLinking = libraryProps.graphicsPipelineLibraryFastLinking;
+    pipelineLibraryEnabled = true;
+    VILLAINY_VERBOSE_LOG(logger, std::string("Enabled graphics pipeline libraries") + (pipelineLibraryFastLinking ? " with fast linking." : "."));
+    return true;
+}
+
+bool Context::enableIndexTypeUint8(VkPhysicalDeviceIndexTypeUint8FeaturesEXT& features){
+    // only requested on 1.1+, where the feature queries are core
+    auto getFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2) vkGetInstanceProcAddr(vkInstance, "vkGetPhysicalDeviceFeatures2");
+    if(getFeatures2 == nullptr){
+        return false;
+    }
+
+    VkPhysicalDeviceIndexTypeUint8FeaturesEXT supported{};
+    supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_INDEX_TYPE_UINT8_FEATURES_EXT;
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &supported;
+    getFeatures2(physicalDevice, &features2);
+
+    if(!supported.indexTypeUint8){
+        return false;
+    }
+
+    features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_INDEX_TYPE_UINT8_FEATURES_EXT;
+    features.indexTypeUint8 = VK_TRUE;
+    indexTypeUint8Enabled = true;
+    return true;
+}
+
+void Context::enableExtendedDynamicState(std::vector<const char*>& deviceExtensions, VkPhysicalDeviceExtendedDynamicStateFeaturesEXT& features,
+    VkPhysicalDeviceExtendedDynamicState2FeaturesEXT& features2, VkPhysicalDeviceExtendedDynamicState3FeaturesEXT& features3){
+    auto hasExtension = [&](const char* name){
+        return std::find_if(deviceExtensions.begin(), deviceExtensions.end(), [&](const char* ext){ return std::string(ext) == name; }) != deviceExtensions.end();
+    };
+    auto dropExtension = [&](const char* name){
+        deviceExtensions.erase(std::remove_if(deviceExtensions.begin(), deviceExtensions.end(), [&](const char* ext){
+            return std::string(ext) == name;
+        }), deviceExtensions.end());
+    };
+    // only requested on 1.1+, where the feature queries are core
+    auto getFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2) vkGetInstanceProcAddr(vkInstance, "vkGetPhysicalDeviceFeatures2");
+    if(getFeatures2 == nullptr){
+        dropExtension(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+        dropExtension(VK_EXT_EXTENDED_DYNAMIC_STATE_2_EXTENSION_NAME);
+        dropExtension(VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME);
+        return;
+    }
+
+    VkPhysicalDeviceExtendedDynamicStateFeaturesEXT supported{};
+    supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+    VkPhysicalDeviceExtendedDynamicState2FeaturesEXT supported2{};
+    supported2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_2_FEATURES_EXT;
+    VkPhysicalDeviceExtendedDynamicState3FeaturesEXT supported3{};
+    supported3.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT;
+    // only chain the structs of extensions the device has
+    VkPhysicalDeviceFeatures2 query{};
+    query.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    if(hasExtension(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME)){
+        supported.pNext = query.pNext;
+        query.pNext = &supported;
+    }
+    if(hasExtension(VK_EXT_EXTENDED_DYNAMIC_STATE_2_EXTENSION_NAME)){
+        supported2.pNext = query.pNext;
+        query.pNext = &supported2;
+    }
+    if(hasExtension(VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME)){
+        supported3.pNext = query.pNext;
+        query.pNext = &supported3;
+    }
+    getFeatures2(physicalDevice, &query);
+
+    features = {};
+    features2 = {};
+    features3 = {};
+    if(supported.extendedDynamicState){
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+        features.extendedDynamicState = VK_TRUE;
+        extendedDynamicStates.insert({VK_DYNAMIC_STATE_CULL_MODE_EXT, VK_DYNAMIC_STATE_FRONT_FACE_EXT, VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_EXT,
+            VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT, VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT, VK_DYNAMIC_STATE_DEPTH_COMPARE_OP_EXT});
+    }
+    else{
+        dropExtension(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+    }
+    if(supported2.extendedDynamicState2){
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_2_FEATURES_EXT;
+        features2.extendedDynamicState2 = VK_TRUE;
+        extendedDynamicStates.insert(VK_DYNAMIC_STATE_PRIMITIVE_RESTART_ENABLE_EXT);
+    }
+    else{
+        dropExtension(VK_EXT_EXTENDED_DYNAMIC_STATE_2_EXTENSION_NAME);
+    }
+    // the third one is a feature per state, take the ones the config can describe
+    if(supported3.extendedDynamicState3PolygonMode || supported3.extendedDynamicState3DepthClampEnable){
+        features3.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT;
+        features3.extendedDynamicState3PolygonMode = supported3.extendedDynamicState3PolygonMode;
+        features3.extendedDynamicState3DepthClampEnable = supported3.extendedDynamicState3DepthClampEnable;
+        if(supported3.extendedDynamicState3PolygonMode){
+            extendedDynamicStates.insert(VK_DYNAMIC_STATE_POLYGON_MODE_EXT);
+        }
+        if(supported3.extendedDynamicState3DepthClampEnable){
+            extendedDynamicStates.insert(VK_DYNAMIC_STATE_DEPTH_CLAMP_ENABLE_EXT);
+        }
+    }
+    else{
+        dropExtension(VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME);
+    }
+    VILLAINY_VERBOSE_LOG(logger, "Enabled " + std::to_string(extendedDynamicStates.size()) + " extended dynamic states.");
 }
 
 // ------------------------------------------------------------------------------------------------------
@@ -249,6 +773,42 @@ std::vector<const char*> Context::getRequiredExtensions(){
 
     return extensions;   
 }
+std::vector<const char*> Context::getDeviceExtensions(){
+    std::vector<const char*> extensions = config.deviceExts;
+    if(config.descriptorIndexing && config.apiVersion < VK_API_VERSION_1_2){
+        extensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+        extensions.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME); // required by descriptor indexing
+    }
+    return extensions;
+}
+std::vector<const char*> Context::getOptionalDeviceExtensions(){
+    std::vector<const char*> extensions;
+    if(config.descriptorUpdateTemplates && config.apiVersion < VK_API_VERSION_1_1){
+        extensions.push_back(VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME);
+    }
+    // needs VK_KHR_get_physical_device_properties2 below 1.1, only asked for when the instance could enable it
+    if(config.pushDescriptors && (config.apiVersion >= VK_API_VERSION_1_1 ||
+        instanceExtensionAvailable(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME))){
+        extensions.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+    }
+    // VK_EXT_descriptor_buffer depends on VK_KHR_synchronization2, which is only core from 1.3 on
+    if(config.descriptorBuffers && config.apiVersion >= VK_API_VERSION_1_3){
+        extensions.push_back(VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME);
+    }
+    if(config.pipelineLibraries && config.apiVersion >= VK_API_VERSION_1_1){
+        extensions.push_back(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+        extensions.push_back(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+    }
+    if(config.extendedDynamicState && config.apiVersion >= VK_API_VERSION_1_1){
+        extensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+        extensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_2_EXTENSION_NAME);
+        extensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME);
+    }
+    if(config.uint8Indices && config.apiVersion >= VK_API_VERSION_1_1){
+        extensions.push_back(VK_EXT_INDEX_TYPE_UINT8_EXTENSION_NAME);
+    }
+    return extensions;
+}
 int Context::ratePhysicalDevice(VkPhysicalDevice device, VkSurfaceKHR surface){
     int score = 0;
 
@@ -292,7 +852,8 @@ bool Context::deviceSupportsExtensions(VkPhysicalDevice device){
     std::vector<VkExtensionProperties> availableExtensions(extensionCount);
     vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
 
-    std::set<std::string> requiredExtensions(config.deviceExts.begin(), config.deviceExts.end());
+    std::vector<const char*> deviceExtensions = getDeviceExtensions();
+    std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
 
     for(const auto& extension : availableExtensions){
         requiredExtensions.erase(extension.extensionName);
@@ -16,6 +16,10 @@
 #include "logger.hpp"
 #include "utils.hpp"
 #include "command.hpp"
+#include "textureCache.hpp"
+#include "descriptorAllocator.hpp"
+#include "descriptorBuffer.hpp"
+#include "shaderCache.hpp"
 //#include "buffer.hpp"
 
 namespace vlny{
@@ -30,6 +34,13 @@ class GraphicsPipeline;
 struct CommandPool;
 class DescriptorManager;
 class Renderer;
+class UploadQueue;
+class TextureLoader;
+class DynamicTexture;
+class TextureStreamer;
+class BindlessTable;
+struct TextureConfig;
+struct TextureSource;
 
 struct QueueFamilyIndices{
     std::optional<uint32_t> graphicsFamily;
@@ -60,6 +71,20 @@ struct ContextConfig{
 
     std::vector<const char*> deviceExts = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
 
+    uint32_t apiVersion = VK_API_VERSION_1_0; // VK_API_VERSION_1_2 gets descriptor indexing without extensions
+    bool descriptorIndexing = false; // partially bound, update-after-bind descriptor arrays, needed by BindlessTable
+    bool pushDescriptors = true; // VK_KHR_push_descriptor when available, DescriptorManager::allowPushDescriptors uses it
+    bool descriptorUpdateTemplates = true; // used when available (1.1 or VK_KHR_descriptor_update_template), DescriptorManager falls back otherwise
+    bool descriptorBuffers = false; // VK_EXT_descriptor_buffer on 1.3+ when available, DescriptorManager::allowDescriptorBuffer uses it
+    VkDeviceSize descriptorBufferSize = 4ull * 1024 * 1024; // the DescriptorBufferHeap every descriptor buffer manager lives in
+    bool pipelineLibraries = false; // VK_EXT_graphics_pipeline_library on 1.1+ when available, used through PipelineLibraryCache
+    // VK_EXT_extended_dynamic_state(2/3) on 1.1+ when available, lets GraphicsPipelineConfig::dynamicStates hold cull mode,
+    // front face, topology, depth test, polygon mode, ... so one pipeline serves every combination
+    bool extendedDynamicState = false;
+    bool uint8Indices = true; // VK_EXT_index_type_uint8 on 1.1+ when available, IndexBuffer stores small meshes' indices as bytes
+
+    VkDeviceSize textureCacheBudget = 512ull * 1024 * 1024; // bytes of cached images before unreferenced ones get evicted
+
     bool macosDriverCompat = true;
 };
 
@@ -71,6 +96,34 @@ public:
     CommandPool& getTransientCommandPool();
     void waitIdle();
 
+    // shared, de-duplicated resources, usable once a window has created the device
+    std::shared_ptr<Texture> loadTexture(const std::string& path, const TextureConfig& config = {});
+    std::shared_ptr<Sampler> getSampler(const SamplerConfig& config = {});
+    TextureCache& getTextureCache();
+    SamplerCache& getSamplerCache();
+    // layouts are owned by the cache, sets from the allocator go back with DescriptorAllocator::free
+    VkDescriptorSetLayout getDescriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings, VkDescriptorSetLayoutCreateFlags flags = 0);
+    DescriptorLayoutCache& getDescriptorLayoutCache();
+    DescriptorAllocator& getDescriptorAllocator();
+    // every ShaderProgram loads its stages through it
+    ShaderModuleCache& getShaderModuleCache();
+    // only when supportsDescriptorBuffers()
+    DescriptorBufferHeap& getDescriptorBufferHeap();
+
+    // optional extensions are enabled on top of ContextConfig::deviceExts when the device has them
+    bool isDeviceExtensionEnabled(const std::string& name) const;
+    bool supportsPushDescriptors() const;
+    bool supportsDescriptorBuffers() const;
+    bool supportsPipelineLibraries() const;
+    // without it an unoptimized link can cost as much as a full compile
+    bool hasFastPipelineLinking() const;
+    // the core states always, extended ones when their extension and feature were enabled
+    bool supportsDynamicState(VkDynamicState state) const;
+    // multiDrawIndirect and drawIndirectFirstInstance, indirect draws with more than one command that pick their
+    // object through firstInstance
+    bool supportsMultiDrawIndirect() const;
+    bool supportsUint8Indices() const;
+
     Logger logger;
 
     Context& operator=(Context&& other);
@@ -89,8 +142,51 @@ private:
     VkQueue presentQueue;
 
     int maxAnisotropy = -1;
+    bool multiDrawIndirectEnabled = false;
+    bool indexTypeUint8Enabled = false;
+
+    bool descriptorIndexingEnabled = false;
+    uint32_t maxBindlessSampledImages = 0; // per stage update-after-bind limits
+    uint32_t maxBindlessStorageBuffers = 0;
+
+    std::set<std::string> enabledDeviceExtensions;
+
+    // null when neither core 1.1 nor VK_KHR_descriptor_update_template is available
+    PFN_vkCreateDescriptorUpdateTemplateKHR pfnCreateDescriptorUpdateTemplate = nullptr;
+    PFN_vkDestroyDescriptorUpdateTemplateKHR pfnDestroyDescriptorUpdateTemplate = nullptr;
+    PFN_vkUpdateDescriptorSetWithTemplateKHR pfnUpdateDescriptorSetWithTemplate = nullptr;
+    PFN_vkCmdPushDescriptorSetKHR pfnCmdPushDescriptorSet = nullptr;
+
+    bool descriptorBufferEnabled = false;
+    VkPhysicalDeviceDescriptorBufferPropertiesEXT descriptorBufferProperties{};
+    PFN_vkGetDescriptorSetLayoutSizeEXT pfnGetDescriptorSetLayoutSize = nullptr;
+    PFN_vkGetDescriptorSetLayoutBindingOffsetEXT pfnGetDescriptorSetLayoutBindingOffset = nullptr;
+    PFN_vkGetDescriptorEXT pfnGetDescriptor = nullptr;
+    PFN_vkCmdBindDescriptorBuffersEXT pfnCmdBindDescriptorBuffers = nullptr;
+    PFN_vkCmdSetDescriptorBufferOffsetsEXT pfnCmdSetDescriptorBufferOffsets = nullptr;
+    PFN_vkGetBufferDeviceAddress pfnGetBufferDeviceAddress = nullptr;
+
+    bool pipelineLibraryEnabled = false;
+    bool pipelineLibraryFastLinking = false;
+
+    std::set<VkDynamicState> extendedDynamicStates; // enabled and with their command loaded
+    PFN_vkCmdSetCullModeEXT pfnCmdSetCullMode = nullptr;
+    PFN_vkCmdSetFrontFaceEXT pfnCmdSetFrontFace = nullptr;
+    PFN_vkCmdSetPrimitiveTopologyEXT pfnCmdSetPrimitiveTopology = nullptr;
+    PFN_vkCmdSetDepthTestEnableEXT pfnCmdSetDepthTestEnable = nullptr;
+    PFN_vkCmdSetDepthWriteEnableEXT pfnCmdSetDepthWriteEnable = nullptr;
+    PFN_vkCmdSetDepthCompareOpEXT pfnCmdSetDepthCompareOp = nullptr;
+    PFN_vkCmdSetPrimitiveRestartEnableEXT pfnCmdSetPrimitiveRestartEnable = nullptr;
+    PFN_vkCmdSetPolygonModeEXT pfnCmdSetPolygonMode = nullptr;
+    PFN_vkCmdSetDepthClampEnableEXT pfnCmdSetDepthClampEnable = nullptr;
 
     std::optional<CommandPool> transientCommandPool;
+    std::optional<TextureCache> textureCache;
+    std::optional<SamplerCache> samplerCache;
+    std::optional<DescriptorLayoutCache> descriptorLayoutCache;
+    std::optional<DescriptorAllocator> descriptorAllocator;
+    std::optional<DescriptorBufferHeap> descriptorBufferHeap;
+    std::optional<ShaderModuleCache> shaderModuleCache;
 
     void baseInit();
     void renderInit(Window& window);
@@ -107,6 +203,17 @@ private:
     bool checkValidationLayerSupport();
 
     std::vector<const char*> getRequiredExtensions();
+    std::vector<const char*> getDeviceExtensions();
+    std::vector<const char*> getOptionalDeviceExtensions();
+    void loadDeviceFunctions();
+    bool instanceExtensionAvailable(const char* name);
+    void enableDescriptorIndexing(VkPhysicalDeviceDescriptorIndexingFeaturesEXT& features);
+    bool enableDescriptorBuffer(VkPhysicalDeviceDescriptorBufferFeaturesEXT& features, VkPhysicalDeviceBufferDeviceAddressFeatures& addressFeatures);
+    bool enablePipelineLibrary(VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT& features);
+    bool enableIndexTypeUint8(VkPhysicalDeviceIndexTypeUint8FeaturesEXT& features);
+    // drops the extensions whose features are missing from `deviceExtensions`
+    void enableExtendedDynamicState(std::vector<const char*>& deviceExtensions, VkPhysicalDeviceExtendedDynamicStateFeaturesEXT& features,
+        VkPhysicalDeviceExtendedDynamicState2FeaturesEXT& features2, VkPhysicalDeviceExtendedDynamicState3FeaturesEXT& features3);
     int ratePhysicalDevice(VkPhysicalDevice device, VkSurfaceKHR surface);
     bool deviceSupportsExtensions(VkPhysicalDevice device);
 
@@ -133,7 +240,25 @@ private:
     friend struct UniformBuffer;
     friend class DescriptorManager;
     friend class Renderer;
-    friend VkImageView makeImageView(Context& context, VkImage image, VkFormat format);
+    friend class UploadQueue;
+    friend class TextureLoader;
+    friend class DynamicTexture;
+    friend class TextureStreamer;
+    friend class BindlessTable;
+    friend class DescriptorLayoutCache;
+    friend class DescriptorAllocator;
+    friend class DescriptorBufferHeap;
+    friend class PipelineCache;
+    friend class PipelineLibraryCache;
+    friend class ShaderModule;
+    friend class UniformAllocator;
+    friend class ObjectTable;
+    friend VkImageView makeImageView(Context& context, VkImage image, VkFormat format, uint32_t mipLevels);
+    friend bool formatSupportsLinearBlit(Context& context, VkFormat format);
+    friend VkDeviceSize createImage(Context& context, uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format,
+        VkImageUsageFlags usage, VkImage& image, VkDeviceMemory& memory);
+    friend TextureSource loadTextureSource(Context& context, const std::string& path, const TextureConfig& config);
+    friend void createStagingBuffer(Context& context, const TextureSource& source, VkBuffer& buffer, VkDeviceMemory& memory);
     friend void createBuffer(Context& context, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
     friend void cleanup(Window* windows, int windowCount, Context& context);
     friend void cleanup(Window& window, Context& context);
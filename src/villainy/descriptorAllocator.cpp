@@ -0,0 +1,277 @@
+#include "descriptorAllocator.hpp"
+
+#include "context.hpp"
+
+#include <algorithm>
+
+namespace vlny{
+
+DescriptorLayoutCache::DescriptorLayoutCache(Context& context) : context(context) {}
+
+DescriptorLayoutCache::~DescriptorLayoutCache(){
+    clear();
+}
+
+bool DescriptorLayoutCache::keysEqual(const Key& a, const Key& b){
+    if(a.flags != b.flags || a.bindings.size() != b.bindings.size() || a.bindingFlags != b.bindingFlags ||
+        a.immutableSamplers != b.immutableSamplers){
+        return false;
+    }
+    for(size_t i = 0; i < a.bindings.size(); i++){
+        const VkDescriptorSetLayoutBinding& x = a.bindings[i];
+        const VkDescriptorSetLayoutBinding& y = b.bindings[i];
+        if(x.binding != y.binding || x.descriptorType != y.descriptorType || x.descriptorCount != y.descriptorCount ||
+            x.stageFlags != y.stageFlags){
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t DescriptorLayoutCache::hashKey(const Key& key){
+    size_t seed = 0;
+    hashCombine(seed, key.flags);
+    for(const VkDescriptorSetLayoutBinding& binding : key.bindings){
+        hashCombine(seed, binding.binding);
+        hashCombine(seed, static_cast<uint32_t>(binding.descriptorType));
+        hashCombine(seed, binding.descriptorCount);
+        hashCombine(seed, binding.stageFlags);
+    }
+    for(VkDescriptorBindingFlagsEXT flags : key.bindingFlags){
+        hashCombine(seed, flags);
+    }
+    for(const auto& [binding, sampler] : key.immutableSamplers){
+        hashCombine(seed, binding);
+        hashCombine(seed, sampler);
+    }
+    return seed;
+}
+
+VkDescriptorSetLayout DescriptorLayoutCache::get(const std::vector<VkDescriptorSetLayoutBinding>& bindings, VkDescriptorSetLayoutCreateFlags flags,
+    const std::vector<VkDescriptorBindingFlagsEXT>& bindingFlags){
+    if(!bindingFlags.empty() && bindingFlags.size() != bindings.size()){
+        throw std::runtime_error("Descriptor binding flags don't match the bindings!");
+    }
+
+    // sort by binding number so the same layout described in a different order still hits
+    std::vector<size_t> order(bindings.size());
+    for(size_t i = 0; i < order.size(); i++){
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b){ return bindings[a].binding < bindings[b].binding; });
+
+    Key key;
+    key.flags = flags;
+    std::vector<VkDescriptorSetLayoutBinding> sorted;
+    for(size_t i : order){
+        sorted.push_back(bindings[i]);
+        key.bindings.push_back(bindings[i]);
+        key.bindings.back().pImmutableSamplers = nullptr; // the caller's arrays aren't ours to keep pointing at
+        if(!bindingFlags.empty()){
+            key.bindingFlags.push_back(bindingFlags[i]);
+        }
+        if(bindings[i].pImmutableSamplers != nullptr){
+            for(uint32_t j = 0; j < bindings[i].descriptorCount; j++){
+                key.immutableSamplers.emplace_back(bindings[i].binding, bindings[i].pImmutableSamplers[j]);
+            }
+        }
+    }
+    size_t hash = hashKey(key);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& bucket = layouts[hash];
+    for(const auto& [existing, layout] : bucket){
+        if(keysEqual(existing, key)){
+            return layout;
+        }
+    }
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfoEXT flagsInfo{};
+    flagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+    flagsInfo.bindingCount = scast_ui32(key.bindingFlags.size());
+    flagsInfo.pBindingFlags = key.bindingFlags.data();
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = key.bindingFlags.empty() ? nullptr : &flagsInfo;
+    layoutInfo.flags = flags;
+    layoutInfo.bindingCount = scast_ui32(sorted.size());
+    layoutInfo.pBindings = sorted.data();
+
+    VkDescriptorSetLayout layout;
+    if(vkCreateDescriptorSetLayout(context.logicalDevice, &layoutInfo, nullptr, &layout) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create descriptor set layout!");
+    }
+    bucket.emplace_back(std::move(key), layout);
+    count++;
+    VILLAINY_VERBOSE_LOG(context.logger, "Created descriptor set layout (" + std::to_string(count) + " cached).");
+    return layout;
+}
+
+void DescriptorLayoutCache::clear(){
+    std::lock_guard<std::mutex> lock(mutex);
+    for(auto& [hash, bucket] : layouts){
+        for(auto& [key, layout] : bucket){
+            vkDestroyDescriptorSetLayout(context.logicalDevice, layout, nullptr);
+        }
+    }
+    layouts.clear();
+    count = 0;
+}
+
+size_t DescriptorLayoutCache::size() const{
+    std::lock_guard<std::mutex> lock(mutex);
+    return count;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+DescriptorAllocator::DescriptorAllocator(Context& context, bool freeable, uint32_t initialSetsPerPool, std::vector<DescriptorPoolRatio> ratios) :
+    context(context), freeable(freeable), setsPerPool(std::max(1u, initialSetsPerPool)), ratios(std::move(ratios)) {}
+
+DescriptorAllocator::~DescriptorAllocator(){
+    for(VkDescriptorPool pool : readyPools){
+        vkDestroyDescriptorPool(context.logicalDevice, pool, nullptr);
+    }
+    for(VkDescriptorPool pool : fullPools){
+        vkDestroyDescriptorPool(context.logicalDevice, pool, nullptr);
+    }
+}
+
+std::vector<DescriptorPoolRatio> DescriptorAllocator::defaultRatios(){
+    return {
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.0f},
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f},
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.0f},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f},
+        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f},
+        {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1.0f},
+        {VK_DESCRIPTOR_TYPE_SAMPLER, 1.0f}
+    };
+}
+
+VkDescriptorPool DescriptorAllocator::createPool(uint32_t sets){
+    std::vector<VkDescriptorPoolSize> poolSizes;
+    for(const DescriptorPoolRatio& ratio : ratios){
+        poolSizes.push_back({ratio.type, std::max(1u, static_cast<uint32_t>(ratio.perSet * sets))});
+    }
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = freeable ? VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT : 0;
+    poolInfo.maxSets = sets;
+    poolInfo.poolSizeCount = scast_ui32(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+
+    VkDescriptorPool pool;
+    if(vkCreateDescriptorPool(context.logicalDevice, &poolInfo, nullptr, &pool) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create descriptor pool!");
+    }
+    return pool;
+}
+
+VkDescriptorPool DescriptorAllocator::getPool(){
+    if(readyPools.empty()){
+        return addPool(1);
+    }
+    return readyPools.back();
+}
+
+VkDescriptorPool DescriptorAllocator::addPool(uint32_t minSets){
+    readyPools.push_back(createPool(std::max(setsPerPool, minSets)));
+    // grow so a scene with thousands of sets ends up with a handful of pools, not hundreds
+    setsPerPool = std::min(maxSetsPerPool, setsPerPool + setsPerPool / 2);
+    return readyPools.back();
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout){
+    VkDescriptorSet set;
+    allocate(layout, 1, &set);
+    return set;
+}
+
+void DescriptorAllocator::allocate(VkDescriptorSetLayout layout, uint32_t count, VkDescriptorSet* sets){
+    std::vector<VkDescriptorSetLayout> layouts(count, layout);
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorSetCount = count;
+    allocInfo.pSetLayouts = layouts.data();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    VkDescriptorPool pool = getPool();
+    allocInfo.descriptorPool = pool;
+    VkResult result = vkAllocateDescriptorSets(context.logicalDevice, &allocInfo, sets);
+    if(result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL){
+        // retire the exhausted pool and retry once on a new one, another ready pool could be just as short
+        readyPools.pop_back();
+        fullPools.push_back(pool);
+        pool = addPool(count);
+        allocInfo.descriptorPool = pool;
+        result = vkAllocateDescriptorSets(context.logicalDevice, &allocInfo, sets);
+    }
+    if(result != VK_SUCCESS){
+        throw std::runtime_error("Failed to allocate descriptor sets!");
+    }
+
+    if(freeable){
+        for(uint32_t i = 0; i < count; i++){
+            owners[sets[i]] = pool;
+        }
+    }
+}
+
+void DescriptorAllocator::free(VkDescriptorSet set){
+    free(1, &set);
+}
+
+void DescriptorAllocator::free(uint32_t count, const VkDescriptorSet* sets){
+    if(!freeable){
+        throw std::runtime_error("Descriptor allocator doesn't support freeing single sets!");
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for(uint32_t i = 0; i < count; i++){
+        auto it = owners.find(sets[i]);
+        if(it == owners.end()){
+            continue;
+        }
+        VkDescriptorPool pool = it->second;
+        vkFreeDescriptorSets(context.logicalDevice, pool, 1, &sets[i]);
+        owners.erase(it);
+
+        // a full pool has room again, put it behind the current one
+        auto full = std::find(fullPools.begin(), fullPools.end(), pool);
+        if(full != fullPools.end()){
+            fullPools.erase(full);
+            readyPools.insert(readyPools.begin(), pool);
+        }
+    }
+}
+
+void DescriptorAllocator::reset(){
+    std::lock_guard<std::mutex> lock(mutex);
+    for(VkDescriptorPool pool : readyPools){
+        vkResetDescriptorPool(context.logicalDevice, pool, 0);
+    }
+    for(VkDescriptorPool pool : fullPools){
+        vkResetDescriptorPool(context.logicalDevice, pool, 0);
+        readyPools.push_back(pool);
+    }
+    fullPools.clear();
+    owners.clear();
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+FrameDescriptorAllocator::FrameDescriptorAllocator(Context& context, Window& window, uint32_t initialSetsPerPool){
+    for(int i = 0; i < window.getConfig().maxFramesInFlight; i++){
+        allocators.push_back(std::make_unique<DescriptorAllocator>(context, false, initialSetsPerPool));
+    }
+}
+
+VkDescriptorSet FrameDescriptorAllocator::allocate(uint32_t frame, VkDescriptorSetLayout layout){
+    return allocators[frame]->allocate(layout);
+}
+
+}
@@ -0,0 +1,119 @@
+#ifndef VILLAINY_DESCRIPTOR_ALLOCATOR
+#define VILLAINY_DESCRIPTOR_ALLOCATOR
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "command.hpp"
+#include "window.hpp"
+
+namespace vlny{
+
+class Context;
+
+// one VkDescriptorSetLayout per distinct binding list, identical layouts are also compatible for binding purposes
+// so a ShaderProgram and a UniformBuffer describing the same bindings end up with the same handle
+// layouts live until clear() (or the context's cleanup), callers never destroy them
+class DescriptorLayoutCache{
+public:
+    DescriptorLayoutCache(Context& context);
+    ~DescriptorLayoutCache();
+
+    DescriptorLayoutCache(const DescriptorLayoutCache&) = delete;
+    DescriptorLayoutCache& operator=(const DescriptorLayoutCache&) = delete;
+
+    // binding order doesn't matter, `bindingFlags` (descriptor indexing) is parallel to `bindings` when given
+    VkDescriptorSetLayout get(const std::vector<VkDescriptorSetLayoutBinding>& bindings, VkDescriptorSetLayoutCreateFlags flags = 0,
+        const std::vector<VkDescriptorBindingFlagsEXT>& bindingFlags = {});
+
+    void clear();
+    size_t size() const;
+private:
+    Context& context;
+
+    struct Key{
+        std::vector<VkDescriptorSetLayoutBinding> bindings; // sorted by binding, pImmutableSamplers cleared
+        std::vector<VkDescriptorBindingFlagsEXT> bindingFlags;
+        std::vector<std::pair<uint32_t, VkSampler>> immutableSamplers; // binding, sampler
+        VkDescriptorSetLayoutCreateFlags flags;
+    };
+    static bool keysEqual(const Key& a, const Key& b);
+    static size_t hashKey(const Key& key);
+
+    // hash -> layouts that landed in it, compared on lookup
+    std::unordered_map<size_t, std::vector<std::pair<Key, VkDescriptorSetLayout>>> layouts;
+    size_t count = 0;
+    mutable std::mutex mutex;
+};
+
+struct DescriptorPoolRatio{
+    VkDescriptorType type;
+    float perSet; // descriptors of this type reserved per set in each pool
+};
+
+// hands out descriptor sets from a chain of pools, a new (bigger) pool is added whenever the current one runs dry
+// instead of every owner sizing its own pool for exactly its own sets
+//
+// `freeable` allocators accept free() for single sets (Context::getDescriptorAllocator is one), the rest are only
+// ever reset() as a whole, which is what FrameDescriptorAllocator does every frame
+class DescriptorAllocator{
+public:
+    DescriptorAllocator(Context& context, bool freeable = false, uint32_t initialSetsPerPool = 64,
+        std::vector<DescriptorPoolRatio> ratios = defaultRatios());
+    ~DescriptorAllocator();
+
+    DescriptorAllocator(const DescriptorAllocator&) = delete;
+    DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+
+    VkDescriptorSet allocate(VkDescriptorSetLayout layout);
+    void allocate(VkDescriptorSetLayout layout, uint32_t count, VkDescriptorSet* sets);
+    void free(VkDescriptorSet set);
+    void free(uint32_t count, const VkDescriptorSet* sets);
+    // every set handed out so far becomes invalid, the pools are kept for reuse
+    void reset();
+
+    size_t poolCount() const { return readyPools.size() + fullPools.size(); }
+
+    static std::vector<DescriptorPoolRatio> defaultRatios();
+private:
+    Context& context;
+    bool freeable;
+    uint32_t setsPerPool;
+    std::vector<DescriptorPoolRatio> ratios;
+
+    static constexpr uint32_t maxSetsPerPool = 4096;
+
+    std::vector<VkDescriptorPool> readyPools; // back() is the one allocations go to
+    std::vector<VkDescriptorPool> fullPools;
+    std::unordered_map<VkDescriptorSet, VkDescriptorPool> owners; // only tracked when freeable
+    std::mutex mutex;
+
+    VkDescriptorPool getPool();
+    VkDescriptorPool addPool(uint32_t minSets); // fresh, becomes the one allocations go to
+    VkDescriptorPool createPool(uint32_t sets);
+};
+
+// transient sets that only have to live for one frame (per-draw material sets etc)
+// each frame in flight allocates from its own DescriptorAllocator which is reset wholesale in prepareFrame,
+// register with Renderer::addFrameResource
+class FrameDescriptorAllocator : public FrameResource{
+public:
+    FrameDescriptorAllocator(Context& context, Window& window, uint32_t initialSetsPerPool = 64);
+
+    VkDescriptorSet allocate(uint32_t frame, VkDescriptorSetLayout layout);
+    DescriptorAllocator& get(uint32_t frame) { return *allocators[frame]; }
+
+    void prepareFrame(uint32_t frame) override { allocators[frame]->reset(); }
+private:
+    std::vector<std::unique_ptr<DescriptorAllocator>> allocators;
+};
+
+}
+
+#endif
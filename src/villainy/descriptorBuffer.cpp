@@ -0,0 +1,92 @@
+#include "descriptorBuffer.hpp"
+
+#include "context.hpp"
+#include "buffer.hpp"
+
+#include <algorithm>
+
+namespace vlny{
+
+DescriptorBufferHeap::DescriptorBufferHeap(Context& context, VkDeviceSize size) : context(context) {
+    const VkPhysicalDeviceDescriptorBufferPropertiesEXT& properties = context.descriptorBufferProperties;
+    alignment = std::max<VkDeviceSize>(1, properties.descriptorBufferOffsetAlignment);
+    // combined image samplers need the sampler usage, which has the tighter range limit
+    this->size = std::min({size, properties.maxResourceDescriptorBufferRange, properties.maxSamplerDescriptorBufferRange});
+
+    usage = VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT | VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT |
+        VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+    createBuffer(context, this->size, usage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        buffer, memory);
+    void* data;
+    vkMapMemory(context.logicalDevice, memory, 0, this->size, 0, &data);
+    mapped = static_cast<uint8_t*>(data);
+
+    VkBufferDeviceAddressInfo addressInfo{};
+    addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+    addressInfo.buffer = buffer;
+    address = context.pfnGetBufferDeviceAddress(context.logicalDevice, &addressInfo);
+
+    freeBlocks[0] = this->size;
+    VILLAINY_VERBOSE_LOG(context.logger, "Made descriptor buffer heap (" + std::to_string(this->size) + " bytes).");
+}
+
+DescriptorBufferHeap::~DescriptorBufferHeap(){
+    if(mapped != nullptr){
+        vkUnmapMemory(context.logicalDevice, memory);
+    }
+    if(buffer != VK_NULL_HANDLE){
+        vkDestroyBuffer(context.logicalDevice, buffer, nullptr);
+    }
+    if(memory != VK_NULL_HANDLE){
+        vkFreeMemory(context.logicalDevice, memory, nullptr);
+    }
+}
+
+VkDeviceSize DescriptorBufferHeap::allocate(VkDeviceSize size){
+    std::lock_guard<std::mutex> lock(mutex);
+    size = (size + alignment - 1) / alignment * alignment;
+
+    // first fit, blocks always start and end on the alignment so nothing is lost to padding
+    for(auto it = freeBlocks.begin(); it != freeBlocks.end(); ++it){
+        if(it->second < size){
+            continue;
+        }
+        VkDeviceSize offset = it->first;
+        VkDeviceSize remaining = it->second - size;
+        freeBlocks.erase(it);
+        if(remaining > 0){
+            freeBlocks[offset + size] = remaining;
+        }
+        return offset;
+    }
+    throw std::runtime_error("Descriptor buffer heap is full, raise ContextConfig::descriptorBufferSize!");
+}
+
+void DescriptorBufferHeap::free(VkDeviceSize offset, VkDeviceSize size){
+    std::lock_guard<std::mutex> lock(mutex);
+    size = (size + alignment - 1) / alignment * alignment;
+
+    auto it = freeBlocks.emplace(offset, size).first;
+    auto next = std::next(it);
+    if(next != freeBlocks.end() && it->first + it->second == next->first){
+        it->second += next->second;
+        freeBlocks.erase(next);
+    }
+    if(it != freeBlocks.begin()){
+        auto prev = std::prev(it);
+        if(prev->first + prev->second == it->first){
+            prev->second += it->second;
+            freeBlocks.erase(it);
+        }
+    }
+}
+
+void DescriptorBufferHeap::bind(VkCommandBuffer commandBuffer) const{
+    VkDescriptorBufferBindingInfoEXT bindingInfo{};
+    bindingInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_BUFFER_BINDING_INFO_EXT;
+    bindingInfo.address = address;
+    bindingInfo.usage = usage;
+    context.pfnCmdBindDescriptorBuffers(commandBuffer, 1, &bindingInfo);
+}
+
+}
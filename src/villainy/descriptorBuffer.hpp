@@ -0,0 +1,56 @@
+#ifndef VILLAINY_DESCRIPTOR_BUFFER
+#define VILLAINY_DESCRIPTOR_BUFFER
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+namespace vlny{
+
+class Context;
+
+// one persistently mapped VK_EXT_descriptor_buffer shared by every DescriptorManager in descriptor buffer mode
+// managers carve fixed ranges out of it and write descriptors straight into the mapping, there are no pools or sets
+// bind() makes it descriptor buffer 0 of a command buffer, after that draws only move offsets
+// (vkCmdSetDescriptorBufferOffsetsEXT), so it is bound once per frame instead of once per set
+//
+// owned by the context, only exists when Context::supportsDescriptorBuffers()
+class DescriptorBufferHeap{
+public:
+    DescriptorBufferHeap(Context& context, VkDeviceSize size);
+    ~DescriptorBufferHeap();
+
+    DescriptorBufferHeap(const DescriptorBufferHeap&) = delete;
+    DescriptorBufferHeap& operator=(const DescriptorBufferHeap&) = delete;
+
+    // offsets are aligned to descriptorBufferOffsetAlignment, hand the same size back to free()
+    VkDeviceSize allocate(VkDeviceSize size);
+    void free(VkDeviceSize offset, VkDeviceSize size);
+
+    void bind(VkCommandBuffer commandBuffer) const;
+
+    uint8_t* getMapped() const { return mapped; }
+    VkDeviceSize getAlignment() const { return alignment; }
+    VkDeviceSize getSize() const { return size; }
+private:
+    Context& context;
+    VkDeviceSize size;
+    VkDeviceSize alignment = 1;
+
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    uint8_t* mapped = nullptr;
+    VkDeviceAddress address = 0;
+    VkBufferUsageFlags usage = 0;
+
+    std::map<VkDeviceSize, VkDeviceSize> freeBlocks; // offset -> size, neighbours are merged on free
+    std::mutex mutex;
+};
+
+}
+
+#endif
@@ -3,6 +3,8 @@
 #include "context.hpp"
 #include "texture.hpp"
 
+#include <algorithm>
+
 namespace vlny{
 
 DescriptorManager::DescriptorManager(Context& context, Window& window) : context(context), maxFramesInFlight(window.getConfig().maxFramesInFlight) {}
@@ -95,6 +97,22 @@ DescriptorManager& DescriptorManager::addExternalBuffer(uint32_t binding, VkShad
     return *this;
 }
 
+DescriptorManager& DescriptorManager::allowPushDescriptors(bool allow) {
+    if (isBuilt) {
+        throw std::runtime_error("Cannot change push descriptors after build() has been called!");
+    }
+    pushAllowed = allow;
+    return *this;
+}
+
+DescriptorManager& DescriptorManager::allowDescriptorBuffer(bool allow) {
+    if (isBuilt) {
+        throw std::runtime_error("Cannot change the descriptor buffer backend after build() has been called!");
+    }
+    bufferAllowed = allow;
+    return *this;
+}
+
 void DescriptorManager::build() {
     if (isBuilt) {
         throw std::runtime_error("build() has already been called!");
@@ -104,6 +122,16 @@ void DescriptorManager::build() {
         throw std::runtime_error("No bindings added before build()!");
     }
     
+    // Decided first, the buffers below need device addresses when their descriptors live in a descriptor buffer
+    bufferBacked = bufferAllowed && context.supportsDescriptorBuffers();
+    if (bufferBacked) {
+        for (const auto& binding : bindings) {
+            if (binding.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC || binding.type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC) {
+                throw std::runtime_error("Dynamic buffers can't live in a descriptor buffer!");
+            }
+        }
+    }
+    
     // Create buffers for uniform and storage buffers
     for (const auto& binding : bindings) {
         if (binding.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) {
@@ -113,9 +141,17 @@ void DescriptorManager::build() {
         }
     }
     
+    uint32_t descriptorCount = 0;
+    for (const auto& binding : bindings) {
+        descriptorCount += binding.descriptorCount;
+    }
+    pushed = !bufferBacked && pushAllowed && context.supportsPushDescriptors() && descriptorCount <= maxPushDescriptors;
+    
     createDescriptorSetLayout();
-    createDescriptorPool();
     allocateDescriptorSets();
+    allocateDescriptorBuffer();
+    fillDescriptorInfos();
+    createUpdateTemplate();
     updateDescriptorSets();
     
     isBuilt = true;
@@ -123,13 +159,14 @@ void DescriptorManager::build() {
 
 void DescriptorManager::createUniformBuffer(uint32_t binding, VkDeviceSize bufferSize) {
     UniformBufferData ubo;
+    ubo.size = bufferSize;
     ubo.buffers.resize(maxFramesInFlight);
     ubo.memory.resize(maxFramesInFlight);
     ubo.mapped.resize(maxFramesInFlight);
     
     for (uint32_t i = 0; i < maxFramesInFlight; i++) {
         createBuffer(context, bufferSize,
-                    VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                    VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | (bufferBacked ? VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT : 0),
                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
                     ubo.buffers[i], ubo.memory[i]);
         
@@ -147,7 +184,7 @@ void DescriptorManager::createStorageBuffer(uint32_t binding, VkDeviceSize buffe
     
     for (uint32_t i = 0; i < maxFramesInFlight; i++) {
         createBuffer(context, bufferSize,
-                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | (bufferBacked ? VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT : 0),
                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
                     sbo.buffers[i], sbo.memory[i]);
         
@@ -171,121 +208,155 @@ void DescriptorManager::createDescriptorSetLayout() {
         layoutBindings.push_back(layoutBinding);
     }
     
-    VkDescriptorSetLayoutCreateInfo layoutInfo{};
-    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutInfo.bindingCount = static_cast<uint32_t>(layoutBindings.size());
-    layoutInfo.pBindings = layoutBindings.data();
-    
-    if (vkCreateDescriptorSetLayout(context.logicalDevice, &layoutInfo, nullptr, 
-                                   &descriptorSetLayout) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create descriptor set layout!");
+    // Shared with every other user of the same bindings, owned by the context's cache
+    VkDescriptorSetLayoutCreateFlags flags = 0;
+    if (bufferBacked) {
+        flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT;
+    } else if (pushed) {
+        flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR;
     }
+    descriptorSetLayout = context.getDescriptorSetLayout(layoutBindings, flags);
 }
 
-void DescriptorManager::createDescriptorPool() {
-    // Count descriptor types
-    std::map<VkDescriptorType, uint32_t> descriptorCounts;
-    for (const auto& binding : bindings) {
-        descriptorCounts[binding.type] += binding.descriptorCount;
-    }
-    
-    // Create pool sizes
-    std::vector<VkDescriptorPoolSize> poolSizes;
-    for (const auto& [type, count] : descriptorCounts) {
-        VkDescriptorPoolSize poolSize{};
-        poolSize.type = type;
-        poolSize.descriptorCount = count * maxFramesInFlight;
-        poolSizes.push_back(poolSize);
+void DescriptorManager::allocateDescriptorSets() {
+    if (pushed || bufferBacked) {
+        return; // Nothing to allocate, bind() pushes the descriptors or points at the descriptor buffer
     }
     
-    VkDescriptorPoolCreateInfo poolInfo{};
-    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-    poolInfo.pPoolSizes = poolSizes.data();
-    poolInfo.maxSets = maxFramesInFlight;
-    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT; // Allow updating
-    
-    if (vkCreateDescriptorPool(context.logicalDevice, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create descriptor pool!");
-    }
+    // Sets come from the context's pool chain instead of a pool sized for this manager alone
+    descriptorSets.resize(maxFramesInFlight);
+    context.getDescriptorAllocator().allocate(descriptorSetLayout, maxFramesInFlight, descriptorSets.data());
 }
 
-void DescriptorManager::allocateDescriptorSets() {
-    std::vector<VkDescriptorSetLayout> layouts(maxFramesInFlight, descriptorSetLayout);
+void DescriptorManager::allocateDescriptorBuffer() {
+    if (!bufferBacked) {
+        return;
+    }
     
-    VkDescriptorSetAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = descriptorPool;
-    allocInfo.descriptorSetCount = maxFramesInFlight;
-    allocInfo.pSetLayouts = layouts.data();
+    DescriptorBufferHeap& heap = context.getDescriptorBufferHeap();
+    VkDeviceSize layoutSize = 0;
+    context.pfnGetDescriptorSetLayoutSize(context.logicalDevice, descriptorSetLayout, &layoutSize);
     
-    descriptorSets.resize(maxFramesInFlight);
-    if (vkAllocateDescriptorSets(context.logicalDevice, &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to allocate descriptor sets!");
+    // Every frame's copy starts on the offset alignment so bind() can point straight at it
+    frameStride = (layoutSize + heap.getAlignment() - 1) / heap.getAlignment() * heap.getAlignment();
+    heapOffset = heap.allocate(frameStride * maxFramesInFlight);
+    
+    for (const auto& binding : bindings) {
+        VkDeviceSize offset = 0;
+        context.pfnGetDescriptorSetLayoutBindingOffset(context.logicalDevice, descriptorSetLayout, binding.binding, &offset);
+        bindingOffsets[binding.binding] = offset;
     }
 }
 
-void DescriptorManager::updateDescriptorSets() {
+void DescriptorManager::fillDescriptorInfos() {
+    // One slot per descriptor, laid out binding after binding in the order they were added
+    size_t slotCount = 0;
+    templateSlots.clear();
+    for (const auto& binding : bindings) {
+        templateSlots[binding.binding] = slotCount;
+        slotCount += binding.descriptorCount;
+    }
+    
+    boundImages.assign(maxFramesInFlight, {});
+    descriptorInfos.assign(maxFramesInFlight, std::vector<DescriptorInfo>(slotCount));
     for (uint32_t frame = 0; frame < maxFramesInFlight; frame++) {
-        std::vector<VkWriteDescriptorSet> descriptorWrites;
-        std::vector<VkDescriptorBufferInfo> bufferInfos;
-        std::vector<VkDescriptorImageInfo> imageInfos;
-        
-        // Reserve space to prevent reallocation
-        bufferInfos.reserve(bindings.size());
-        imageInfos.reserve(bindings.size());
-        
         for (const auto& binding : bindings) {
-            VkWriteDescriptorSet descriptorWrite{};
-            descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptorWrite.dstSet = descriptorSets[frame];
-            descriptorWrite.dstBinding = binding.binding;
-            descriptorWrite.dstArrayElement = 0;
-            descriptorWrite.descriptorType = binding.type;
-            descriptorWrite.descriptorCount = binding.descriptorCount;
+            DescriptorInfo info{};
             
             if (binding.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) {
-                VkDescriptorBufferInfo bufferInfo{};
-                bufferInfo.buffer = uniformBuffers[binding.binding].buffers[frame];
-                bufferInfo.offset = 0;
-                bufferInfo.range = binding.bufferSize;
-                bufferInfos.push_back(bufferInfo);
-                descriptorWrite.pBufferInfo = &bufferInfos.back();
+                info.buffer.buffer = uniformBuffers[binding.binding].buffers[frame];
+                info.buffer.offset = 0;
+                info.buffer.range = binding.bufferSize;
             }
-            else if (binding.type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER) {
-                VkDescriptorBufferInfo bufferInfo{};
-                bufferInfo.buffer = storageBuffers[binding.binding].buffers[frame];
-                bufferInfo.offset = 0;
-                bufferInfo.range = binding.bufferSize;
-                bufferInfos.push_back(bufferInfo);
-                descriptorWrite.pBufferInfo = &bufferInfos.back();
+            else if (binding.type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER && binding.externalBuffer == VK_NULL_HANDLE) {
+                info.buffer.buffer = storageBuffers[binding.binding].buffers[frame];
+                info.buffer.offset = 0;
+                info.buffer.range = binding.bufferSize;
             }
             else if (binding.type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER) {
-                VkDescriptorImageInfo imageInfo{};
-                imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-                imageInfo.imageView = binding.texture->imageView;
-                imageInfo.sampler = binding.sampler->vkSampler;
-                imageInfos.push_back(imageInfo);
-                descriptorWrite.pImageInfo = &imageInfos.back();
+                info.image.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+                info.image.imageView = binding.texture->imageView;
+                info.image.sampler = binding.sampler->vkSampler;
+                boundImages[frame][binding.binding] = {binding.texture, binding.sampler, binding.type, binding.texture->getGeneration()};
             }
             else if (binding.type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE) {
-                VkDescriptorImageInfo imageInfo{};
-                imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-                imageInfo.imageView = binding.texture->imageView;
-                imageInfo.sampler = VK_NULL_HANDLE;
-                imageInfos.push_back(imageInfo);
-                descriptorWrite.pImageInfo = &imageInfos.back();
+                info.image.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+                info.image.imageView = binding.texture->imageView;
+                info.image.sampler = VK_NULL_HANDLE;
+                boundImages[frame][binding.binding] = {binding.texture, nullptr, binding.type, binding.texture->getGeneration()};
             }
             else if (binding.externalBuffer != VK_NULL_HANDLE) {
-                VkDescriptorBufferInfo bufferInfo{};
-                bufferInfo.buffer = binding.externalBuffer;
-                bufferInfo.offset = 0;
-                bufferInfo.range = binding.externalBufferSize;
-                bufferInfos.push_back(bufferInfo);
-                descriptorWrite.pBufferInfo = &bufferInfos.back();
+                info.buffer.buffer = binding.externalBuffer;
+                info.buffer.offset = 0;
+                info.buffer.range = binding.externalBufferSize;
             }
             
-            descriptorWrites.push_back(descriptorWrite);
+            size_t slot = templateSlot(binding.binding);
+            std::fill_n(descriptorInfos[frame].begin() + slot, binding.descriptorCount, info);
+        }
+    }
+}
+
+// Throws for unknown bindings instead of letting them alias slot 0, which may hold another binding's buffer info
+size_t DescriptorManager::templateSlot(uint32_t binding) const {
+    auto it = templateSlots.find(binding);
+    if (it == templateSlots.end()) {
+        throw std::runtime_error("Descriptor binding not found!");
+    }
+    return it->second;
+}
+
+void DescriptorManager::createUpdateTemplate() {
+    if (pushed || bufferBacked || context.pfnCreateDescriptorUpdateTemplate == nullptr) {
+        return; // Plain vkUpdateDescriptorSets from the same packed data
+    }
+    
+    std::vector<VkDescriptorUpdateTemplateEntryKHR> entries;
+    for (const auto& binding : bindings) {
+        VkDescriptorUpdateTemplateEntryKHR entry{};
+        entry.dstBinding = binding.binding;
+        entry.dstArrayElement = 0;
+        entry.descriptorCount = binding.descriptorCount;
+        entry.descriptorType = binding.type;
+        entry.offset = templateSlot(binding.binding) * sizeof(DescriptorInfo);
+        entry.stride = sizeof(DescriptorInfo);
+        entries.push_back(entry);
+    }
+    
+    VkDescriptorUpdateTemplateCreateInfoKHR templateInfo{};
+    templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO_KHR;
+    templateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+    templateInfo.pDescriptorUpdateEntries = entries.data();
+    templateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET_KHR;
+    templateInfo.descriptorSetLayout = descriptorSetLayout;
+    
+    if (context.pfnCreateDescriptorUpdateTemplate(context.logicalDevice, &templateInfo, nullptr, &updateTemplate) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create descriptor update template!");
+    }
+}
+
+void DescriptorManager::updateDescriptorSets() {
+    if (pushed) {
+        return;
+    }
+    
+    for (uint32_t frame = 0; frame < maxFramesInFlight; frame++) {
+        if (bufferBacked) {
+            for (const auto& binding : bindings) {
+                writeDescriptorBuffer(frame, binding.binding, binding.type, binding.descriptorCount);
+            }
+            continue;
+        }
+        
+        if (updateTemplate != VK_NULL_HANDLE) {
+            context.pfnUpdateDescriptorSetWithTemplate(context.logicalDevice, descriptorSets[frame], updateTemplate,
+                                                       descriptorInfos[frame].data());
+            continue;
+        }
+        
+        std::vector<VkWriteDescriptorSet> descriptorWrites;
+        for (const auto& binding : bindings) {
+            descriptorWrites.push_back(makeWrite(frame, binding.binding, binding.type, binding.descriptorCount));
         }
         
         vkUpdateDescriptorSets(context.logicalDevice, 
@@ -294,6 +365,104 @@ void DescriptorManager::updateDescriptorSets() {
     }
 }
 
+VkWriteDescriptorSet DescriptorManager::makeWrite(uint32_t frame, uint32_t binding, VkDescriptorType type, uint32_t count) {
+    DescriptorInfo* info = &descriptorInfos[frame][templateSlot(binding)];
+    
+    VkWriteDescriptorSet descriptorWrite{};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = pushed ? VK_NULL_HANDLE : descriptorSets[frame]; // Ignored when pushed
+    descriptorWrite.dstBinding = binding;
+    descriptorWrite.dstArrayElement = 0;
+    descriptorWrite.descriptorType = type;
+    descriptorWrite.descriptorCount = count;
+    // The union makes both arrays share the packed slots, Vulkan only reads the one matching the type
+    if (type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER || type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE ||
+        type == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE || type == VK_DESCRIPTOR_TYPE_SAMPLER) {
+        descriptorWrite.pImageInfo = &info->image;
+    }
+    else {
+        descriptorWrite.pBufferInfo = &info->buffer;
+    }
+    return descriptorWrite;
+}
+
+void DescriptorManager::writeDescriptorBuffer(uint32_t frame, uint32_t binding, VkDescriptorType type, uint32_t count) {
+    size_t size = descriptorSize(type);
+    uint8_t* dst = context.getDescriptorBufferHeap().getMapped() + heapOffset + frame * frameStride + bindingOffsets[binding];
+    const DescriptorInfo* infos = &descriptorInfos[frame][templateSlot(binding)];
+    
+    // Without combinedImageSamplerDescriptorSingleArray a combined image sampler array is stored as all its images
+    // followed by all its samplers, the split point depends on the binding's full array size
+    const VkPhysicalDeviceDescriptorBufferPropertiesEXT& properties = context.descriptorBufferProperties;
+    uint32_t arraySize = count;
+    bool splitArray = false;
+    if (type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER && !properties.combinedImageSamplerDescriptorSingleArray) {
+        auto it = std::find_if(bindings.begin(), bindings.end(),
+                               [binding](const DescriptorBinding& b) { return b.binding == binding; });
+        arraySize = it->descriptorCount;
+        splitArray = arraySize > 1;
+    }
+    
+    for (uint32_t i = 0; i < count; i++) {
+        VkDescriptorGetInfoEXT getInfo{};
+        getInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT;
+        getInfo.type = type;
+        
+        if (splitArray) {
+            size_t imageSize = properties.sampledImageDescriptorSize;
+            size_t samplerSize = properties.samplerDescriptorSize;
+            getInfo.type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            getInfo.data.pSampledImage = &infos[i].image;
+            context.pfnGetDescriptor(context.logicalDevice, &getInfo, imageSize, dst + i * imageSize);
+            getInfo.type = VK_DESCRIPTOR_TYPE_SAMPLER;
+            getInfo.data.pSampler = &infos[i].image.sampler;
+            context.pfnGetDescriptor(context.logicalDevice, &getInfo, samplerSize,
+                                     dst + arraySize * imageSize + i * samplerSize);
+            continue;
+        }
+        
+        VkDescriptorAddressInfoEXT addressInfo{};
+        if (type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER) {
+            getInfo.data.pCombinedImageSampler = &infos[i].image;
+        } else if (type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE) {
+            getInfo.data.pStorageImage = &infos[i].image;
+        } else if (type == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE) {
+            getInfo.data.pSampledImage = &infos[i].image;
+        } else if (type == VK_DESCRIPTOR_TYPE_SAMPLER) {
+            getInfo.data.pSampler = &infos[i].image.sampler;
+        } else {
+            VkBufferDeviceAddressInfo bufferAddress{};
+            bufferAddress.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+            bufferAddress.buffer = infos[i].buffer.buffer;
+            addressInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_ADDRESS_INFO_EXT;
+            addressInfo.address = context.pfnGetBufferDeviceAddress(context.logicalDevice, &bufferAddress) + infos[i].buffer.offset;
+            addressInfo.range = infos[i].buffer.range;
+            addressInfo.format = VK_FORMAT_UNDEFINED;
+            if (type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) {
+                getInfo.data.pUniformBuffer = &addressInfo;
+            } else {
+                getInfo.data.pStorageBuffer = &addressInfo;
+            }
+        }
+        
+        // Straight into mapped memory, the frame's previous submission has finished reading it
+        context.pfnGetDescriptor(context.logicalDevice, &getInfo, size, dst + i * size);
+    }
+}
+
+size_t DescriptorManager::descriptorSize(VkDescriptorType type) const {
+    const VkPhysicalDeviceDescriptorBufferPropertiesEXT& properties = context.descriptorBufferProperties;
+    switch (type) {
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER: return properties.uniformBufferDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER: return properties.storageBufferDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER: return properties.combinedImageSamplerDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE: return properties.storageImageDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE: return properties.sampledImageDescriptorSize;
+        case VK_DESCRIPTOR_TYPE_SAMPLER: return properties.samplerDescriptorSize;
+        default: throw std::runtime_error("Descriptor type isn't supported in a descriptor buffer!");
+    }
+}
+
 void DescriptorManager::updateUniformBuffer(uint32_t binding, uint32_t frame, const void* data, 
                                            VkDeviceSize size) {
     if (!isBuilt) {
@@ -305,17 +474,7 @@ void DescriptorManager::updateUniformBuffer(uint32_t binding, uint32_t frame, co
         throw std::runtime_error("Uniform buffer binding not found!");
     }
     
-    // Find the actual buffer size
-    VkDeviceSize actualSize = size;
-    if (size == 0) {
-        for (const auto& b : bindings) {
-            if (b.binding == binding && b.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) {
-                actualSize = b.bufferSize;
-                break;
-            }
-        }
-    }
-    
+    VkDeviceSize actualSize = size == 0 ? it->second.size : size;
     memcpy(it->second.mapped[frame], data, static_cast<size_t>(actualSize));
 }
 
@@ -326,23 +485,94 @@ void DescriptorManager::updateImageSampler(uint32_t binding, uint32_t frame,
         throw std::runtime_error("Must call build() before updating image samplers!");
     }
     
-    VkDescriptorImageInfo imageInfo{};
-    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    imageInfo.imageView = texture->imageView;
-    imageInfo.sampler = sampler->vkSampler;
+    auto it = std::find_if(bindings.begin(), bindings.end(),
+                           [binding](const DescriptorBinding& b) { return b.binding == binding; });
+    if (it == bindings.end()) {
+        throw std::runtime_error("Image sampler binding not found!");
+    }
+    if (it->type != VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER) {
+        throw std::runtime_error("Binding isn't a combined image sampler!");
+    }
     
-    VkWriteDescriptorSet descriptorWrite{};
-    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrite.dstSet = descriptorSets[frame];
-    descriptorWrite.dstBinding = binding;
-    descriptorWrite.dstArrayElement = 0;
-    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    descriptorWrite.descriptorCount = 1;
-    descriptorWrite.pImageInfo = &imageInfo;
+    BoundImage image{texture, sampler, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, texture->getGeneration()};
+    writeImageDescriptor(frame, binding, image);
+    boundImages[frame][binding] = std::move(image);
+}
+
+void DescriptorManager::refreshTextures(uint32_t frame) {
+    if (!isBuilt) {
+        return;
+    }
+    
+    for (auto& [binding, image] : boundImages[frame]) {
+        uint32_t generation = image.texture->getGeneration();
+        if (generation != image.generation) {
+            writeImageDescriptor(frame, binding, image);
+            image.generation = generation;
+        }
+    }
+}
+
+void DescriptorManager::writeImageDescriptor(uint32_t frame, uint32_t binding, const BoundImage& image) {
+    DescriptorInfo& info = descriptorInfos[frame][templateSlot(binding)];
+    info.image.imageView = image.texture->imageView;
+    if (image.type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE) {
+        info.image.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        info.image.sampler = VK_NULL_HANDLE;
+    }
+    else {
+        info.image.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        info.image.sampler = image.sampler->vkSampler;
+    }
+    
+    // Pushed managers pick the new image up on the next bind()
+    if (pushed) {
+        return;
+    }
+    
+    if (bufferBacked) {
+        writeDescriptorBuffer(frame, binding, image.type, 1);
+        return;
+    }
+    
+    // The template rewrites the whole set from the packed data, still a single call with nothing to build
+    if (updateTemplate != VK_NULL_HANDLE) {
+        context.pfnUpdateDescriptorSetWithTemplate(context.logicalDevice, descriptorSets[frame], updateTemplate,
+                                                   descriptorInfos[frame].data());
+        return;
+    }
     
+    VkWriteDescriptorSet descriptorWrite = makeWrite(frame, binding, image.type, 1);
     vkUpdateDescriptorSets(context.logicalDevice, 1, &descriptorWrite, 0, nullptr);
 }
 
+void DescriptorManager::bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t set, uint32_t frame) {
+    if (!isBuilt) {
+        throw std::runtime_error("Must call build() before binding descriptors!");
+    }
+    
+    if (bufferBacked) {
+        uint32_t bufferIndex = 0; // The heap is the only descriptor buffer ever bound
+        VkDeviceSize offset = heapOffset + frame * frameStride;
+        context.pfnCmdSetDescriptorBufferOffsets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, set, 1,
+                                                 &bufferIndex, &offset);
+        return;
+    }
+    
+    if (!pushed) {
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, set, 1,
+                                &descriptorSets[frame], 0, nullptr);
+        return;
+    }
+    
+    pushWrites.clear();
+    for (const auto& binding : bindings) {
+        pushWrites.push_back(makeWrite(frame, binding.binding, binding.type, binding.descriptorCount));
+    }
+    context.pfnCmdPushDescriptorSet(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, set,
+                                    static_cast<uint32_t>(pushWrites.size()), pushWrites.data());
+}
+
 void* DescriptorManager::getMappedUniformBuffer(uint32_t binding, uint32_t frame) const {
     auto it = uniformBuffers.find(binding);
     if (it == uniformBuffers.end()) {
@@ -390,12 +620,18 @@ void DescriptorManager::cleanup() {
         }
     }
     
-    if (descriptorPool != VK_NULL_HANDLE) {
-        vkDestroyDescriptorPool(context.logicalDevice, descriptorPool, nullptr);
+    if (updateTemplate != VK_NULL_HANDLE) {
+        context.pfnDestroyDescriptorUpdateTemplate(context.logicalDevice, updateTemplate, nullptr);
+    }
+    
+    // after vlny::cleanup the allocator's pools are gone and the sets went with them
+    if (!descriptorSets.empty() && context.descriptorAllocator.has_value()) {
+        context.getDescriptorAllocator().free(static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data());
     }
     
-    if (descriptorSetLayout != VK_NULL_HANDLE) {
-        vkDestroyDescriptorSetLayout(context.logicalDevice, descriptorSetLayout, nullptr);
+    // same for the heap, its memory is already freed
+    if (frameStride != 0 && context.descriptorBufferHeap.has_value()) {
+        context.getDescriptorBufferHeap().free(heapOffset, frameStride * maxFramesInFlight);
     }
 }
 
@@ -11,6 +11,8 @@
 #include <GLFW/glfw3.h>
 
 #include "window.hpp"
+#include "command.hpp"
+#include "uniformHandle.hpp"
 
 namespace vlny{
 
@@ -36,7 +38,7 @@ struct DescriptorBinding {
     VkDeviceSize externalBufferSize = 0;
 };
 
-class DescriptorManager {
+class DescriptorManager : public FrameResource {
 public:
     DescriptorManager(Context& context, Window& window);
     ~DescriptorManager();
@@ -55,9 +57,39 @@ public:
     DescriptorManager& addExternalBuffer(uint32_t binding, VkShaderStageFlags stageFlags, 
                                          VkDescriptorType type, VkBuffer buffer, VkDeviceSize size);
     
+    // Push the descriptors straight into the command buffer at bind() time (VK_KHR_push_descriptor) instead of
+    // allocating sets, for per-draw material bindings. Only taken when the device supports it and the bindings fit
+    // the push limit, otherwise build() allocates sets as usual. Call before build()
+    DescriptorManager& allowPushDescriptors(bool allow = true);
+    
+    // Write the descriptors into the context's DescriptorBufferHeap (VK_EXT_descriptor_buffer) and bind them by offset,
+    // no pool allocation or set updates at all. Taken over push descriptors whenever the context supports descriptor
+    // buffers, so a pipeline made with GraphicsPipelineConfig::descriptorBuffer always gets matching layouts.
+    // External buffers have to be created with VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT. Call before build()
+    DescriptorManager& allowDescriptorBuffer(bool allow = true);
+    
     // Build the descriptor sets (call after all bindings are added)
     void build();
     
+    // Bind this frame's set, push its descriptors, or point `set` at its descriptor buffer range
+    // (the heap has to be bound to the command buffer already, Renderer does that for descriptor buffer pipelines)
+    void bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t set, uint32_t frame);
+    bool isPushed() const { return pushed; }
+    bool usesDescriptorBuffer() const { return bufferBacked; }
+    
+    // Typed writer for a uniform buffer binding, the per-frame pointers are looked up once here instead of on every update
+    template <typename T>
+    UniformHandle<T> getUniformHandle(uint32_t binding) const {
+        auto it = uniformBuffers.find(binding);
+        if (it == uniformBuffers.end()) {
+            throw std::runtime_error("Uniform buffer binding not found, handles are available after build()!");
+        }
+        if (sizeof(T) > it->second.size) {
+            throw std::runtime_error("Uniform block is larger than its binding's buffer!");
+        }
+        return UniformHandle<T>(it->second.mapped);
+    }
+    
     // Update uniform buffer data
     void updateUniformBuffer(uint32_t binding, uint32_t frame, const void* data, VkDeviceSize size = 0);
     
@@ -65,9 +97,15 @@ public:
     void updateImageSampler(uint32_t binding, uint32_t frame, std::shared_ptr<Texture> texture, 
                            std::shared_ptr<Sampler> sampler);
     
+    // Rewrite image descriptors whose texture got a new view since they were written
+    // (streamed textures becoming resident). The frame's previous submission must be finished,
+    // registering the manager with Renderer::addFrameResource calls this at the right time.
+    void refreshTextures(uint32_t frame);
+    void prepareFrame(uint32_t frame) override { refreshTextures(frame); }
+    
     // Getters
     VkDescriptorSetLayout getDescriptorSetLayout() const { return descriptorSetLayout; }
-    VkDescriptorSet getDescriptorSet(uint32_t frame) const { return descriptorSets[frame]; }
+    VkDescriptorSet getDescriptorSet(uint32_t frame) const { return descriptorSets[frame]; } // only for set-backed managers
     void* getMappedUniformBuffer(uint32_t binding, uint32_t frame) const;
     
     // Get buffer for external use (e.g., if you want direct access)
@@ -79,14 +117,28 @@ private:
     
     std::vector<DescriptorBinding> bindings;
     bool isBuilt = false;
+    bool pushAllowed = false;
+    bool pushed = false;
+    
+    // Every implementation supports at least this many pushed descriptors per set
+    static constexpr uint32_t maxPushDescriptors = 32;
+    std::vector<VkWriteDescriptorSet> pushWrites; // Reused between binds
     
-    // Descriptor resources
-    VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+    bool bufferAllowed = false;
+    bool bufferBacked = false;
+    
+    // Range of the context's DescriptorBufferHeap, one aligned copy of the layout per frame
+    VkDeviceSize heapOffset = 0;
+    VkDeviceSize frameStride = 0;
+    std::map<uint32_t, VkDeviceSize> bindingOffsets; // binding -> offset inside a frame's copy
+    
+    // Descriptor resources, the layout is owned by the context's cache and the sets by its allocator
     VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
     std::vector<VkDescriptorSet> descriptorSets;
     
     // Uniform buffer storage (per binding, per frame)
     struct UniformBufferData {
+        VkDeviceSize size = 0;
         std::vector<VkBuffer> buffers;
         std::vector<VkDeviceMemory> memory;
         std::vector<void*> mapped;
@@ -101,13 +153,38 @@ private:
     };
     std::map<uint32_t, StorageBufferData> storageBuffers; // key = binding
     
+    // What each frame's image descriptors currently point at, to spot stale ones
+    struct BoundImage {
+        std::shared_ptr<Texture> texture;
+        std::shared_ptr<Sampler> sampler;
+        VkDescriptorType type;
+        uint32_t generation;
+    };
+    std::vector<std::map<uint32_t, BoundImage>> boundImages; // [frame][binding]
+    
+    // Packed descriptor data, one slot per descriptor, read straight by the update template
+    union DescriptorInfo {
+        VkDescriptorBufferInfo buffer;
+        VkDescriptorImageInfo image;
+    };
+    std::vector<std::vector<DescriptorInfo>> descriptorInfos; // [frame][slot]
+    std::map<uint32_t, size_t> templateSlots; // binding -> first slot, only through templateSlot()
+    VkDescriptorUpdateTemplateKHR updateTemplate = VK_NULL_HANDLE; // null when templates are unavailable
+    
     // Internal methods
     void createUniformBuffer(uint32_t binding, VkDeviceSize bufferSize);
     void createStorageBuffer(uint32_t binding, VkDeviceSize bufferSize);
     void createDescriptorSetLayout();
-    void createDescriptorPool();
     void allocateDescriptorSets();
+    void allocateDescriptorBuffer();
+    void fillDescriptorInfos();
+    size_t templateSlot(uint32_t binding) const;
+    void createUpdateTemplate();
     void updateDescriptorSets();
+    VkWriteDescriptorSet makeWrite(uint32_t frame, uint32_t binding, VkDescriptorType type, uint32_t count);
+    void writeDescriptorBuffer(uint32_t frame, uint32_t binding, VkDescriptorType type, uint32_t count);
+    size_t descriptorSize(VkDescriptorType type) const;
+    void writeImageDescriptor(uint32_t frame, uint32_t binding, const BoundImage& image);
     void cleanup();
 };
 
@@ -0,0 +1,155 @@
+#include "dynamicTexture.hpp"
+
+#include "context.hpp"
+#include "buffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace vlny{
+
+DynamicTexture::DynamicTexture(Context& context, Window& window, uint32_t width, uint32_t height, VkFormat format) :
+    context(context), maxFramesInFlight(window.getConfig().maxFramesInFlight), width(width), height(height) {
+    texelBytes = formatTexelBytes(format);
+    if(texelBytes == 0){
+        throw std::invalid_argument("DynamicTexture needs an uncompressed color format!");
+    }
+
+    texture = std::shared_ptr<Texture>(new Texture(context, width, height, format));
+
+    sliceSize = static_cast<VkDeviceSize>(width) * height * texelBytes;
+    pixels.assign(static_cast<size_t>(sliceSize), 0);
+    createBuffer(context, sliceSize * maxFramesInFlight, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingMemory);
+
+    void* data;
+    vkMapMemory(context.logicalDevice, stagingMemory, 0, VK_WHOLE_SIZE, 0, &data);
+    mapped = static_cast<uint8_t*>(data);
+
+    dirty.resize(maxFramesInFlight);
+    VILLAINY_VERBOSE_LOG(context.logger, "Made dynamic texture (" + std::to_string(width) + "x" + std::to_string(height) + ").");
+}
+
+DynamicTexture::~DynamicTexture(){
+    if(mapped != nullptr){
+        vkUnmapMemory(context.logicalDevice, stagingMemory);
+    }
+    vkDestroyBuffer(context.logicalDevice, stagingBuffer, nullptr);
+    vkFreeMemory(context.logicalDevice, stagingMemory, nullptr);
+}
+
+void DynamicTexture::update(uint32_t frame, const void* pixels, VkRect2D rect){
+    VkRect2D clamped = clampRect(rect);
+    if(clamped.extent.width == 0 || clamped.extent.height == 0){
+        return;
+    }
+
+    // `pixels` keeps the caller's layout, skip what the clamp cut off the left and top edges
+    size_t dx = static_cast<size_t>(clamped.offset.x - rect.offset.x);
+    size_t dy = static_cast<size_t>(clamped.offset.y - rect.offset.y);
+    size_t srcPitch = static_cast<size_t>(rect.extent.width) * texelBytes;
+    const uint8_t* src = static_cast<const uint8_t*>(pixels) + dy * srcPitch + dx * texelBytes;
+    uint8_t* dst = map(frame) + (static_cast<size_t>(clamped.offset.y) * width + clamped.offset.x) * texelBytes;
+    size_t rowBytes = static_cast<size_t>(clamped.extent.width) * texelBytes;
+    size_t pitch = getRowPitch();
+    if(rowBytes == pitch && srcPitch == pitch){
+        memcpy(dst, src, rowBytes * clamped.extent.height);
+    }
+    else{
+        for(uint32_t y = 0; y < clamped.extent.height; y++){
+            memcpy(dst + y * pitch, src + y * srcPitch, rowBytes);
+        }
+    }
+    markDirty(frame, clamped);
+}
+
+void DynamicTexture::update(uint32_t frame, const void* pixels){
+    update(frame, pixels, VkRect2D{{0, 0}, {width, height}});
+}
+
+// the slices may still be read by frames in flight, writes wait in the cpu copy until prepareFrame
+uint8_t* DynamicTexture::map(uint32_t /*frame*/){
+    return pixels.data();
+}
+
+void DynamicTexture::markDirty(uint32_t frame, VkRect2D rect){
+    rect = clampRect(rect);
+    if(rect.extent.width == 0 || rect.extent.height == 0){
+        return;
+    }
+
+    auto& rects = dirty[frame];
+    rects.push_back(rect);
+    if(rects.size() > maxDirtyRects){
+        int32_t x0 = rects[0].offset.x, y0 = rects[0].offset.y;
+        int32_t x1 = x0 + static_cast<int32_t>(rects[0].extent.width), y1 = y0 + static_cast<int32_t>(rects[0].extent.height);
+        for(const auto& r : rects){
+            x0 = std::min(x0, r.offset.x);
+            y0 = std::min(y0, r.offset.y);
+            x1 = std::max(x1, r.offset.x + static_cast<int32_t>(r.extent.width));
+            y1 = std::max(y1, r.offset.y + static_cast<int32_t>(r.extent.height));
+        }
+        rects.assign(1, VkRect2D{{x0, y0}, {static_cast<uint32_t>(x1 - x0), static_cast<uint32_t>(y1 - y0)}});
+    }
+}
+
+void DynamicTexture::prepareFrame(uint32_t frame){
+    uint8_t* slice = mapped + sliceSize * frame;
+    size_t pitch = getRowPitch();
+    for(const auto& rect : dirty[frame]){
+        size_t offset = (static_cast<size_t>(rect.offset.y) * width + rect.offset.x) * texelBytes;
+        size_t rowBytes = static_cast<size_t>(rect.extent.width) * texelBytes;
+        if(rowBytes == pitch){
+            memcpy(slice + offset, pixels.data() + offset, rowBytes * rect.extent.height);
+            continue;
+        }
+        for(uint32_t y = 0; y < rect.extent.height; y++){
+            memcpy(slice + offset + y * pitch, pixels.data() + offset + y * pitch, rowBytes);
+        }
+    }
+}
+
+void DynamicTexture::recordFrameCommands(VkCommandBuffer commandBuffer, uint32_t frame){
+    auto& rects = dirty[frame];
+    if(rects.empty()){
+        return;
+    }
+
+    std::vector<VkBufferImageCopy> regions;
+    regions.reserve(rects.size());
+    for(const auto& rect : rects){
+        VkBufferImageCopy region{};
+        // the slice has the image's layout, so a rect is just an offset + the full row length
+        region.bufferOffset = sliceSize * frame + (static_cast<VkDeviceSize>(rect.offset.y) * width + rect.offset.x) * texelBytes;
+        region.bufferRowLength = width;
+        region.bufferImageHeight = height;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = 0;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = {rect.offset.x, rect.offset.y, 0};
+        region.imageExtent = {rect.extent.width, rect.extent.height, 1};
+        regions.push_back(region);
+    }
+    rects.clear();
+
+    // previous frames may still be sampling it, the barrier orders the copy after them
+    recordImageBarrier(commandBuffer, texture->image, 0, 1, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+    vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, texture->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        scast_ui32(regions.size()), regions.data());
+
+    recordImageBarrier(commandBuffer, texture->image, 0, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+}
+
+VkRect2D DynamicTexture::clampRect(VkRect2D rect) const{
+    int32_t x0 = std::clamp(rect.offset.x, 0, static_cast<int32_t>(width));
+    int32_t y0 = std::clamp(rect.offset.y, 0, static_cast<int32_t>(height));
+    int32_t x1 = std::clamp(rect.offset.x + static_cast<int32_t>(rect.extent.width), x0, static_cast<int32_t>(width));
+    int32_t y1 = std::clamp(rect.offset.y + static_cast<int32_t>(rect.extent.height), y0, static_cast<int32_t>(height));
+    return VkRect2D{{x0, y0}, {static_cast<uint32_t>(x1 - x0), static_cast<uint32_t>(y1 - y0)}};
+}
+
+}
@@ -0,0 +1,74 @@
+#ifndef VILLAINY_DYNAMIC_TEXTURE
+#define VILLAINY_DYNAMIC_TEXTURE
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "command.hpp"
+#include "texture.hpp"
+#include "window.hpp"
+
+namespace vlny{
+
+class Context;
+
+// fixed size image the cpu rewrites every frame (video, procedural content, ...)
+// writes land in a cpu copy of the image. each frame in flight owns a persistently mapped staging slice laid out like
+// the full image, the dirty rectangles are copied into it in prepareFrame, once the frame's fence was waited on, and
+// from there into the image, recorded into that frame's own command buffer ahead of the render pass
+//
+// register with Renderer::addFrameResource and bind getTexture() like any other texture
+// write for the frame that's about to be drawn (Renderer::getCurrentFrame), any time before drawFrame
+class DynamicTexture : public FrameResource{
+public:
+    // uncompressed formats only (8/16/32 bit per channel)
+    DynamicTexture(Context& context, Window& window, uint32_t width, uint32_t height, VkFormat format = VK_FORMAT_R8G8B8A8_SRGB);
+    ~DynamicTexture();
+
+    DynamicTexture(const DynamicTexture&) = delete;
+    DynamicTexture& operator=(const DynamicTexture&) = delete;
+
+    // `pixels` holds rect.extent.width * height tightly packed texels
+    void update(uint32_t frame, const void* pixels, VkRect2D rect);
+    void update(uint32_t frame, const void* pixels); // whole image
+
+    // write straight into the cpu copy (row pitch = getRowPitch()) then mark what changed
+    uint8_t* map(uint32_t frame);
+    void markDirty(uint32_t frame, VkRect2D rect);
+
+    std::shared_ptr<Texture> getTexture() const { return texture; }
+    uint32_t getWidth() const { return width; }
+    uint32_t getHeight() const { return height; }
+    size_t getRowPitch() const { return static_cast<size_t>(width) * texelBytes; }
+
+    void prepareFrame(uint32_t frame) override;
+    void recordFrameCommands(VkCommandBuffer commandBuffer, uint32_t frame) override;
+private:
+    Context& context;
+    uint32_t maxFramesInFlight;
+
+    uint32_t width, height;
+    uint32_t texelBytes;
+    std::shared_ptr<Texture> texture;
+    std::vector<uint8_t> pixels; // cpu copy
+
+    VkBuffer stagingBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory stagingMemory = VK_NULL_HANDLE;
+    uint8_t* mapped = nullptr;
+    VkDeviceSize sliceSize;
+
+    std::vector<std::vector<VkRect2D>> dirty; // [frame]
+
+    // past this many rects per frame they're merged into their bounding box
+    static constexpr size_t maxDirtyRects = 16;
+
+    VkRect2D clampRect(VkRect2D rect) const;
+};
+
+}
+
+#endif
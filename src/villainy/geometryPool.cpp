@@ -0,0 +1,301 @@
+#include "geometryPool.hpp"
+
+#include "context.hpp"
+#include "buffer.hpp"
+
+#include <algorithm>
+
+namespace vlny{
+
+namespace{
+
+// first fit, like DescriptorBufferHeap, in elements rather than bytes
+bool allocateRange(std::map<uint32_t, uint32_t>& freeRanges, uint32_t count, uint32_t& first){
+    for(auto it = freeRanges.begin(); it != freeRanges.end(); ++it){
+        if(it->second < count){
+            continue;
+        }
+        first = it->first;
+        uint32_t remaining = it->second - count;
+        freeRanges.erase(it);
+        if(remaining > 0){
+            freeRanges[first + count] = remaining;
+        }
+        return true;
+    }
+    return false;
+}
+
+template <typename Dst, typename Src>
+std::vector<uint8_t> convertIndices(ArrayView<Src> indices){
+    std::vector<uint8_t> converted(indices.size() * sizeof(Dst));
+    Dst* dst = reinterpret_cast<Dst*>(converted.data());
+    for(size_t i = 0; i < indices.size(); i++){
+        dst[i] = static_cast<Dst>(indices[i]);
+    }
+    return converted;
+}
+
+void freeRange(std::map<uint32_t, uint32_t>& freeRanges, uint32_t first, uint32_t count){
+    if(count == 0){
+        return;
+    }
+    auto it = freeRanges.emplace(first, count).first;
+    auto next = std::next(it);
+    if(next != freeRanges.end() && it->first + it->second == next->first){
+        it->second += next->second;
+        freeRanges.erase(next);
+    }
+    if(it != freeRanges.begin()){
+        auto prev = std::prev(it);
+        if(prev->first + prev->second == it->first){
+            prev->second += it->second;
+            freeRanges.erase(it);
+        }
+    }
+}
+
+}
+
+GeometryPool::GeometryPool(Context& context, Window& window, uint32_t vertexStride, uint32_t vertexCapacity, uint32_t indexCapacity,
+    VkIndexType indexType) :
+    context(context), maxFramesInFlight(window.getConfig().maxFramesInFlight), vertexStride(vertexStride), indexType(indexType) {
+    if(vertexStride == 0 || vertexCapacity == 0 || indexCapacity == 0){
+        throw std::invalid_argument("Geometry pool needs a vertex stride and room for vertices and indices!");
+    }
+    if(indexType != VK_INDEX_TYPE_UINT16 && indexType != VK_INDEX_TYPE_UINT32){
+        throw std::invalid_argument("Geometry pool indices have to be 16 or 32 bit!");
+    }
+    indexSize = indexType == VK_INDEX_TYPE_UINT16 ? 2 : 4;
+
+    createBuffer(context, static_cast<VkDeviceSize>(vertexStride) * vertexCapacity,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        vertexBuffer, vertexMemory);
+    createBuffer(context, static_cast<VkDeviceSize>(indexSize) * indexCapacity,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        indexBuffer, indexMemory);
+
+    freeVertices[0] = vertexCapacity;
+    freeIndices[0] = indexCapacity;
+    VILLAINY_VERBOSE_LOG(context.logger, "Made geometry pool (" + std::to_string(vertexCapacity) + " vertices, " +
+        std::to_string(indexCapacity) + " " + std::to_string(indexSize * 8) + " bit indices).");
+}
+
+GeometryPool::~GeometryPool(){
+    vkDestroyBuffer(context.getLogicalDevice(), vertexBuffer, nullptr);
+    vkFreeMemory(context.getLogicalDevice(), vertexMemory, nullptr);
+    vkDestroyBuffer(context.getLogicalDevice(), indexBuffer, nullptr);
+    vkFreeMemory(context.getLogicalDevice(), indexMemory, nullptr);
+}
+
+GeometryPool::MeshId GeometryPool::addMesh(const void* vertices, uint32_t vertexCount, ArrayView<uint16_t> indices){
+    return addIndexedMesh(vertices, vertexCount, indices);
+}
+
+GeometryPool::MeshId GeometryPool::addMesh(const void* vertices, uint32_t vertexCount, ArrayView<uint32_t> indices){
+    return addIndexedMesh(vertices, vertexCount, indices);
+}
+
+template <typename T>
+GeometryPool::MeshId GeometryPool::addIndexedMesh(const void* vertices, uint32_t vertexCount, ArrayView<T> indices){
+    if(vertexCount == 0 || indices.empty()){
+        throw std::invalid_argument("Geometry pool meshes need vertices and indices!");
+    }
+    // 0xFFFF is the 16 bit restart index, narrowing must not turn a vertex into a restart
+    if(sizeof(T) > indexSize && *std::max_element(indices.begin(), indices.end()) >= 0xFFFF){
+        throw std::invalid_argument("Mesh indices don't fit the geometry pool's 16 bit index type!");
+    }
+
+    MeshRange range;
+    range.vertexCount = vertexCount;
+    range.indexCount = scast_ui32(indices.size());
+    uint32_t firstVertex;
+    if(!allocateRange(freeVertices, range.vertexCount, firstVertex)){
+        throw std::runtime_error("Geometry pool is out of vertex space!");
+    }
+    if(!allocateRange(freeIndices, range.indexCount, range.firstIndex)){
+        freeRange(freeVertices, firstVertex, range.vertexCount);
+        throw std::runtime_error("Geometry pool is out of index space!");
+    }
+    range.vertexOffset = static_cast<int32_t>(firstVertex);
+
+    // only these ranges are written, draws of other meshes in flight don't read them
+    uploadBuffer(context, vertexBuffer, vertices, static_cast<VkDeviceSize>(vertexStride) * vertexCount,
+        static_cast<VkDeviceSize>(vertexStride) * firstVertex);
+    VkDeviceSize indexOffset = static_cast<VkDeviceSize>(indexSize) * range.firstIndex;
+    if(sizeof(T) == indexSize){
+        uploadBuffer(context, indexBuffer, indices.data(), sizeof(T) * indices.size(), indexOffset);
+    }
+    else{
+        std::vector<uint8_t> converted = indexType == VK_INDEX_TYPE_UINT16 ?
+            convertIndices<uint16_t>(indices) : convertIndices<uint32_t>(indices);
+        uploadBuffer(context, indexBuffer, converted.data(), converted.size(), indexOffset);
+    }
+
+    MeshId mesh;
+    if(!freeIds.empty()){
+        mesh = freeIds.back();
+        freeIds.pop_back();
+        meshes[mesh] = range;
+        live[mesh] = true;
+    }
+    else{
+        mesh = scast_ui32(meshes.size());
+        meshes.push_back(range);
+        live.push_back(true);
+    }
+    count++;
+    return mesh;
+}
+
+void GeometryPool::removeMesh(MeshId mesh){
+    if(!isLive(mesh)){
+        throw std::runtime_error("Mesh isn't in the geometry pool!");
+    }
+    live[mesh] = false;
+    count--;
+    retired.emplace_back(mesh, maxFramesInFlight);
+}
+
+void GeometryPool::prepareFrame(uint32_t /*frame*/){
+    for(size_t i = 0; i < retired.size();){
+        if(--retired[i].second == 0){
+            release(retired[i].first);
+            retired[i] = retired.back();
+            retired.pop_back();
+        }
+        else{
+            i++;
+        }
+    }
+}
+
+void GeometryPool::release(MeshId mesh){
+    const MeshRange& range = meshes[mesh];
+    freeRange(freeVertices, static_cast<uint32_t>(range.vertexOffset), range.vertexCount);
+    freeRange(freeIndices, range.firstIndex, range.indexCount);
+    freeIds.push_back(mesh);
+}
+
+void GeometryPool::bind(VkCommandBuffer commandBuffer) const{
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer, &offset);
+    vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, indexType);
+}
+
+void GeometryPool::drawMesh(VkCommandBuffer commandBuffer, MeshId mesh, uint32_t instanceCount, uint32_t firstInstance) const{
+    const MeshRange& range = meshes[mesh];
+    vkCmdDrawIndexed(commandBuffer, range.indexCount, instanceCount, range.firstIndex, range.vertexOffset, firstInstance);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+GeometryBatch::GeometryBatch(GeometryPool& pool, Window& window, UniformBuffer* ub) :
+    context(pool.context), pool(pool), ub(ub), maxFramesInFlight(window.getConfig().maxFramesInFlight) {}
+
+GeometryBatch::~GeometryBatch(){
+    destroyIndirectBuffer();
+}
+
+uint32_t GeometryBatch::addDraw(GeometryPool::MeshId mesh, uint32_t objectIndex, uint32_t instanceCount){
+    draws.push_back({mesh, objectIndex, instanceCount});
+    return scast_ui32(draws.size() - 1);
+}
+
+void GeometryBatch::updateDraw(uint32_t index, GeometryPool::MeshId mesh, uint32_t objectIndex, uint32_t instanceCount){
+    draws[index] = {mesh, objectIndex, instanceCount};
+}
+
+void GeometryBatch::clearDraws(){
+    draws.clear();
+}
+
+void GeometryBatch::setDrawDescriptors(DescriptorManager& descriptors, uint32_t set){
+    for(auto& entry : drawDescriptors){
+        if(entry.second == set){
+            entry.first = &descriptors;
+            return;
+        }
+    }
+    drawDescriptors.emplace_back(&descriptors, set);
+}
+
+void GeometryBatch::draw(VkCommandBuffer commandBuffer, GraphicsPipeline& pipeline, int currentFrame){
+    uint32_t frame = static_cast<uint32_t>(currentFrame);
+
+    pool.bind(commandBuffer);
+    pipeline.applyDynamicState(commandBuffer, drawRasterState(pipeline));
+    if(ub != nullptr && !pipeline.usesDescriptorBuffer){
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipelineLayout, 0, 1, &ub->getDescriptorSet(frame), 0, nullptr);
+    }
+    for(auto& [descriptors, set] : drawDescriptors){
+        descriptors->bind(commandBuffer, pipeline.pipelineLayout, set, frame);
+    }
+
+    if(!context.supportsMultiDrawIndirect()){
+        for(const Draw& entry : draws){
+            if(pool.isLive(entry.mesh)){
+                pool.drawMesh(commandBuffer, entry.mesh, entry.instanceCount, entry.objectIndex);
+            }
+        }
+        return;
+    }
+
+    reserveCommands(scast_ui32(draws.size()));
+    // the frame's fence was waited on, its region is free to be rewritten
+    VkDeviceSize regionOffset = sizeof(VkDrawIndexedIndirectCommand) * static_cast<VkDeviceSize>(capacity) * frame;
+    auto* commands = reinterpret_cast<VkDrawIndexedIndirectCommand*>(mapped + regionOffset);
+    uint32_t commandCount = 0;
+    for(const Draw& entry : draws){
+        if(!pool.isLive(entry.mesh)){
+            continue;
+        }
+        const MeshRange& range = pool.getMesh(entry.mesh);
+        VkDrawIndexedIndirectCommand& command = commands[commandCount++];
+        command.indexCount = range.indexCount;
+        command.instanceCount = entry.instanceCount;
+        command.firstIndex = range.firstIndex;
+        command.vertexOffset = range.vertexOffset;
+        command.firstInstance = entry.objectIndex;
+    }
+    if(commandCount > 0){
+        vkCmdDrawIndexedIndirect(commandBuffer, indirectBuffer, regionOffset, commandCount, sizeof(VkDrawIndexedIndirectCommand));
+    }
+}
+
+// frames in flight may still read the old commands, growing is rare enough to wait for them
+void GeometryBatch::reserveCommands(uint32_t commandCount){
+    if(commandCount <= capacity){
+        return;
+    }
+    if(indirectBuffer != VK_NULL_HANDLE){
+        context.waitIdle();
+        destroyIndirectBuffer();
+    }
+
+    capacity = std::max(commandCount, capacity * 2);
+    createBuffer(context, sizeof(VkDrawIndexedIndirectCommand) * static_cast<VkDeviceSize>(capacity) * maxFramesInFlight,
+        VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        indirectBuffer, indirectMemory);
+
+    void* data;
+    vkMapMemory(context.getLogicalDevice(), indirectMemory, 0, VK_WHOLE_SIZE, 0, &data);
+    mapped = static_cast<uint8_t*>(data);
+}
+
+void GeometryBatch::destroyIndirectBuffer(){
+    if(mapped != nullptr){
+        vkUnmapMemory(context.getLogicalDevice(), indirectMemory);
+        mapped = nullptr;
+    }
+    if(indirectBuffer != VK_NULL_HANDLE){
+        vkDestroyBuffer(context.getLogicalDevice(), indirectBuffer, nullptr);
+        indirectBuffer = VK_NULL_HANDLE;
+    }
+    if(indirectMemory != VK_NULL_HANDLE){
+        vkFreeMemory(context.getLogicalDevice(), indirectMemory, nullptr);
+        indirectMemory = VK_NULL_HANDLE;
+    }
+}
+
+}
@@ -0,0 +1,174 @@
+#ifndef VILLAINY_GEOMETRY_POOL
+#define VILLAINY_GEOMETRY_POOL
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "command.hpp"
+#include "render.hpp"
+#include "utils.hpp"
+#include "window.hpp"
+
+namespace vlny{
+
+class Context;
+
+// where a mesh sits in its pool, these go straight into vkCmdDrawIndexed / VkDrawIndexedIndirectCommand
+struct MeshRange{
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    int32_t vertexOffset = 0;
+    uint32_t vertexCount = 0;
+};
+
+// a few big device local vertex and index buffers that meshes are sub-allocated from, so every mesh in the pool draws
+// with the same two buffers bound and only differs in firstIndex / vertexOffset
+// all meshes share one vertex layout (`vertexStride`) and one index type, chosen when the pool is made: uint16 by
+// default, uint32 for pools holding meshes above 65k vertices. indices are relative to the mesh's own first vertex
+//
+// meshes are uploaded when added, like static vertex buffers. register with Renderer::addFrameResource, a removed
+// mesh's ranges are only handed out again once the frames in flight that may still draw it are done
+class GeometryPool : public FrameResource{
+public:
+    using MeshId = uint32_t;
+
+    GeometryPool(Context& context, Window& window, uint32_t vertexStride, uint32_t vertexCapacity, uint32_t indexCapacity,
+        VkIndexType indexType = VK_INDEX_TYPE_UINT16);
+    ~GeometryPool();
+
+    GeometryPool(const GeometryPool&) = delete;
+    GeometryPool& operator=(const GeometryPool&) = delete;
+
+    // throws when either buffer has no free range big enough left, or when a 16 bit pool gets an index of 0xFFFF or above
+    // 16 bit indices are widened in a 32 bit pool
+    MeshId addMesh(const void* vertices, uint32_t vertexCount, ArrayView<uint16_t> indices);
+    MeshId addMesh(const void* vertices, uint32_t vertexCount, ArrayView<uint32_t> indices);
+    template <typename Vertex>
+    MeshId addMesh(ArrayView<Vertex> vertices, ArrayView<uint16_t> indices);
+    template <typename Vertex>
+    MeshId addMesh(ArrayView<Vertex> vertices, ArrayView<uint32_t> indices);
+    // ArrayView<Vertex> can't be deduced from a vector, these spare callers addMesh<Vertex>(...)
+    template <typename Vertex>
+    MeshId addMesh(const std::vector<Vertex>& vertices, ArrayView<uint16_t> indices) { return addMesh(ArrayView<Vertex>(vertices), indices); }
+    template <typename Vertex>
+    MeshId addMesh(const std::vector<Vertex>& vertices, ArrayView<uint32_t> indices) { return addMesh(ArrayView<Vertex>(vertices), indices); }
+    // the id is handed out again by a later addMesh
+    void removeMesh(MeshId mesh);
+
+    const MeshRange& getMesh(MeshId mesh) const { return meshes[mesh]; }
+    bool isLive(MeshId mesh) const { return mesh < live.size() && live[mesh]; }
+
+    // binds both buffers, once for every mesh drawn after it
+    void bind(VkCommandBuffer commandBuffer) const;
+    void drawMesh(VkCommandBuffer commandBuffer, MeshId mesh, uint32_t instanceCount = 1, uint32_t firstInstance = 0) const;
+
+    void prepareFrame(uint32_t frame) override;
+
+    VkBuffer getVertexBuffer() const { return vertexBuffer; }
+    VkBuffer getIndexBuffer() const { return indexBuffer; }
+    uint32_t getVertexStride() const { return vertexStride; }
+    VkIndexType getIndexType() const { return indexType; }
+    uint32_t meshCount() const { return count; }
+private:
+    Context& context;
+    uint32_t maxFramesInFlight;
+    uint32_t vertexStride;
+    VkIndexType indexType;
+    uint32_t indexSize; // bytes
+
+    VkBuffer vertexBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory vertexMemory = VK_NULL_HANDLE;
+    VkBuffer indexBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory indexMemory = VK_NULL_HANDLE;
+
+    // first element -> element count, neighbours are merged on free
+    std::map<uint32_t, uint32_t> freeVertices;
+    std::map<uint32_t, uint32_t> freeIndices;
+
+    std::vector<MeshRange> meshes; // [MeshId]
+    std::vector<bool> live;
+    std::vector<MeshId> freeIds;
+    uint32_t count = 0;
+
+    std::vector<std::pair<MeshId, uint32_t>> retired; // mesh, prepareFrame calls until its ranges are free
+
+    template <typename T>
+    MeshId addIndexedMesh(const void* vertices, uint32_t vertexCount, ArrayView<T> indices);
+    void release(MeshId mesh);
+
+    friend class GeometryBatch;
+};
+
+template <typename Vertex>
+GeometryPool::MeshId GeometryPool::addMesh(ArrayView<Vertex> vertices, ArrayView<uint16_t> indices){
+    if(sizeof(Vertex) != vertexStride){
+        throw std::runtime_error("Vertex type doesn't match the geometry pool's stride!");
+    }
+    return addMesh(vertices.data(), scast_ui32(vertices.size()), indices);
+}
+
+template <typename Vertex>
+GeometryPool::MeshId GeometryPool::addMesh(ArrayView<Vertex> vertices, ArrayView<uint32_t> indices){
+    if(sizeof(Vertex) != vertexStride){
+        throw std::runtime_error("Vertex type doesn't match the geometry pool's stride!");
+    }
+    return addMesh(vertices.data(), scast_ui32(vertices.size()), indices);
+}
+
+// many meshes of one GeometryPool drawn as a single render object: the pool is bound once and the draws go out as one
+// vkCmdDrawIndexedIndirect when Context::supportsMultiDrawIndirect(), as one vkCmdDrawIndexed each otherwise
+// each draw's object index is its firstInstance, like RenderObject::objectIndex, for an ObjectTable / BindlessTable scene
+// set 0 comes from `ub` unless the pipeline uses descriptor buffers, further sets from setDrawDescriptors
+//
+// draws of removed meshes are skipped until a later addMesh reuses the id, update or clear them along with the removal
+class GeometryBatch : public RenderObjectBase{
+public:
+    GeometryBatch(GeometryPool& pool, Window& window, UniformBuffer* ub = nullptr);
+    ~GeometryBatch();
+
+    GeometryBatch(const GeometryBatch&) = delete;
+    GeometryBatch& operator=(const GeometryBatch&) = delete;
+
+    // returns the draw's index for updateDraw
+    uint32_t addDraw(GeometryPool::MeshId mesh, uint32_t objectIndex = 0, uint32_t instanceCount = 1);
+    void updateDraw(uint32_t index, GeometryPool::MeshId mesh, uint32_t objectIndex = 0, uint32_t instanceCount = 1);
+    void clearDraws();
+    uint32_t drawCount() const { return scast_ui32(draws.size()); }
+
+    void setDrawDescriptors(DescriptorManager& descriptors, uint32_t set = 1);
+
+    void draw(VkCommandBuffer commandBuffer, GraphicsPipeline& pipeline, int currentFrame) override;
+private:
+    struct Draw{
+        GeometryPool::MeshId mesh;
+        uint32_t objectIndex;
+        uint32_t instanceCount;
+    };
+
+    Context& context;
+    GeometryPool& pool;
+    UniformBuffer* ub;
+    uint32_t maxFramesInFlight;
+
+    std::vector<Draw> draws;
+    std::vector<std::pair<DescriptorManager*, uint32_t>> drawDescriptors; // manager, set
+
+    // indirect commands, one region per frame in flight written while the frame is recorded
+    VkBuffer indirectBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory indirectMemory = VK_NULL_HANDLE;
+    uint8_t* mapped = nullptr;
+    uint32_t capacity = 0; // commands per region
+
+    void reserveCommands(uint32_t commandCount);
+    void destroyIndirectBuffer();
+};
+
+}
+
+#endif
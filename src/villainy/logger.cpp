@@ -14,6 +14,7 @@ void Logger::setMinSeverity(LogSeverity newMinSev){
 
 void Logger::log(LogSeverity sev, std::string msg){
     std::string output = appname + "/" + getSevString(sev) + "\t - " + msg + "\n";
+    std::lock_guard<std::mutex> lock(mutex);
     if(!logfilename.empty()) { writeToLogFile(output); }
     if(sev < minSev){ return; } 
     std::cout << output;
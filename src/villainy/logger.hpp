@@ -4,6 +4,7 @@
 #include <iostream>
 #include <string>
 #include <fstream>
+#include <mutex>
 
 #include <vulkan/vulkan.h>
 
@@ -56,6 +57,7 @@ private:
     std::string logfilename;
     std::ofstream logfile;
     LogSeverity minSev = INFO;
+    std::mutex mutex; // worker threads (pipeline compiles, startup tasks, decoders) log too
 
     void initLogFile();
 
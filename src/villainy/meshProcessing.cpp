@@ -0,0 +1,656 @@
+#include "meshProcessing.hpp"
+
+#include "threadPool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+
+namespace vlny{
+
+namespace{
+
+constexpr uint32_t unmapped = std::numeric_limits<uint32_t>::max();
+
+struct Vec3{
+    float x, y, z;
+};
+
+Vec3 operator+(Vec3 a, Vec3 b){ return {a.x + b.x, a.y + b.y, a.z + b.z}; }
+Vec3 operator-(Vec3 a, Vec3 b){ return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+Vec3 operator*(Vec3 a, float s){ return {a.x * s, a.y * s, a.z * s}; }
+float dot(Vec3 a, Vec3 b){ return a.x * b.x + a.y * b.y + a.z * b.z; }
+Vec3 cross(Vec3 a, Vec3 b){ return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x}; }
+float length(Vec3 a){ return std::sqrt(dot(a, a)); }
+
+Vec3 position(const MeshData& mesh, uint32_t vertex){
+    Vec3 p{0.0f, 0.0f, 0.0f};
+    memcpy(&p, mesh.vertices.data() + static_cast<size_t>(vertex) * mesh.vertexStride + mesh.positionOffset,
+        sizeof(float) * mesh.positionComponents);
+    return p;
+}
+
+// triangles using each vertex: vertex v's are triangles[offsets[v] .. offsets[v + 1])
+struct Adjacency{
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> triangles;
+};
+
+Adjacency buildAdjacency(const std::vector<uint32_t>& indices, uint32_t vertexCount){
+    Adjacency adjacency;
+    adjacency.offsets.assign(vertexCount + 1, 0);
+    for(uint32_t index : indices){
+        adjacency.offsets[index + 1]++;
+    }
+    for(uint32_t v = 0; v < vertexCount; v++){
+        adjacency.offsets[v + 1] += adjacency.offsets[v];
+    }
+    adjacency.triangles.resize(indices.size());
+    std::vector<uint32_t> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+    for(size_t i = 0; i < indices.size(); i++){
+        adjacency.triangles[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+    return adjacency;
+}
+
+// fifo post-transform cache, a vertex is in it while fewer than cacheSize others were loaded after it
+// reset() empties it without touching every entry
+struct CacheSimulation{
+    std::vector<uint32_t> loadedAt;
+    uint32_t cacheSize;
+    uint32_t timestamp;
+
+    CacheSimulation(uint32_t vertexCount, uint32_t cacheSize) :
+        loadedAt(vertexCount, 0), cacheSize(cacheSize), timestamp(cacheSize + 1) {}
+
+    bool contains(uint32_t vertex) const { return timestamp - loadedAt[vertex] <= cacheSize; }
+    // returns whether it missed
+    bool access(uint32_t vertex){
+        if(contains(vertex)){
+            return false;
+        }
+        loadedAt[vertex] = timestamp++;
+        return true;
+    }
+    uint32_t accessTriangle(const uint32_t* triangle){
+        return access(triangle[0]) + access(triangle[1]) + access(triangle[2]);
+    }
+    void reset(){ timestamp += cacheSize + 1; }
+};
+
+size_t cacheMisses(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize){
+    CacheSimulation cache(vertexCount, cacheSize);
+    size_t misses = 0;
+    for(uint32_t index : indices){
+        misses += cache.access(index);
+    }
+    return misses;
+}
+
+void validate(const MeshData& mesh){
+    if(mesh.vertexStride == 0 || mesh.indices.size() % 3 != 0){
+        throw std::invalid_argument("Mesh processing needs a vertex stride and a triangle list!");
+    }
+    if(mesh.positionComponents < 2 || mesh.positionComponents > 3 ||
+        mesh.positionOffset + sizeof(float) * mesh.positionComponents > mesh.vertexStride){
+        throw std::invalid_argument("Mesh positions have to be 2 or 3 floats inside the vertex!");
+    }
+    uint32_t vertexCount = mesh.vertexCount();
+    for(uint32_t index : mesh.indices){
+        if(index >= vertexCount){
+            throw std::invalid_argument("Mesh index is past the last vertex!");
+        }
+    }
+    for(const auto& lod : mesh.lods){
+        if(lod.size() % 3 != 0){
+            throw std::invalid_argument("Mesh LODs have to be triangle lists!");
+        }
+        for(uint32_t index : lod){
+            if(index >= vertexCount){
+                throw std::invalid_argument("Mesh LOD index is past the last vertex!");
+            }
+        }
+    }
+}
+
+MeshStats measure(const MeshData& mesh, uint32_t cacheSize){
+    MeshStats stats;
+    stats.acmr = computeAcmr(mesh.indices, mesh.vertexCount(), cacheSize);
+    stats.atvr = computeAtvr(mesh.indices, mesh.vertexCount(), cacheSize);
+    stats.overdraw = computeOverdraw(mesh, mesh.indices);
+    return stats;
+}
+
+// depth test rasterizer with the pixel centers at +0.5, counts what passed
+// counter clockwise is the front face like GraphicsPipelineConfig's default, back faces are culled
+void rasterize(std::vector<float>& depth, int resolution, const Vec3* triangle, uint64_t& shaded){
+    Vec3 a = triangle[0], b = triangle[1], c = triangle[2];
+    float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    if(area < 1e-12f){
+        return;
+    }
+    int minX = std::max(0, static_cast<int>(std::floor(std::min({a.x, b.x, c.x}))));
+    int maxX = std::min(resolution - 1, static_cast<int>(std::ceil(std::max({a.x, b.x, c.x}))));
+    int minY = std::max(0, static_cast<int>(std::floor(std::min({a.y, b.y, c.y}))));
+    int maxY = std::min(resolution - 1, static_cast<int>(std::ceil(std::max({a.y, b.y, c.y}))));
+
+    float inverseArea = 1.0f / area;
+    for(int y = minY; y <= maxY; y++){
+        float py = y + 0.5f;
+        for(int x = minX; x <= maxX; x++){
+            float px = x + 0.5f;
+            float wa = ((c.x - b.x) * (py - b.y) - (c.y - b.y) * (px - b.x)) * inverseArea;
+            float wb = ((a.x - c.x) * (py - c.y) - (a.y - c.y) * (px - c.x)) * inverseArea;
+            float wc = 1.0f - wa - wb;
+            if(wa < 0.0f || wb < 0.0f || wc < 0.0f){
+                continue;
+            }
+            float z = wa * a.z + wb * b.z + wc * c.z;
+            float& stored = depth[static_cast<size_t>(y) * resolution + x];
+            if(z < stored){
+                stored = z;
+                shaded++;
+            }
+        }
+    }
+}
+
+}
+
+uint32_t deduplicateVertices(MeshData& mesh){
+    uint32_t vertexCount = mesh.vertexCount();
+    uint32_t stride = mesh.vertexStride;
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<uint8_t> vertices;
+    vertices.reserve(mesh.vertices.size());
+
+    // keyed by the bytes themselves, padding inside the vertex type has to be zeroed for equal vertices to match
+    {
+        std::unordered_map<std::string_view, uint32_t> unique;
+        unique.reserve(vertexCount);
+        uint32_t count = 0;
+        for(uint32_t v = 0; v < vertexCount; v++){
+            const uint8_t* bytes = mesh.vertices.data() + static_cast<size_t>(v) * stride;
+            auto [it, inserted] = unique.emplace(std::string_view(reinterpret_cast<const char*>(bytes), stride), count);
+            if(inserted){
+                vertices.insert(vertices.end(), bytes, bytes + stride);
+                count++;
+            }
+            remap[v] = it->second;
+        }
+    }
+
+    for(uint32_t& index : mesh.indices){
+        index = remap[index];
+    }
+    for(auto& lod : mesh.lods){
+        for(uint32_t& index : lod){
+            index = remap[index];
+        }
+    }
+    mesh.vertices.swap(vertices);
+    return mesh.vertexCount();
+}
+
+// Tipsify (Sander et al. 2007): fans around a vertex still in the cache, the next one is the neighbour that stays
+// cached longest for its remaining triangles, dead ends fall back to recently used vertices and then the input order
+void optimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize, std::vector<uint32_t>* clusters){
+    if(clusters != nullptr){
+        clusters->clear();
+    }
+    size_t triangleCount = indices.size() / 3;
+    if(triangleCount == 0){
+        return;
+    }
+
+    Adjacency adjacency = buildAdjacency(indices, vertexCount);
+    std::vector<uint32_t> live(vertexCount);
+    for(uint32_t v = 0; v < vertexCount; v++){
+        live[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+    }
+    std::vector<bool> emitted(triangleCount, false);
+    CacheSimulation cache(vertexCount, cacheSize);
+    std::vector<uint32_t> deadEnd;
+    deadEnd.reserve(indices.size());
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    uint32_t cursor = 0;
+
+    auto skipDeadEnd = [&]() -> uint32_t {
+        while(!deadEnd.empty()){
+            uint32_t v = deadEnd.back();
+            deadEnd.pop_back();
+            if(live[v] > 0){
+                return v;
+            }
+        }
+        for(; cursor < vertexCount; cursor++){
+            if(live[cursor] > 0){
+                return cursor;
+            }
+        }
+        return unmapped;
+    };
+
+    uint32_t fan = skipDeadEnd();
+    while(fan != unmapped){
+        candidates.clear();
+        for(uint32_t i = adjacency.offsets[fan]; i < adjacency.offsets[fan + 1]; i++){
+            uint32_t triangle = adjacency.triangles[i];
+            if(emitted[triangle]){
+                continue;
+            }
+            emitted[triangle] = true;
+            for(uint32_t k = 0; k < 3; k++){
+                uint32_t v = indices[triangle * 3 + k];
+                output.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                cache.access(v);
+            }
+        }
+
+        uint32_t next = unmapped;
+        int64_t best = -1;
+        for(uint32_t v : candidates){
+            if(live[v] == 0){
+                continue;
+            }
+            // still cached after emitting its remaining triangles: prefer the oldest, it's about to drop out
+            int64_t age = cache.timestamp - cache.loadedAt[v];
+            int64_t priority = age + 2 * static_cast<int64_t>(live[v]) <= cacheSize ? age : 0;
+            if(priority > best){
+                best = priority;
+                next = v;
+            }
+        }
+        if(next == unmapped){
+            next = skipDeadEnd();
+            // a jump to a vertex that left the cache starts over, the clusters in between can be reordered freely
+            if(clusters != nullptr && next != unmapped && !cache.contains(next)){
+                clusters->push_back(static_cast<uint32_t>(output.size() / 3));
+            }
+        }
+        fan = next;
+    }
+
+    if(clusters != nullptr && (clusters->empty() || clusters->front() != 0)){
+        clusters->insert(clusters->begin(), 0);
+    }
+    indices.swap(output);
+}
+
+// sorts clusters by how far they face out of the mesh (Sander et al. 2007 / Nehab et al. 2006), so on most views the
+// outer layers are drawn first and depth test what's behind them
+void optimizeOverdraw(const MeshData& mesh, std::vector<uint32_t>& indices, const std::vector<uint32_t>& clusters,
+    uint32_t cacheSize, float threshold){
+    size_t triangleCount = indices.size() / 3;
+    if(triangleCount == 0){
+        return;
+    }
+    uint32_t vertexCount = mesh.vertexCount();
+
+    std::vector<uint32_t> hard(clusters.begin(), clusters.end());
+    hard.push_back(static_cast<uint32_t>(triangleCount));
+    std::sort(hard.begin(), hard.end());
+    hard.erase(std::unique(hard.begin(), hard.end()), hard.end());
+    if(hard.front() != 0){
+        hard.insert(hard.begin(), 0);
+    }
+
+    // splits inside each hard cluster where its ACMR so far is within the threshold of the whole cluster's
+    CacheSimulation cache(vertexCount, cacheSize);
+    std::vector<uint32_t> starts;
+    for(size_t c = 0; c + 1 < hard.size(); c++){
+        uint32_t begin = hard[c], end = hard[c + 1];
+        if(begin >= end){
+            continue;
+        }
+        cache.reset();
+        size_t clusterMisses = 0;
+        for(uint32_t t = begin; t < end; t++){
+            clusterMisses += cache.accessTriangle(&indices[t * 3]);
+        }
+        float target = threshold * static_cast<float>(clusterMisses) / (end - begin);
+
+        cache.reset();
+        starts.push_back(begin);
+        uint32_t start = begin;
+        size_t misses = 0;
+        for(uint32_t t = begin; t < end; t++){
+            misses += cache.accessTriangle(&indices[t * 3]);
+            if(t + 1 < end && static_cast<float>(misses) / (t - start + 1) <= target){
+                starts.push_back(t + 1);
+                start = t + 1;
+                misses = 0;
+                cache.reset();
+            }
+        }
+    }
+    starts.push_back(static_cast<uint32_t>(triangleCount));
+
+    size_t clusterCount = starts.size() - 1;
+    std::vector<Vec3> centroids(clusterCount, Vec3{0.0f, 0.0f, 0.0f});
+    std::vector<Vec3> normals(clusterCount, Vec3{0.0f, 0.0f, 0.0f});
+    Vec3 meshCentroid{0.0f, 0.0f, 0.0f};
+    float meshArea = 0.0f;
+    for(size_t c = 0; c < clusterCount; c++){
+        float clusterArea = 0.0f;
+        for(uint32_t t = starts[c]; t < starts[c + 1]; t++){
+            Vec3 a = position(mesh, indices[t * 3]);
+            Vec3 b = position(mesh, indices[t * 3 + 1]);
+            Vec3 d = position(mesh, indices[t * 3 + 2]);
+            Vec3 normal = cross(b - a, d - a);
+            float area = length(normal);
+            Vec3 center = (a + b + d) * (1.0f / 3.0f);
+            centroids[c] = centroids[c] + center * area;
+            normals[c] = normals[c] + normal;
+            clusterArea += area;
+        }
+        meshCentroid = meshCentroid + centroids[c];
+        meshArea += clusterArea;
+        centroids[c] = clusterArea > 0.0f ? centroids[c] * (1.0f / clusterArea) : position(mesh, indices[starts[c] * 3]);
+    }
+    if(meshArea > 0.0f){
+        meshCentroid = meshCentroid * (1.0f / meshArea);
+    }
+
+    std::vector<float> keys(clusterCount);
+    for(size_t c = 0; c < clusterCount; c++){
+        float normalLength = length(normals[c]);
+        keys[c] = normalLength > 0.0f ? dot(centroids[c] - meshCentroid, normals[c]) / normalLength : 0.0f;
+    }
+    std::vector<uint32_t> order(clusterCount);
+    for(uint32_t c = 0; c < clusterCount; c++){
+        order[c] = c;
+    }
+    std::stable_sort(order.begin(), order.end(), [&keys](uint32_t a, uint32_t b){ return keys[a] > keys[b]; });
+
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    for(uint32_t c : order){
+        output.insert(output.end(), indices.begin() + static_cast<size_t>(starts[c]) * 3,
+            indices.begin() + static_cast<size_t>(starts[c + 1]) * 3);
+    }
+    indices.swap(output);
+}
+
+void optimizeVertexFetch(MeshData& mesh){
+    uint32_t stride = mesh.vertexStride;
+    std::vector<uint32_t> remap(mesh.vertexCount(), unmapped);
+    std::vector<uint8_t> vertices;
+    vertices.reserve(mesh.vertices.size());
+    uint32_t count = 0;
+
+    auto map = [&](uint32_t& index){
+        if(remap[index] == unmapped){
+            remap[index] = count++;
+            const uint8_t* bytes = mesh.vertices.data() + static_cast<size_t>(index) * stride;
+            vertices.insert(vertices.end(), bytes, bytes + stride);
+        }
+        index = remap[index];
+    };
+    for(uint32_t& index : mesh.indices){
+        map(index);
+    }
+    // LODs set by hand may use vertices the full mesh doesn't, those are kept after the full mesh's
+    for(auto& lod : mesh.lods){
+        for(uint32_t& index : lod){
+            map(index);
+        }
+    }
+    mesh.vertices.swap(vertices);
+}
+
+// vertex clustering (Rossignac & Borrel 1993) on a grid over the bounding box, each cell collapses into its vertex
+// nearest the cell's average so no new vertices are needed, the finest grid that still meets the target wins
+std::vector<uint32_t> simplifyIndices(const MeshData& mesh, const std::vector<uint32_t>& indices, size_t targetIndexCount){
+    if(indices.size() <= targetIndexCount){
+        return indices;
+    }
+    uint32_t vertexCount = mesh.vertexCount();
+
+    std::vector<uint32_t> used;
+    std::vector<bool> isUsed(vertexCount, false);
+    for(uint32_t index : indices){
+        if(!isUsed[index]){
+            isUsed[index] = true;
+            used.push_back(index);
+        }
+    }
+    std::vector<Vec3> positions(vertexCount, Vec3{0.0f, 0.0f, 0.0f});
+    Vec3 minimum{std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+    Vec3 maximum = minimum * -1.0f;
+    for(uint32_t v : used){
+        Vec3 p = positions[v] = position(mesh, v);
+        minimum = {std::min(minimum.x, p.x), std::min(minimum.y, p.y), std::min(minimum.z, p.z)};
+        maximum = {std::max(maximum.x, p.x), std::max(maximum.y, p.y), std::max(maximum.z, p.z)};
+    }
+    Vec3 extent = maximum - minimum;
+    float size = std::max({extent.x, extent.y, extent.z});
+    if(size <= 0.0f){
+        return {};
+    }
+
+    std::vector<uint32_t> cellOf(vertexCount);
+    std::unordered_map<uint64_t, uint32_t> cellIds;
+    std::vector<Vec3> cellSums;
+    std::vector<uint32_t> cellCounts;
+    std::vector<uint32_t> representative;
+    std::vector<float> representativeDistance;
+
+    auto collapse = [&](uint32_t grid, std::vector<uint32_t>& result){
+        cellIds.clear();
+        cellSums.clear();
+        cellCounts.clear();
+        float scale = grid / size;
+        auto cell = [&](float value, float origin){
+            return static_cast<uint64_t>(std::min(static_cast<uint32_t>((value - origin) * scale), grid - 1));
+        };
+        for(uint32_t v : used){
+            Vec3 p = positions[v];
+            uint64_t key = (cell(p.x, minimum.x) << 40) | (cell(p.y, minimum.y) << 20) | cell(p.z, minimum.z);
+            auto [it, inserted] = cellIds.emplace(key, static_cast<uint32_t>(cellSums.size()));
+            if(inserted){
+                cellSums.push_back(Vec3{0.0f, 0.0f, 0.0f});
+                cellCounts.push_back(0);
+            }
+            cellOf[v] = it->second;
+            cellSums[it->second] = cellSums[it->second] + p;
+            cellCounts[it->second]++;
+        }
+
+        representative.assign(cellSums.size(), unmapped);
+        representativeDistance.assign(cellSums.size(), std::numeric_limits<float>::max());
+        for(uint32_t v : used){
+            uint32_t c = cellOf[v];
+            Vec3 offset = positions[v] - cellSums[c] * (1.0f / cellCounts[c]);
+            float distance = dot(offset, offset);
+            if(distance < representativeDistance[c]){
+                representativeDistance[c] = distance;
+                representative[c] = v;
+            }
+        }
+
+        result.clear();
+        for(size_t i = 0; i + 2 < indices.size(); i += 3){
+            uint32_t a = representative[cellOf[indices[i]]];
+            uint32_t b = representative[cellOf[indices[i + 1]]];
+            uint32_t c = representative[cellOf[indices[i + 2]]];
+            if(a != b && b != c && a != c){
+                result.insert(result.end(), {a, b, c});
+            }
+        }
+    };
+
+    // a single cell collapses everything, so there always is an answer
+    std::vector<uint32_t> best;
+    std::vector<uint32_t> candidate;
+    uint32_t low = 1, high = 1024;
+    while(low <= high){
+        uint32_t grid = low + (high - low) / 2;
+        collapse(grid, candidate);
+        if(candidate.size() <= targetIndexCount){
+            best.swap(candidate);
+            low = grid + 1;
+        }
+        else{
+            high = grid - 1;
+        }
+    }
+    return best;
+}
+
+float computeAcmr(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize){
+    if(indices.size() < 3){
+        return 0.0f;
+    }
+    return static_cast<float>(cacheMisses(indices, vertexCount, cacheSize)) / (indices.size() / 3);
+}
+
+float computeAtvr(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize){
+    std::vector<bool> isUsed(vertexCount, false);
+    size_t usedCount = 0;
+    for(uint32_t index : indices){
+        if(!isUsed[index]){
+            isUsed[index] = true;
+            usedCount++;
+        }
+    }
+    if(usedCount == 0){
+        return 0.0f;
+    }
+    return static_cast<float>(cacheMisses(indices, vertexCount, cacheSize)) / usedCount;
+}
+
+// the mesh scaled into a unit cube and drawn in index order from both sides of each axis
+float computeOverdraw(const MeshData& mesh, const std::vector<uint32_t>& indices){
+    constexpr int resolution = 256;
+    if(indices.size() < 3){
+        return 0.0f;
+    }
+
+    Vec3 minimum{std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+    Vec3 maximum = minimum * -1.0f;
+    for(uint32_t index : indices){
+        Vec3 p = position(mesh, index);
+        minimum = {std::min(minimum.x, p.x), std::min(minimum.y, p.y), std::min(minimum.z, p.z)};
+        maximum = {std::max(maximum.x, p.x), std::max(maximum.y, p.y), std::max(maximum.z, p.z)};
+    }
+    Vec3 extent = maximum - minimum;
+    float size = std::max({extent.x, extent.y, extent.z});
+    if(size <= 0.0f){
+        return 0.0f;
+    }
+    float scale = 1.0f / size;
+
+    std::vector<float> depth(static_cast<size_t>(resolution) * resolution);
+    uint64_t shaded = 0, covered = 0;
+    for(int axis = 0; axis < 3; axis++){
+        for(bool flip : {false, true}){
+            std::fill(depth.begin(), depth.end(), std::numeric_limits<float>::max());
+            for(size_t i = 0; i + 2 < indices.size(); i += 3){
+                Vec3 triangle[3];
+                for(size_t k = 0; k < 3; k++){
+                    Vec3 p = (position(mesh, indices[i + k]) - minimum) * scale;
+                    float coords[3] = {p.x, p.y, p.z};
+                    // looking down the axis from its negative side (mirrored so winding still holds), or from its positive side
+                    float u = coords[(axis + 1) % 3], v = coords[(axis + 2) % 3], z = coords[axis];
+                    triangle[k] = {(flip ? u : 1.0f - u) * resolution, v * resolution, flip ? 1.0f - z : z};
+                }
+                rasterize(depth, resolution, triangle, shaded);
+            }
+            for(float value : depth){
+                covered += value != std::numeric_limits<float>::max();
+            }
+        }
+    }
+    return covered == 0 ? 0.0f : static_cast<float>(shaded) / covered;
+}
+
+MeshReport processMesh(MeshData& mesh, const MeshProcessingConfig& config){
+    validate(mesh);
+    auto start = std::chrono::steady_clock::now();
+
+    MeshReport report;
+    report.verticesBefore = mesh.vertexCount();
+    if(config.measure){
+        report.before = measure(mesh, config.cacheSize);
+    }
+
+    if(config.deduplicate){
+        deduplicateVertices(mesh);
+    }
+    std::vector<uint32_t> clusters{0};
+    if(config.optimizeVertexCache){
+        optimizeVertexCache(mesh.indices, mesh.vertexCount(), config.cacheSize, &clusters);
+    }
+    if(config.optimizeOverdraw){
+        optimizeOverdraw(mesh, mesh.indices, clusters, config.cacheSize, config.overdrawThreshold);
+    }
+    if(config.optimizeVertexFetch){
+        optimizeVertexFetch(mesh);
+    }
+
+    // LODs the caller already set are kept, generated ones come after them
+    for(float ratio : config.lodRatios){
+        size_t target = static_cast<size_t>(mesh.indices.size() * std::clamp(ratio, 0.0f, 1.0f)) / 3 * 3;
+        std::vector<uint32_t> lod = simplifyIndices(mesh, mesh.indices, target);
+        if(config.optimizeVertexCache){
+            optimizeVertexCache(lod, mesh.vertexCount(), config.cacheSize);
+        }
+        report.lodIndexCounts.push_back(static_cast<uint32_t>(lod.size()));
+        mesh.lods.push_back(std::move(lod));
+    }
+
+    report.verticesAfter = mesh.vertexCount();
+    if(config.measure){
+        report.after = measure(mesh, config.cacheSize);
+    }
+    report.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return report;
+}
+
+std::vector<MeshReport> processMeshes(std::vector<MeshData>& meshes, const MeshProcessingConfig& config, uint32_t threadCount){
+    ThreadPool pool(threadCount);
+    std::vector<std::future<MeshReport>> results;
+    results.reserve(meshes.size());
+    for(MeshData& mesh : meshes){
+        results.push_back(pool.submit([&mesh, &config](){ return processMesh(mesh, config); }));
+    }
+
+    std::vector<MeshReport> reports;
+    reports.reserve(meshes.size());
+    for(auto& result : results){
+        reports.push_back(result.get());
+    }
+    return reports;
+}
+
+std::string meshReportString(const MeshReport& report){
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(3)
+         << "vertices " << report.verticesBefore << " -> " << report.verticesAfter
+         << ", ACMR " << report.before.acmr << " -> " << report.after.acmr
+         << ", ATVR " << report.before.atvr << " -> " << report.after.atvr
+         << ", overdraw " << report.before.overdraw << " -> " << report.after.overdraw;
+    if(!report.lodIndexCounts.empty()){
+        text << ", LOD indices";
+        for(uint32_t count : report.lodIndexCounts){
+            text << " " << count;
+        }
+    }
+    text << " (" << std::setprecision(1) << report.milliseconds << " ms)";
+    return text.str();
+}
+
+}
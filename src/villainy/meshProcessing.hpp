@@ -0,0 +1,113 @@
+#ifndef VILLAINY_MESH_PROCESSING
+#define VILLAINY_MESH_PROCESSING
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "utils.hpp"
+
+namespace vlny{
+
+// an imported triangle list before it goes into a VertexBuffer / IndexBuffer / GeometryPool
+// vertices are raw bytes with a fixed stride, positions are floats at positionOffset (used for overdraw and LODs),
+// 2 component positions are treated as z = 0
+struct MeshData{
+    std::vector<uint8_t> vertices;
+    uint32_t vertexStride = 0;
+    uint32_t positionOffset = 0;
+    uint32_t positionComponents = 3;
+    std::vector<uint32_t> indices;
+    // coarser index buffers over the same vertices, processMesh remaps ones set by hand along with the vertices and
+    // appends one per MeshProcessingConfig::lodRatios
+    std::vector<std::vector<uint32_t>> lods;
+
+    template <typename Vertex>
+    static MeshData from(ArrayView<Vertex> vertices, ArrayView<uint32_t> indices, uint32_t positionOffset = 0,
+        uint32_t positionComponents = 3);
+    template <typename Vertex>
+    std::vector<Vertex> getVertices() const;
+
+    uint32_t vertexCount() const { return vertexStride == 0 ? 0 : static_cast<uint32_t>(vertices.size() / vertexStride); }
+};
+
+struct MeshProcessingConfig{
+    bool deduplicate = true; // merge bitwise identical vertices
+    bool optimizeVertexCache = true; // reorder triangles for the post-transform cache (Tipsify)
+    uint32_t cacheSize = 16; // fifo size optimized for and measured with
+    // reorder the cache optimized clusters so outward facing ones draw first, clusters are split further as long as
+    // ACMR stays within `overdrawThreshold` times the cache optimized one
+    bool optimizeOverdraw = true;
+    float overdrawThreshold = 1.05f;
+    bool optimizeVertexFetch = true; // vertices in the order the indices first use them, drops unused ones
+    // one LOD per ratio of the full index count (e.g. {0.5f, 0.25f}), made by vertex clustering over the final vertices
+    std::vector<float> lodRatios;
+    bool measure = true; // fill MeshReport::before / after, overdraw rasterizes the mesh from 6 directions
+};
+
+struct MeshStats{
+    float acmr = 0.0f; // cache misses per triangle, 0.5 is the ideal for a regular grid, 3 the worst
+    float atvr = 0.0f; // cache misses per vertex, 1 is ideal
+    float overdraw = 0.0f; // shaded / covered pixels, counter clockwise front faces, 1 is ideal
+};
+
+struct MeshReport{
+    uint32_t verticesBefore = 0;
+    uint32_t verticesAfter = 0;
+    MeshStats before;
+    MeshStats after;
+    std::vector<uint32_t> lodIndexCounts; // of the LODs made from lodRatios
+    double milliseconds = 0.0;
+};
+
+// runs the enabled steps in order: deduplicate, vertex cache, overdraw, vertex fetch, LODs
+MeshReport processMesh(MeshData& mesh, const MeshProcessingConfig& config = {});
+// one mesh per task on `threadCount` threads (0 = hardware concurrency), the first exception comes out here
+std::vector<MeshReport> processMeshes(std::vector<MeshData>& meshes, const MeshProcessingConfig& config = {}, uint32_t threadCount = 0);
+// one line for the log
+std::string meshReportString(const MeshReport& report);
+
+// the single steps
+uint32_t deduplicateVertices(MeshData& mesh); // returns the vertex count afterwards
+// `clusters` receives the triangle index each cluster starts at, a cluster ends where the optimizer had to jump
+void optimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize = 16,
+    std::vector<uint32_t>* clusters = nullptr);
+void optimizeOverdraw(const MeshData& mesh, std::vector<uint32_t>& indices, const std::vector<uint32_t>& clusters,
+    uint32_t cacheSize = 16, float threshold = 1.05f);
+void optimizeVertexFetch(MeshData& mesh);
+// index buffer of about `targetIndexCount` over the mesh's vertices, never more
+std::vector<uint32_t> simplifyIndices(const MeshData& mesh, const std::vector<uint32_t>& indices, size_t targetIndexCount);
+
+float computeAcmr(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize = 16);
+float computeAtvr(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize = 16);
+float computeOverdraw(const MeshData& mesh, const std::vector<uint32_t>& indices);
+
+template <typename Vertex>
+MeshData MeshData::from(ArrayView<Vertex> vertices, ArrayView<uint32_t> indices, uint32_t positionOffset,
+    uint32_t positionComponents){
+    MeshData mesh;
+    mesh.vertexStride = sizeof(Vertex);
+    mesh.positionOffset = positionOffset;
+    mesh.positionComponents = positionComponents;
+    mesh.vertices.resize(vertices.size() * sizeof(Vertex));
+    if(!vertices.empty()){
+        memcpy(mesh.vertices.data(), vertices.data(), mesh.vertices.size());
+    }
+    mesh.indices.assign(indices.begin(), indices.end());
+    return mesh;
+}
+
+template <typename Vertex>
+std::vector<Vertex> MeshData::getVertices() const{
+    std::vector<Vertex> result(vertices.size() / sizeof(Vertex));
+    if(!result.empty()){
+        memcpy(result.data(), vertices.data(), result.size() * sizeof(Vertex));
+    }
+    return result;
+}
+
+}
+
+#endif
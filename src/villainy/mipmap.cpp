@@ -0,0 +1,116 @@
+#include "mipmap.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace vlny{
+
+namespace{
+
+const std::array<float, 256>& srgbToLinearTable(){
+    static const std::array<float, 256> table = []{
+        std::array<float, 256> t{};
+        for(int i = 0; i < 256; i++){
+            float c = i / 255.0f;
+            t[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        return t;
+    }();
+    return table;
+}
+
+// linear [0, 1] quantized to 12 bits -> srgb byte, avoids a pow per texel
+const std::array<uint8_t, 4096>& linearToSrgbTable(){
+    static const std::array<uint8_t, 4096> table = []{
+        std::array<uint8_t, 4096> t{};
+        for(int i = 0; i < 4096; i++){
+            float l = i / 4095.0f;
+            float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+            t[i] = static_cast<uint8_t>(std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f));
+        }
+        return t;
+    }();
+    return table;
+}
+
+}
+
+uint32_t computeMipLevels(uint32_t width, uint32_t height){
+    uint32_t levels = 1;
+    uint32_t size = std::max(width, height);
+    while(size > 1){
+        size >>= 1;
+        levels++;
+    }
+    return levels;
+}
+
+size_t mipLevelOffset(uint32_t width, uint32_t height, uint32_t level, uint32_t bytesPerPixel){
+    return mipChainSize(width, height, level, bytesPerPixel);
+}
+
+size_t mipChainSize(uint32_t width, uint32_t height, uint32_t levels, uint32_t bytesPerPixel){
+    size_t size = 0;
+    for(uint32_t i = 0; i < levels; i++){
+        size += static_cast<size_t>(width) * height * bytesPerPixel;
+        width = std::max(1u, width / 2);
+        height = std::max(1u, height / 2);
+    }
+    return size;
+}
+
+void downsampleRGBA8(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, uint8_t* dst, bool srgb){
+    uint32_t dstWidth = std::max(1u, srcWidth / 2);
+    uint32_t dstHeight = std::max(1u, srcHeight / 2);
+    size_t srcStride = static_cast<size_t>(srcWidth) * 4;
+
+    const auto& toLinear = srgbToLinearTable();
+    const auto& toSrgb = linearToSrgbTable();
+
+    for(uint32_t y = 0; y < dstHeight; y++){
+        const uint8_t* row0 = src + std::min(2 * y, srcHeight - 1) * srcStride;
+        const uint8_t* row1 = src + std::min(2 * y + 1, srcHeight - 1) * srcStride;
+        uint8_t* out = dst + static_cast<size_t>(y) * dstWidth * 4;
+
+        if(!srgb && srcWidth >= 2){
+            // fast path, plain integer loop the compiler can vectorize
+            uint32_t pairs = srcWidth / 2;
+            for(uint32_t x = 0; x < pairs; x++){
+                for(uint32_t c = 0; c < 4; c++){
+                    uint32_t sum = row0[8 * x + c] + row0[8 * x + 4 + c] + row1[8 * x + c] + row1[8 * x + 4 + c];
+                    out[4 * x + c] = static_cast<uint8_t>((sum + 2) >> 2);
+                }
+            }
+            continue;
+        }
+
+        for(uint32_t x = 0; x < dstWidth; x++){
+            uint32_t x0 = std::min(2 * x, srcWidth - 1) * 4;
+            uint32_t x1 = std::min(2 * x + 1, srcWidth - 1) * 4;
+            for(uint32_t c = 0; c < 4; c++){
+                if(srgb && c < 3){
+                    float l = (toLinear[row0[x0 + c]] + toLinear[row0[x1 + c]] + toLinear[row1[x0 + c]] + toLinear[row1[x1 + c]]) * 0.25f;
+                    out[4 * x + c] = toSrgb[static_cast<size_t>(l * 4095.0f + 0.5f)];
+                }
+                else{ // alpha is always linear
+                    uint32_t sum = row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c];
+                    out[4 * x + c] = static_cast<uint8_t>((sum + 2) >> 2);
+                }
+            }
+        }
+    }
+}
+
+void generateMipChainRGBA8(uint8_t* chain, uint32_t width, uint32_t height, uint32_t levels, bool srgb){
+    uint8_t* src = chain;
+    for(uint32_t i = 1; i < levels; i++){
+        uint8_t* dst = src + static_cast<size_t>(width) * height * 4;
+        downsampleRGBA8(src, width, height, dst, srgb);
+        width = std::max(1u, width / 2);
+        height = std::max(1u, height / 2);
+        src = dst;
+    }
+}
+
+}
@@ -0,0 +1,24 @@
+#ifndef VILLAINY_MIPMAP
+#define VILLAINY_MIPMAP
+
+#include <cstdint>
+#include <cstddef>
+
+namespace vlny{
+
+// number of levels in a full mip chain down to 1x1
+uint32_t computeMipLevels(uint32_t width, uint32_t height);
+// byte size of the first `levels` levels of a tightly packed chain
+size_t mipChainSize(uint32_t width, uint32_t height, uint32_t levels, uint32_t bytesPerPixel);
+size_t mipLevelOffset(uint32_t width, uint32_t height, uint32_t level, uint32_t bytesPerPixel);
+
+// 2x2 box downsample of an RGBA8 image, odd edges are clamped
+// srgb = true filters in linear space (matches what vkCmdBlitImage does for _SRGB formats)
+void downsampleRGBA8(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, uint8_t* dst, bool srgb);
+
+// fills levels 1..levels-1 of a tightly packed RGBA8 chain, level 0 must already be written
+void generateMipChainRGBA8(uint8_t* chain, uint32_t width, uint32_t height, uint32_t levels, bool srgb);
+
+}
+
+#endif
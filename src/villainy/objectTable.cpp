@@ -0,0 +1,145 @@
+#include "objectTable.hpp"
+
+#include "context.hpp"
+#include "buffer.hpp"
+
+#include <algorithm>
+
+namespace vlny{
+
+ObjectTable::ObjectTable(Context& context, Window& window, uint32_t capacity, VkDeviceSize recordSize) :
+    context(context), maxFramesInFlight(window.getConfig().maxFramesInFlight), capacity(capacity), recordSize(recordSize) {
+    if(capacity == 0 || recordSize == 0){
+        throw std::runtime_error("Object table needs a capacity and a record size!");
+    }
+
+    VkDeviceSize tableSize = recordSize * capacity;
+    createBuffer(context, tableSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, memory);
+    createBuffer(context, tableSize * maxFramesInFlight, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging, stagingMemory);
+    void* data;
+    vkMapMemory(context.logicalDevice, stagingMemory, 0, tableSize * maxFramesInFlight, 0, &data);
+    stagingMapped = static_cast<uint8_t*>(data);
+
+    records.assign(static_cast<size_t>(tableSize), 0);
+    isDirty.assign(capacity, false);
+    isLive.assign(capacity, false);
+}
+
+ObjectTable::~ObjectTable(){
+    if(stagingMapped != nullptr){
+        vkUnmapMemory(context.logicalDevice, stagingMemory);
+    }
+    if(staging != VK_NULL_HANDLE){
+        vkDestroyBuffer(context.logicalDevice, staging, nullptr);
+    }
+    if(stagingMemory != VK_NULL_HANDLE){
+        vkFreeMemory(context.logicalDevice, stagingMemory, nullptr);
+    }
+    if(buffer != VK_NULL_HANDLE){
+        vkDestroyBuffer(context.logicalDevice, buffer, nullptr);
+    }
+    if(memory != VK_NULL_HANDLE){
+        vkFreeMemory(context.logicalDevice, memory, nullptr);
+    }
+}
+
+uint32_t ObjectTable::add(const void* record){
+    uint32_t index;
+    if(!freeSlots.empty()){
+        index = freeSlots.back();
+        freeSlots.pop_back();
+    }
+    else{
+        if(highWater >= capacity){
+            throw std::runtime_error("Object table is full!");
+        }
+        index = highWater++;
+    }
+    isLive[index] = true;
+    count++;
+    update(index, record);
+    return index;
+}
+
+void ObjectTable::update(uint32_t index, const void* record){
+    if(index >= highWater || !isLive[index]){
+        throw std::runtime_error("Invalid object table index!");
+    }
+    std::memcpy(records.data() + index * recordSize, record, static_cast<size_t>(recordSize));
+    markDirty(index);
+}
+
+void ObjectTable::remove(uint32_t index){
+    if(index >= highWater || !isLive[index]){
+        throw std::runtime_error("Invalid object table index!");
+    }
+    isLive[index] = false;
+    freeSlots.push_back(index);
+    count--;
+}
+
+void ObjectTable::markDirty(uint32_t index){
+    if(!isDirty[index]){
+        isDirty[index] = true;
+        dirty.push_back(index);
+    }
+}
+
+void ObjectTable::recordFrameCommands(VkCommandBuffer commandBuffer, uint32_t frame){
+    if(dirty.empty()){
+        return;
+    }
+
+    // sorted so neighbouring records collapse into one region, the staging slice is packed in the same order
+    std::sort(dirty.begin(), dirty.end());
+    std::vector<VkBufferCopy> regions;
+    VkDeviceSize stagingBase = recordSize * capacity * frame;
+    VkDeviceSize stagingOffset = stagingBase;
+    size_t i = 0;
+    while(i < dirty.size()){
+        size_t j = i + 1;
+        while(j < dirty.size() && dirty[j] == dirty[j - 1] + 1){
+            j++;
+        }
+        VkDeviceSize offset = dirty[i] * recordSize;
+        VkDeviceSize size = (j - i) * recordSize;
+        std::memcpy(stagingMapped + stagingOffset, records.data() + offset, static_cast<size_t>(size));
+
+        VkBufferCopy region{};
+        region.srcOffset = stagingOffset;
+        region.dstOffset = offset;
+        region.size = size;
+        regions.push_back(region);
+
+        stagingOffset += size;
+        i = j;
+    }
+    for(uint32_t index : dirty){
+        isDirty[index] = false;
+    }
+    dirty.clear();
+
+    // earlier frames may still be reading the records this copy overwrites
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = buffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+    vkCmdCopyBuffer(commandBuffer, staging, buffer, scast_ui32(regions.size()), regions.data());
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+}
@@ -0,0 +1,102 @@
+#ifndef VILLAINY_OBJECT_TABLE
+#define VILLAINY_OBJECT_TABLE
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "command.hpp"
+#include "window.hpp"
+
+namespace vlny{
+
+class Context;
+
+// std430 friendly default record, mirror it in the shader:
+//   struct ObjectData { mat4 transform; vec4 boundingSphere; uint materialIndex; };
+//   layout(std430, set = ..., binding = ...) readonly buffer Objects { ObjectData objects[]; };
+//   objects[gl_InstanceIndex]
+struct ObjectData{
+    glm::mat4 transform{1.0f};
+    glm::vec4 boundingSphere{0.0f}; // xyz = center, w = radius
+    uint32_t materialIndex = 0;
+    uint32_t padding[3] = {0, 0, 0};
+};
+
+// scene-wide storage buffer of per-object records, shaders index it with gl_InstanceIndex (RenderObject::objectIndex
+// is passed as firstInstance) or a draw id
+// writes land in a cpu copy, only records changed since the last frame are uploaded: dirty records are sorted,
+// adjacent ones merged into ranges and copied with one vkCmdCopyBuffer in the frame's command buffer,
+// so touching 1% of the objects moves 1% of the bytes
+//
+// register with Renderer::addFrameResource, bind getBuffer() as a storage buffer
+// (DescriptorManager::addExternalBuffer or BindlessTable::addStorageBuffer)
+class ObjectTable : public FrameResource{
+public:
+    ObjectTable(Context& context, Window& window, uint32_t capacity, VkDeviceSize recordSize = sizeof(ObjectData));
+    ~ObjectTable();
+
+    ObjectTable(const ObjectTable&) = delete;
+    ObjectTable& operator=(const ObjectTable&) = delete;
+
+    uint32_t add(const void* record);
+    void update(uint32_t index, const void* record);
+    // the slot is handed out again by a later add(), its old contents stay until then
+    // updating or removing a slot that isn't in use throws
+    void remove(uint32_t index);
+
+    template <typename T>
+    uint32_t add(const T& record) { checkRecord<T>(); return add(static_cast<const void*>(&record)); }
+    template <typename T>
+    void update(uint32_t index, const T& record) { checkRecord<T>(); update(index, static_cast<const void*>(&record)); }
+
+    void recordFrameCommands(VkCommandBuffer commandBuffer, uint32_t frame) override;
+
+    VkBuffer getBuffer() const { return buffer; }
+    VkDeviceSize getBufferSize() const { return recordSize * capacity; }
+    uint32_t getCapacity() const { return capacity; }
+    uint32_t size() const { return count; }
+    size_t dirtyCount() const { return dirty.size(); }
+private:
+    Context& context;
+    uint32_t maxFramesInFlight;
+    uint32_t capacity;
+    VkDeviceSize recordSize;
+    uint32_t count = 0;
+
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+
+    // one region per frame in flight, big enough for the whole table so no update ever has to wait
+    VkBuffer staging = VK_NULL_HANDLE;
+    VkDeviceMemory stagingMemory = VK_NULL_HANDLE;
+    uint8_t* stagingMapped = nullptr;
+
+    std::vector<uint8_t> records; // cpu copy
+    std::vector<uint32_t> dirty;
+    std::vector<bool> isDirty;
+    std::vector<bool> isLive; // added and not removed since
+    std::vector<uint32_t> freeSlots;
+    uint32_t highWater = 0;
+
+    void markDirty(uint32_t index);
+
+    template <typename T>
+    void checkRecord() const{
+        static_assert(std::is_trivially_copyable_v<T>, "Object records have to be trivially copyable!");
+        if(sizeof(T) != recordSize){
+            throw std::runtime_error("Object record size doesn't match the table!");
+        }
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,320 @@
+#include "pipelineCache.hpp"
+
+#include "context.hpp"
+#include "swapchain.hpp"
+#include "window.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+namespace vlny{
+
+namespace{
+
+// fixed-function fields whose dynamic state the pipeline really gets (listed and supported), configs that only differ
+// in those share a pipeline and the values are set per draw instead
+struct DynamicFields{
+    bool cullMode;
+    bool frontFace;
+    bool topology;
+    bool primitiveRestart;
+    bool lineWidth;
+    bool depthTest;
+    bool depthWrite;
+    bool depthCompareOp;
+    bool polygonMode;
+    bool depthClamp;
+};
+
+DynamicFields dynamicFields(const Context& context, const GraphicsPipelineConfig& config){
+    auto dynamic = [&](VkDynamicState state){
+        return std::find(config.dynamicStates.begin(), config.dynamicStates.end(), state) != config.dynamicStates.end() &&
+            context.supportsDynamicState(state);
+    };
+    return {dynamic(VK_DYNAMIC_STATE_CULL_MODE_EXT), dynamic(VK_DYNAMIC_STATE_FRONT_FACE_EXT),
+        dynamic(VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_EXT), dynamic(VK_DYNAMIC_STATE_PRIMITIVE_RESTART_ENABLE_EXT),
+        dynamic(VK_DYNAMIC_STATE_LINE_WIDTH), dynamic(VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT),
+        dynamic(VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT), dynamic(VK_DYNAMIC_STATE_DEPTH_COMPARE_OP_EXT),
+        dynamic(VK_DYNAMIC_STATE_POLYGON_MODE_EXT), dynamic(VK_DYNAMIC_STATE_DEPTH_CLAMP_ENABLE_EXT)};
+}
+
+// a dynamic topology still has to stay in the pipeline's class
+int topologyClass(VkPrimitiveTopology topology){
+    switch(topology){
+    case VK_PRIMITIVE_TOPOLOGY_POINT_LIST:
+        return 0;
+    case VK_PRIMITIVE_TOPOLOGY_LINE_LIST:
+    case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP:
+    case VK_PRIMITIVE_TOPOLOGY_LINE_LIST_WITH_ADJACENCY:
+    case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP_WITH_ADJACENCY:
+        return 1;
+    case VK_PRIMITIVE_TOPOLOGY_PATCH_LIST:
+        return 3;
+    default:
+        return 2;
+    }
+}
+
+// everything that decides whether two pipelines accept the same bindings, vertex buffers and dynamic state
+size_t hashCompatibility(const GraphicsPipelineConfig& config, const DynamicFields& dynamic, const ShaderProgram* program,
+    VkRenderPass renderPass){
+    size_t seed = 0;
+    hashCombine(seed, program);
+    hashCombine(seed, renderPass);
+    for(VkDynamicState state : config.dynamicStates){
+        hashCombine(seed, static_cast<int>(state));
+    }
+    const VertexData& vertexData = config.vertexData;
+    hashCombine(seed, vertexData.binding);
+    hashCombine(seed, static_cast<int>(vertexData.inputRate));
+    hashCombine(seed, vertexData.stride);
+    for(const auto& [format, offset] : vertexData.vertexAttributes){
+        hashCombine(seed, static_cast<int>(format));
+        hashCombine(seed, offset);
+    }
+    hashCombine(seed, dynamic.topology ? topologyClass(vertexData.topology) : static_cast<int>(vertexData.topology));
+    if(!dynamic.primitiveRestart){
+        hashCombine(seed, vertexData.primitiveRestart);
+    }
+    for(VkDescriptorSetLayout layout : config.extraSetLayouts){
+        hashCombine(seed, layout);
+    }
+    for(const VkPushConstantRange& range : config.pushConstantRanges){
+        hashCombine(seed, range.stageFlags);
+        hashCombine(seed, range.offset);
+        hashCombine(seed, range.size);
+    }
+    hashCombine(seed, config.reflectVertexInput);
+    hashCombine(seed, config.descriptorBuffer);
+    return seed;
+}
+
+size_t hashVariant(const GraphicsPipelineConfig& config, const DynamicFields& dynamic, size_t compatibilityKey){
+    size_t seed = compatibilityKey;
+    if(!dynamic.depthClamp){
+        hashCombine(seed, config.depthClamp);
+    }
+    if(!dynamic.polygonMode){
+        hashCombine(seed, static_cast<int>(config.polygonMode));
+    }
+    if(!dynamic.lineWidth){
+        hashCombine(seed, config.lineWidth);
+    }
+    if(!dynamic.cullMode){
+        hashCombine(seed, static_cast<int>(config.cullMode));
+    }
+    if(!dynamic.frontFace){
+        hashCombine(seed, static_cast<int>(config.frontFace));
+    }
+    if(!dynamic.depthTest){
+        hashCombine(seed, config.depthTest);
+    }
+    if(!dynamic.depthWrite){
+        hashCombine(seed, config.depthWrite);
+    }
+    if(!dynamic.depthCompareOp){
+        hashCombine(seed, static_cast<int>(config.depthCompareOp));
+    }
+    return seed;
+}
+
+// `dynamic` is the same for both, equal dynamicStates are checked first
+bool sameConfig(const GraphicsPipelineConfig& a, const GraphicsPipelineConfig& b, const DynamicFields& dynamic){
+    const VertexData& va = a.vertexData;
+    const VertexData& vb = b.vertexData;
+    bool sameRanges = a.pushConstantRanges.size() == b.pushConstantRanges.size();
+    for(size_t i = 0; sameRanges && i < a.pushConstantRanges.size(); i++){
+        const VkPushConstantRange& ra = a.pushConstantRanges[i];
+        const VkPushConstantRange& rb = b.pushConstantRanges[i];
+        sameRanges = ra.stageFlags == rb.stageFlags && ra.offset == rb.offset && ra.size == rb.size;
+    }
+    bool sameTopology = dynamic.topology ? topologyClass(va.topology) == topologyClass(vb.topology) : va.topology == vb.topology;
+    return sameRanges && a.dynamicStates == b.dynamicStates && va.binding == vb.binding && va.inputRate == vb.inputRate &&
+        va.stride == vb.stride && va.vertexAttributes == vb.vertexAttributes && sameTopology &&
+        (dynamic.primitiveRestart || va.primitiveRestart == vb.primitiveRestart) &&
+        (dynamic.depthClamp || a.depthClamp == b.depthClamp) && (dynamic.polygonMode || a.polygonMode == b.polygonMode) &&
+        (dynamic.lineWidth || a.lineWidth == b.lineWidth) && (dynamic.cullMode || a.cullMode == b.cullMode) &&
+        (dynamic.frontFace || a.frontFace == b.frontFace) && (dynamic.depthTest || a.depthTest == b.depthTest) &&
+        (dynamic.depthWrite || a.depthWrite == b.depthWrite) && (dynamic.depthCompareOp || a.depthCompareOp == b.depthCompareOp) &&
+        a.extraSetLayouts == b.extraSetLayouts && a.reflectVertexInput == b.reflectVertexInput &&
+        a.descriptorBuffer == b.descriptorBuffer;
+}
+
+}
+
+PipelineCache::PipelineCache(Context& context, Swapchain& swapchain, uint32_t threadCount, bool optimizeLinked) :
+    context(context), swapchain(swapchain), optimizeLinked(optimizeLinked), pool(threadCount) {
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    if(vkCreatePipelineCache(context.logicalDevice, &cacheInfo, nullptr, &vkPipelineCache) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create pipeline cache!");
+    }
+    if(context.supportsPipelineLibraries()){
+        libraries.emplace(context, vkPipelineCache);
+    }
+}
+
+PipelineCache::~PipelineCache(){
+    pool.waitIdle();
+    variants.clear();
+    retired.clear();
+    libraries.reset();
+    if(vkPipelineCache != VK_NULL_HANDLE){
+        vkDestroyPipelineCache(context.logicalDevice, vkPipelineCache, nullptr);
+    }
+}
+
+VkRenderPass PipelineCache::currentRenderPass() const{
+    return swapchain.renderPass.value().vkRenderPass;
+}
+
+PipelineCache::Variant& PipelineCache::findOrCompile(const GraphicsPipelineConfig& config, ShaderProgram& program){
+    VkRenderPass renderPass = currentRenderPass();
+    DynamicFields dynamic = dynamicFields(context, config);
+    size_t compatibilityKey = hashCompatibility(config, dynamic, &program, renderPass);
+    std::vector<std::unique_ptr<Variant>>& bucket = variants[hashVariant(config, dynamic, compatibilityKey)];
+    for(auto& variant : bucket){
+        if(variant->program == &program && variant->renderPass == renderPass && sameConfig(variant->config, config, dynamic)){
+            return *variant;
+        }
+    }
+
+    auto variant = std::make_unique<Variant>();
+    variant->config = config;
+    variant->program = &program;
+    variant->renderPass = renderPass;
+    variant->compatibilityKey = compatibilityKey;
+    // an unoptimized link is only worth it when the driver makes it cheap, otherwise go straight for the optimized one
+    compile(*variant, libraries && !context.hasFastPipelineLinking());
+    bucket.push_back(std::move(variant));
+    return *bucket.back();
+}
+
+void PipelineCache::compile(Variant& variant, bool optimized){
+    // the workers only create vulkan objects, the layout and library caches they go through are locked
+    // the swapchain stays on this thread, the worker gets its render pass and extent by value
+    Context* ctx = &context;
+    VkRenderPass renderPass = variant.renderPass;
+    VkExtent2D extent = swapchain.swapchainExtent;
+    VkPipelineCache cache = vkPipelineCache;
+    PipelineLibraryCache* libs = libraries ? &*libraries : nullptr;
+    variant.optimizing = variant.pipeline != nullptr;
+    variant.pending = pool.submit([config = variant.config, ctx, renderPass, extent, programPtr = variant.program, cache, libs, optimized](){
+        return std::make_unique<GraphicsPipeline>(config, *ctx, renderPass, extent, *programPtr, cache, libs, optimized);
+    });
+}
+
+bool PipelineCache::poll(Variant& variant){
+    bool ready = variant.pipeline != nullptr;
+    if(variant.failed || !variant.pending.valid() ||
+        variant.pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready){
+        return ready;
+    }
+
+    std::unique_ptr<GraphicsPipeline> built;
+    try{
+        built = variant.pending.get();
+    }
+    catch(const std::exception& e){
+        return compileFailed(variant, e.what());
+    }
+    catch(...){
+        return compileFailed(variant, "unknown error");
+    }
+    if(variant.optimizing){
+        // this frame may already have drawn with it
+        retired.emplace_back(std::move(variant.pipeline), scast_ui32(swapchain.window.getConfig().maxFramesInFlight));
+        variant.optimizing = false;
+        variant.pipeline = std::move(built);
+    }
+    else{
+        variant.pipeline = std::move(built);
+        if(libraries && optimizeLinked && context.hasFastPipelineLinking()){
+            compile(variant, true);
+        }
+    }
+    return true;
+}
+
+// called from poll's catch blocks, nothing is thrown on: the frame being recorded has its fence reset already
+bool PipelineCache::compileFailed(Variant& variant, const std::string& reason){
+    if(variant.optimizing){
+        // the linked pipeline works, keep drawing with it
+        variant.optimizing = false;
+        VILLAINY_VERBOSE_LOG(context.logger, "Optimized pipeline relink failed, keeping the fast linked one.");
+        return true;
+    }
+    variant.failed = true;
+    variant.error = std::current_exception();
+    context.logger.log(ERROR, "Pipeline variant failed to compile: " + reason);
+    return false;
+}
+
+GraphicsPipeline* PipelineCache::get(const GraphicsPipelineConfig& config, ShaderProgram& program){
+    Variant& requested = findOrCompile(config, program);
+    if(poll(requested)){
+        return requested.pipeline.get();
+    }
+
+    // stand-in until the requested state is compiled
+    for(auto& [hash, bucket] : variants){
+        for(auto& variant : bucket){
+            if(variant->compatibilityKey == requested.compatibilityKey && variant.get() != &requested && poll(*variant)){
+                return variant->pipeline.get();
+            }
+        }
+    }
+    return nullptr;
+}
+
+GraphicsPipeline& PipelineCache::getBlocking(const GraphicsPipelineConfig& config, ShaderProgram& program){
+    Variant& variant = findOrCompile(config, program);
+    if(!variant.pipeline && !variant.failed){
+        variant.pending.wait();
+        poll(variant);
+    }
+    if(variant.failed){
+        if(variant.error){
+            std::rethrow_exception(variant.error);
+        }
+        throw std::runtime_error("Pipeline variant failed to compile!");
+    }
+    return *variant.pipeline;
+}
+
+bool PipelineCache::usesLibraries() const{
+    return libraries.has_value();
+}
+
+void PipelineCache::prepareFrame(uint32_t /*frame*/){
+    for(auto& [pipeline, framesLeft] : retired){
+        framesLeft--;
+    }
+    retired.erase(std::remove_if(retired.begin(), retired.end(), [](const auto& entry){ return entry.second == 0; }), retired.end());
+}
+
+void PipelineCache::prepare(const GraphicsPipelineConfig& config, ShaderProgram& program){
+    findOrCompile(config, program);
+}
+
+size_t PipelineCache::readyCount() const{
+    size_t count = 0;
+    for(const auto& [hash, bucket] : variants){
+        for(const auto& variant : bucket){
+            count += variant->pipeline ? 1 : 0;
+        }
+    }
+    return count;
+}
+
+size_t PipelineCache::pendingCount() const{
+    size_t count = 0;
+    for(const auto& [hash, bucket] : variants){
+        for(const auto& variant : bucket){
+            count += variant->pending.valid() ? 1 : 0;
+        }
+    }
+    return count;
+}
+
+}
@@ -0,0 +1,92 @@
+#ifndef VILLAINY_PIPELINE_CACHE
+#define VILLAINY_PIPELINE_CACHE
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <exception>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "command.hpp"
+#include "render.hpp"
+#include "pipelineLibrary.hpp"
+#include "threadPool.hpp"
+
+namespace vlny{
+
+class Context;
+
+// every GraphicsPipeline variant a scene asks for, keyed by its config, shader program and render pass
+// missing variants compile on worker threads, meanwhile get() hands out a ready variant that only differs in
+// fixed-function state (cull mode, polygon mode, ...), same layout, vertex input and dynamic states, so switching
+// a material's state never stalls the frame. compiles share one VkPipelineCache so the driver reuses their work
+// fields the config lists (and the device supports) as dynamic state aren't part of the key, configs that only differ in
+// those share one pipeline and RenderObjectBase::drawRasterState sets them per draw
+//
+// with Context::supportsPipelineLibraries() variants are linked from a PipelineLibraryCache instead, so only the parts
+// that differ compile, and with `optimizeLinked` each one is relinked with link time optimization in the background and
+// swapped in once it's done. register the cache with Renderer::addFrameResource so the pipelines that were swapped
+// out get destroyed once no frame uses them, otherwise they stay until the cache goes
+//
+// not thread safe, use it from the thread that records the frames (RenderObjectBase::setPipelineVariant does)
+class PipelineCache : public FrameResource{
+public:
+    PipelineCache(Context& context, Swapchain& swapchain, uint32_t threadCount = 2, bool optimizeLinked = true);
+    ~PipelineCache(); // waits for the compiles still running
+
+    PipelineCache(const PipelineCache&) = delete;
+    PipelineCache& operator=(const PipelineCache&) = delete;
+
+    // the variant when it's ready, a compatible ready one while it compiles, nullptr if there's none yet
+    // never throws for a failed compile, it runs while a frame is recorded: the error is logged and the variant keeps
+    // getting a stand-in (or nullptr)
+    GraphicsPipeline* get(const GraphicsPipelineConfig& config, ShaderProgram& program);
+    // waits for the compile if it has to, rethrows its error
+    GraphicsPipeline& getBlocking(const GraphicsPipelineConfig& config, ShaderProgram& program);
+    // starts the compile without waiting, e.g. for every material of a level while it loads
+    void prepare(const GraphicsPipelineConfig& config, ShaderProgram& program);
+
+    size_t readyCount() const;
+    size_t pendingCount() const; // includes optimized relinks
+    bool usesLibraries() const;
+
+    void prepareFrame(uint32_t frame) override;
+private:
+    Context& context;
+    Swapchain& swapchain;
+    VkPipelineCache vkPipelineCache = VK_NULL_HANDLE;
+    std::optional<PipelineLibraryCache> libraries;
+    bool optimizeLinked;
+
+    struct Variant{
+        GraphicsPipelineConfig config;
+        ShaderProgram* program;
+        VkRenderPass renderPass;
+        size_t compatibilityKey; // variants with equal keys can stand in for each other
+        std::unique_ptr<GraphicsPipeline> pipeline;
+        std::future<std::unique_ptr<GraphicsPipeline>> pending;
+        bool optimizing = false; // pending is the optimized relink of `pipeline`
+        bool failed = false;
+        std::exception_ptr error; // for getBlocking
+    };
+    std::unordered_map<size_t, std::vector<std::unique_ptr<Variant>>> variants; // hash buckets, compared on lookup
+    // swapped out for their optimized relink, destroyed once every frame in flight has moved on
+    std::vector<std::pair<std::unique_ptr<GraphicsPipeline>, uint32_t>> retired; // pipeline, frames left
+
+    ThreadPool pool; // workers only build into the futures, the destructor drains it before anything else goes
+
+    Variant& findOrCompile(const GraphicsPipelineConfig& config, ShaderProgram& program);
+    void compile(Variant& variant, bool optimized);
+    bool poll(Variant& variant);
+    bool compileFailed(Variant& variant, const std::string& reason);
+    VkRenderPass currentRenderPass() const;
+};
+
+}
+
+#endif
@@ -0,0 +1,358 @@
+#include "pipelineLibrary.hpp"
+
+#include "context.hpp"
+
+#include <type_traits>
+
+namespace vlny{
+
+namespace{
+
+struct KeyWriter{
+    std::string bytes;
+
+    template<typename T>
+    void add(const T& value){
+        static_assert(std::is_trivially_copyable<T>::value, "Library keys are built from plain values!");
+        bytes.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+    void addString(const char* str){
+        std::string s = str != nullptr ? str : "";
+        add(s.size());
+        bytes += s;
+    }
+};
+
+void writeDynamicStates(KeyWriter& key, const VkPipelineDynamicStateCreateInfo* dynamicState){
+    uint32_t count = dynamicState != nullptr ? dynamicState->dynamicStateCount : 0;
+    key.add(count);
+    for(uint32_t i = 0; i < count; i++){
+        key.add(dynamicState->pDynamicStates[i]);
+    }
+}
+
+bool isDynamic(const VkGraphicsPipelineCreateInfo& info, VkDynamicState state){
+    for(uint32_t i = 0; info.pDynamicState != nullptr && i < info.pDynamicState->dynamicStateCount; i++){
+        if(info.pDynamicState->pDynamicStates[i] == state){
+            return true;
+        }
+    }
+    return false;
+}
+
+void writeStage(KeyWriter& key, const VkPipelineShaderStageCreateInfo& stage){
+    key.add(stage.stage);
+    key.add(stage.module);
+    key.addString(stage.pName);
+}
+
+void writeMultisample(KeyWriter& key, const VkPipelineMultisampleStateCreateInfo* multisample){
+    key.add(multisample != nullptr);
+    if(multisample != nullptr){
+        key.add(multisample->rasterizationSamples);
+        key.add(multisample->sampleShadingEnable);
+        key.add(multisample->minSampleShading);
+        key.add(multisample->pSampleMask != nullptr ? multisample->pSampleMask[0] : ~0u);
+        key.add(multisample->alphaToCoverageEnable);
+        key.add(multisample->alphaToOneEnable);
+    }
+}
+
+void writeStencilOp(KeyWriter& key, const VkStencilOpState& op){
+    key.add(op.failOp);
+    key.add(op.passOp);
+    key.add(op.depthFailOp);
+    key.add(op.compareOp);
+    key.add(op.compareMask);
+    key.add(op.writeMask);
+    key.add(op.reference);
+}
+
+// only the state the part is built from goes into its key
+std::string partKey(const VkGraphicsPipelineCreateInfo& info, VkGraphicsPipelineLibraryFlagsEXT part){
+    KeyWriter key;
+    key.add(part);
+    key.add(info.flags);
+    writeDynamicStates(key, info.pDynamicState);
+    if(part != VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT){
+        key.add(info.renderPass);
+        key.add(info.subpass);
+    }
+
+    if(part == VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT){
+        const VkPipelineVertexInputStateCreateInfo& vertexInput = *info.pVertexInputState;
+        key.add(vertexInput.vertexBindingDescriptionCount);
+        for(uint32_t i = 0; i < vertexInput.vertexBindingDescriptionCount; i++){
+            const VkVertexInputBindingDescription& binding = vertexInput.pVertexBindingDescriptions[i];
+            key.add(binding.binding);
+            key.add(binding.stride);
+            key.add(binding.inputRate);
+        }
+        key.add(vertexInput.vertexAttributeDescriptionCount);
+        for(uint32_t i = 0; i < vertexInput.vertexAttributeDescriptionCount; i++){
+            const VkVertexInputAttributeDescription& attribute = vertexInput.pVertexAttributeDescriptions[i];
+            key.add(attribute.location);
+            key.add(attribute.binding);
+            key.add(attribute.format);
+            key.add(attribute.offset);
+        }
+        key.add(info.pInputAssemblyState->topology);
+        key.add(info.pInputAssemblyState->primitiveRestartEnable);
+    }
+    else if(part == VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT){
+        key.add(info.layout);
+        for(uint32_t i = 0; i < info.stageCount; i++){
+            if(info.pStages[i].stage != VK_SHADER_STAGE_FRAGMENT_BIT){
+                writeStage(key, info.pStages[i]);
+            }
+        }
+        const VkPipelineViewportStateCreateInfo& viewport = *info.pViewportState;
+        key.add(viewport.viewportCount);
+        key.add(viewport.scissorCount);
+        // a resize changes them, they don't count when they're dynamic anyway
+        bool staticViewport = !isDynamic(info, VK_DYNAMIC_STATE_VIEWPORT);
+        bool staticScissor = !isDynamic(info, VK_DYNAMIC_STATE_SCISSOR);
+        for(uint32_t i = 0; staticViewport && viewport.pViewports != nullptr && i < viewport.viewportCount; i++){
+            key.add(viewport.pViewports[i].x);
+            key.add(viewport.pViewports[i].y);
+            key.add(viewport.pViewports[i].width);
+            key.add(viewport.pViewports[i].height);
+            key.add(viewport.pViewports[i].minDepth);
+            key.add(viewport.pViewports[i].maxDepth);
+        }
+        for(uint32_t i = 0; staticScissor && viewport.pScissors != nullptr && i < viewport.scissorCount; i++){
+            key.add(viewport.pScissors[i].offset.x);
+            key.add(viewport.pScissors[i].offset.y);
+            key.add(viewport.pScissors[i].extent.width);
+            key.add(viewport.pScissors[i].extent.height);
+        }
+        const VkPipelineRasterizationStateCreateInfo& rasterizer = *info.pRasterizationState;
+        key.add(rasterizer.depthClampEnable);
+        key.add(rasterizer.rasterizerDiscardEnable);
+        key.add(rasterizer.polygonMode);
+        key.add(rasterizer.cullMode);
+        key.add(rasterizer.frontFace);
+        key.add(rasterizer.depthBiasEnable);
+        key.add(rasterizer.depthBiasConstantFactor);
+        key.add(rasterizer.depthBiasClamp);
+        key.add(rasterizer.depthBiasSlopeFactor);
+        key.add(rasterizer.lineWidth);
+    }
+    else if(part == VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT){
+        key.add(info.layout);
+        for(uint32_t i = 0; i < info.stageCount; i++){
+            if(info.pStages[i].stage == VK_SHADER_STAGE_FRAGMENT_BIT){
+                writeStage(key, info.pStages[i]);
+            }
+        }
+        writeMultisample(key, info.pMultisampleState);
+        const VkPipelineDepthStencilStateCreateInfo* depthStencil = info.pDepthStencilState;
+        key.add(depthStencil != nullptr);
+        if(depthStencil != nullptr){
+            key.add(depthStencil->depthTestEnable);
+            key.add(depthStencil->depthWriteEnable);
+            key.add(depthStencil->depthCompareOp);
+            key.add(depthStencil->depthBoundsTestEnable);
+            key.add(depthStencil->stencilTestEnable);
+            writeStencilOp(key, depthStencil->front);
+            writeStencilOp(key, depthStencil->back);
+            key.add(depthStencil->minDepthBounds);
+            key.add(depthStencil->maxDepthBounds);
+        }
+    }
+    else{
+        writeMultisample(key, info.pMultisampleState);
+        const VkPipelineColorBlendStateCreateInfo& colorBlend = *info.pColorBlendState;
+        key.add(colorBlend.logicOpEnable);
+        key.add(colorBlend.logicOp);
+        key.add(colorBlend.attachmentCount);
+        for(uint32_t i = 0; i < colorBlend.attachmentCount; i++){
+            const VkPipelineColorBlendAttachmentState& attachment = colorBlend.pAttachments[i];
+            key.add(attachment.blendEnable);
+            key.add(attachment.srcColorBlendFactor);
+            key.add(attachment.dstColorBlendFactor);
+            key.add(attachment.colorBlendOp);
+            key.add(attachment.srcAlphaBlendFactor);
+            key.add(attachment.dstAlphaBlendFactor);
+            key.add(attachment.alphaBlendOp);
+            key.add(attachment.colorWriteMask);
+        }
+        for(float constant : colorBlend.blendConstants){
+            key.add(constant);
+        }
+    }
+    return key.bytes;
+}
+
+const VkGraphicsPipelineLibraryFlagsEXT libraryParts[] = {
+    VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT,
+    VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT,
+    VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT,
+    VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT
+};
+
+}
+
+PipelineLibraryCache::PipelineLibraryCache(Context& context, VkPipelineCache pipelineCache) : context(context), pipelineCache(pipelineCache) {
+    if(!context.supportsPipelineLibraries()){
+        throw std::runtime_error("Graphics pipeline libraries are not enabled on this context!");
+    }
+}
+
+PipelineLibraryCache::~PipelineLibraryCache(){
+    std::lock_guard<std::mutex> lock(mutex);
+    for(auto& [key, library] : libraries){
+        vkDestroyPipeline(context.logicalDevice, library, nullptr);
+    }
+    for(auto& [key, layout] : layouts){
+        vkDestroyPipelineLayout(context.logicalDevice, layout, nullptr);
+    }
+    libraries.clear();
+    layouts.clear();
+}
+
+VkPipelineLayout PipelineLibraryCache::getLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges){
+    KeyWriter key;
+    key.add(setLayouts.size());
+    for(VkDescriptorSetLayout layout : setLayouts){
+        key.add(layout);
+    }
+    for(const VkPushConstantRange& range : pushConstantRanges){
+        key.add(range.stageFlags);
+        key.add(range.offset);
+        key.add(range.size);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = layouts.find(key.bytes);
+    if(found != layouts.end()){
+        return found->second;
+    }
+
+    VkPipelineLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layoutInfo.setLayoutCount = scast_ui32(setLayouts.size());
+    layoutInfo.pSetLayouts = setLayouts.data();
+    layoutInfo.pushConstantRangeCount = scast_ui32(pushConstantRanges.size());
+    layoutInfo.pPushConstantRanges = pushConstantRanges.data();
+    VkPipelineLayout layout;
+    if(vkCreatePipelineLayout(context.logicalDevice, &layoutInfo, nullptr, &layout) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create pipeline layout!");
+    }
+    layouts.emplace(std::move(key.bytes), layout);
+    return layout;
+}
+
+VkPipeline PipelineLibraryCache::link(const VkGraphicsPipelineCreateInfo& info, bool optimized){
+    VkPipeline parts[4];
+    for(int i = 0; i < 4; i++){
+        parts[i] = getLibrary(info, libraryParts[i]);
+    }
+
+    VkPipelineLibraryCreateInfoKHR libraryInfo{};
+    libraryInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR;
+    libraryInfo.libraryCount = 4;
+    libraryInfo.pLibraries = parts;
+
+    VkGraphicsPipelineCreateInfo linkInfo{};
+    linkInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    linkInfo.pNext = &libraryInfo;
+    linkInfo.flags = info.flags | (optimized ? VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT : 0);
+    linkInfo.layout = info.layout;
+    linkInfo.basePipelineHandle = VK_NULL_HANDLE;
+    linkInfo.basePipelineIndex = -1;
+
+    VkPipeline pipeline;
+    if(vkCreateGraphicsPipelines(context.logicalDevice, pipelineCache, 1, &linkInfo, nullptr, &pipeline) != VK_SUCCESS){
+        throw std::runtime_error("Failed to link graphics pipeline libraries!");
+    }
+    return pipeline;
+}
+
+size_t PipelineLibraryCache::libraryCount() const{
+    std::lock_guard<std::mutex> lock(mutex);
+    return libraries.size();
+}
+
+VkPipeline PipelineLibraryCache::getLibrary(const VkGraphicsPipelineCreateInfo& info, VkGraphicsPipelineLibraryFlagsEXT part){
+    std::string key = partKey(info, part);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = libraries.find(key);
+        if(found != libraries.end()){
+            return found->second;
+        }
+    }
+
+    // compiled outside the lock, a thread that built the same part meanwhile wins and ours goes
+    VkPipeline library = createLibrary(info, part);
+    std::lock_guard<std::mutex> lock(mutex);
+    auto [it, inserted] = libraries.emplace(std::move(key), library);
+    if(!inserted){
+        vkDestroyPipeline(context.logicalDevice, library, nullptr);
+    }
+    return it->second;
+}
+
+VkPipeline PipelineLibraryCache::createLibrary(const VkGraphicsPipelineCreateInfo& info, VkGraphicsPipelineLibraryFlagsEXT part){
+    VkGraphicsPipelineLibraryCreateInfoEXT libraryInfo{};
+    libraryInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT;
+    libraryInfo.flags = part;
+
+    // retained so optimized links can still see through the library boundaries
+    VkGraphicsPipelineCreateInfo partInfo{};
+    partInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    partInfo.pNext = &libraryInfo;
+    partInfo.flags = info.flags | VK_PIPELINE_CREATE_LIBRARY_BIT_KHR | VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT;
+    partInfo.pDynamicState = info.pDynamicState;
+    partInfo.basePipelineHandle = VK_NULL_HANDLE;
+    partInfo.basePipelineIndex = -1;
+
+    std::vector<VkPipelineShaderStageCreateInfo> stages;
+    if(part == VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT){
+        partInfo.pVertexInputState = info.pVertexInputState;
+        partInfo.pInputAssemblyState = info.pInputAssemblyState;
+    }
+    else if(part == VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT){
+        for(uint32_t i = 0; i < info.stageCount; i++){
+            if(info.pStages[i].stage != VK_SHADER_STAGE_FRAGMENT_BIT){
+                stages.push_back(info.pStages[i]);
+            }
+        }
+        partInfo.pViewportState = info.pViewportState;
+        partInfo.pRasterizationState = info.pRasterizationState;
+        partInfo.pTessellationState = info.pTessellationState;
+        partInfo.layout = info.layout;
+        partInfo.renderPass = info.renderPass;
+        partInfo.subpass = info.subpass;
+    }
+    else if(part == VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT){
+        for(uint32_t i = 0; i < info.stageCount; i++){
+            if(info.pStages[i].stage == VK_SHADER_STAGE_FRAGMENT_BIT){
+                stages.push_back(info.pStages[i]);
+            }
+        }
+        partInfo.pMultisampleState = info.pMultisampleState;
+        partInfo.pDepthStencilState = info.pDepthStencilState;
+        partInfo.layout = info.layout;
+        partInfo.renderPass = info.renderPass;
+        partInfo.subpass = info.subpass;
+    }
+    else{
+        partInfo.pMultisampleState = info.pMultisampleState;
+        partInfo.pColorBlendState = info.pColorBlendState;
+        partInfo.renderPass = info.renderPass;
+        partInfo.subpass = info.subpass;
+    }
+    partInfo.stageCount = scast_ui32(stages.size());
+    partInfo.pStages = stages.data();
+
+    VkPipeline library;
+    if(vkCreateGraphicsPipelines(context.logicalDevice, pipelineCache, 1, &partInfo, nullptr, &library) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create graphics pipeline library!");
+    }
+    VILLAINY_VERBOSE_LOG(context.logger, "Made graphics pipeline library.");
+    return library;
+}
+
+}
@@ -0,0 +1,53 @@
+#ifndef VILLAINY_PIPELINE_LIBRARY
+#define VILLAINY_PIPELINE_LIBRARY
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace vlny{
+
+class Context;
+
+// VK_EXT_graphics_pipeline_library: a pipeline is split into its vertex input, pre-rasterization, fragment shader and
+// fragment output parts, each compiled once as a library and shared by every pipeline that has the same state for it
+// linking the four is then cheap, an optimized link costs more but gives a pipeline as fast as a monolithic one
+// pass it to GraphicsPipeline (PipelineCache owns one) on a context with supportsPipelineLibraries()
+//
+// thread safe, parts are looked up and created under a lock
+class PipelineLibraryCache{
+public:
+    PipelineLibraryCache(Context& context, VkPipelineCache pipelineCache = VK_NULL_HANDLE);
+    ~PipelineLibraryCache();
+
+    PipelineLibraryCache(const PipelineLibraryCache&) = delete;
+    PipelineLibraryCache& operator=(const PipelineLibraryCache&) = delete;
+
+    // libraries only link with identically defined layouts, so every pipeline linked from the cache takes its layout
+    // from here, owned by the cache
+    VkPipelineLayout getLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges);
+    // `info` describes a whole pipeline as for vkCreateGraphicsPipelines, with its layout from getLayout()
+    // the parts not seen before are compiled, the returned pipeline belongs to the caller
+    VkPipeline link(const VkGraphicsPipelineCreateInfo& info, bool optimized);
+
+    size_t libraryCount() const;
+private:
+    Context& context;
+    VkPipelineCache pipelineCache;
+
+    // keys are the bytes of the state a part depends on, compared whole so two parts never get mixed up
+    std::unordered_map<std::string, VkPipeline> libraries;
+    std::unordered_map<std::string, VkPipelineLayout> layouts;
+    mutable std::mutex mutex;
+
+    VkPipeline getLibrary(const VkGraphicsPipelineCreateInfo& info, VkGraphicsPipelineLibraryFlagsEXT part);
+    VkPipeline createLibrary(const VkGraphicsPipelineCreateInfo& info, VkGraphicsPipelineLibraryFlagsEXT part);
+};
+
+}
+
+#endif
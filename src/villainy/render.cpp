@@ -5,14 +5,24 @@
 #include "swapchain.hpp"
 #include "context.hpp"
 #include "buffer.hpp"
+#include "pipelineCache.hpp"
+#include "pipelineLibrary.hpp"
+
+#include <algorithm>
 
 namespace vlny{
 
-GraphicsPipeline::GraphicsPipeline(GraphicsPipelineConfig config, Context& context, Swapchain& swapchain, ShaderProgram& shaderProgram) : config(config), context(context), swapchain(swapchain), shaderProgram(shaderProgram) {
+GraphicsPipeline::GraphicsPipeline(GraphicsPipelineConfig config, Context& context, Swapchain& swapchain, ShaderProgram& shaderProgram, VkPipelineCache pipelineCache, PipelineLibraryCache* libraries, bool optimizeLink) :
+    GraphicsPipeline(config, context, swapchain.renderPass.value().vkRenderPass, swapchain.swapchainExtent, shaderProgram, pipelineCache, libraries, optimizeLink) {}
+
+GraphicsPipeline::GraphicsPipeline(GraphicsPipelineConfig config, Context& context, VkRenderPass renderPass, VkExtent2D extent, ShaderProgram& shaderProgram, VkPipelineCache pipelineCache, PipelineLibraryCache* libraries, bool optimizeLink) :
+    config(config), context(context), renderPass(renderPass), extent(extent), shaderProgram(shaderProgram), pipelineCache(pipelineCache),
+    libraries(context.supportsPipelineLibraries() ? libraries : nullptr), optimizeLink(optimizeLink) {
     init();
 }
 
-GraphicsPipeline::GraphicsPipeline(Swapchain& swapchain, Context& context, ShaderProgram& shaderProgram) : context(context), swapchain(swapchain), shaderProgram(shaderProgram) {
+GraphicsPipeline::GraphicsPipeline(Swapchain& swapchain, Context& context, ShaderProgram& shaderProgram) :
+    context(context), renderPass(swapchain.renderPass.value().vkRenderPass), extent(swapchain.swapchainExtent), shaderProgram(shaderProgram) {
     init();
 }
 
@@ -21,23 +31,35 @@ GraphicsPipeline::~GraphicsPipeline(){
         vkDestroyPipeline(context.logicalDevice, graphicsPipeline, nullptr);
         graphicsPipeline = VK_NULL_HANDLE;
     }
-    if(pipelineLayout != VK_NULL_HANDLE){
+    if(pipelineLayout != VK_NULL_HANDLE && libraries == nullptr){
         vkDestroyPipelineLayout(context.logicalDevice, pipelineLayout, nullptr);
         pipelineLayout = VK_NULL_HANDLE;
     }
 }
 
 void GraphicsPipeline::init(){
+    dynamicStates.clear();
+    for(VkDynamicState state : config.dynamicStates){
+        if(context.supportsDynamicState(state)){
+            dynamicStates.push_back(state);
+        }
+        else{
+            VILLAINY_VERBOSE_LOG(context.logger, "Dynamic state " + std::to_string(static_cast<int>(state)) + " unsupported, baking it into the pipeline.");
+        }
+    }
     VkPipelineDynamicStateCreateInfo dynamicState{};
     dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-    dynamicState.dynamicStateCount = scast_ui32(config.dynamicStates.size());
-    dynamicState.pDynamicStates = config.dynamicStates.data();
+    dynamicState.dynamicStateCount = scast_ui32(dynamicStates.size());
+    dynamicState.pDynamicStates = dynamicStates.data();
 
     VkVertexInputBindingDescription vertexBindingDesc{};
     vertexBindingDesc.binding = config.vertexData.binding;
     vertexBindingDesc.inputRate = config.vertexData.inputRate;
     vertexBindingDesc.stride = config.vertexData.stride;
 
+    const ShaderReflection& reflection = shaderProgram.getReflection();
+    bool reflected = shaderProgram.isReflected();
+
     uint32_t numVertexAttribs = scast_ui32(config.vertexData.vertexAttributes.size());
     std::vector<VkVertexInputAttributeDescription> vertexAttribs(numVertexAttribs);
     for(int i = 0; i < numVertexAttribs; i++){
@@ -46,6 +68,24 @@ void GraphicsPipeline::init(){
         vertexAttribs[i].format = config.vertexData.vertexAttributes[i].first;
         vertexAttribs[i].offset = config.vertexData.vertexAttributes[i].second;
     }
+    if(config.reflectVertexInput){
+        if(!reflected){
+            throw std::runtime_error("Vertex input reflection needs a reflected shader program!");
+        }
+        vertexAttribs.clear();
+        uint32_t offset = 0;
+        for(const ReflectedVertexInput& input : reflection.vertexInputs){
+            VkVertexInputAttributeDescription attrib{};
+            attrib.binding = config.vertexData.binding;
+            attrib.location = input.location;
+            attrib.format = input.format;
+            attrib.offset = offset;
+            vertexAttribs.push_back(attrib);
+            offset += input.size;
+        }
+        numVertexAttribs = scast_ui32(vertexAttribs.size());
+        vertexBindingDesc.stride = offset;
+    }
 
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
     vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -62,14 +102,14 @@ void GraphicsPipeline::init(){
     VkViewport viewport{};
     viewport.x = 0.0f;
     viewport.y = 0.0f;
-    viewport.height = swapchain.window.config.height;
-    viewport.width = swapchain.window.config.width;
+    viewport.height = static_cast<float>(extent.height);
+    viewport.width = static_cast<float>(extent.width);
     viewport.minDepth = 0.0f;
     viewport.maxDepth = 1.0f;
 
     VkRect2D scissor{};
     scissor.offset = {0, 0};
-    scissor.extent = swapchain.swapchainExtent;
+    scissor.extent = extent;
 
     VkPipelineViewportStateCreateInfo viewportState{};
     viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
@@ -101,6 +141,16 @@ void GraphicsPipeline::init(){
     multisamplingInfo.alphaToCoverageEnable = VK_FALSE;
     multisamplingInfo.alphaToOneEnable = VK_FALSE;
 
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = config.depthTest;
+    depthStencil.depthWriteEnable = config.depthWrite;
+    depthStencil.depthCompareOp = config.depthCompareOp;
+    depthStencil.depthBoundsTestEnable = VK_FALSE;
+    depthStencil.stencilTestEnable = VK_FALSE;
+    depthStencil.minDepthBounds = 0.0f;
+    depthStencil.maxDepthBounds = 1.0f;
+
     // TODO: add to configs
     VkPipelineColorBlendAttachmentState colorBlendAttachment{};
     colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
@@ -125,12 +175,31 @@ void GraphicsPipeline::init(){
 
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 1;
-    pipelineLayoutInfo.pSetLayouts = &shaderProgram.descriptorSetLayout;
-    pipelineLayoutInfo.pushConstantRangeCount = 0;
-    pipelineLayoutInfo.pPushConstantRanges = nullptr;
+    usesDescriptorBuffer = config.descriptorBuffer && context.supportsDescriptorBuffers();
+    std::vector<VkDescriptorSetLayout> setLayouts = {shaderProgram.descriptorSetLayout};
+    if(usesDescriptorBuffer){
+        setLayouts[0] = context.getDescriptorSetLayout(shaderProgram.layoutBindings, VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT);
+    }
+    setLayouts.insert(setLayouts.end(), config.extraSetLayouts.begin(), config.extraSetLayouts.end());
+    if(config.extraSetLayouts.empty() && reflected){
+        VkDescriptorSetLayoutCreateFlags flags = usesDescriptorBuffer ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT : 0;
+        for(uint32_t set = 1; set < reflection.setCount(); set++){
+            setLayouts.push_back(context.getDescriptorSetLayout(reflection.setBindings(set), flags));
+        }
+    }
+    std::vector<VkPushConstantRange> pushConstantRanges = config.pushConstantRanges;
+    if(pushConstantRanges.empty() && reflected && reflection.pushConstants.size != 0){
+        pushConstantRanges.push_back(reflection.pushConstants);
+    }
+    pipelineLayoutInfo.setLayoutCount = scast_ui32(setLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+    pipelineLayoutInfo.pushConstantRangeCount = scast_ui32(pushConstantRanges.size());
+    pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
 
-    if(vkCreatePipelineLayout(context.logicalDevice, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS){
+    if(libraries != nullptr){
+        pipelineLayout = libraries->getLayout(setLayouts, pushConstantRanges);
+    }
+    else if(vkCreatePipelineLayout(context.logicalDevice, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS){
         throw std::runtime_error("Failed to create pipeline layout!");
     }
 
@@ -138,6 +207,7 @@ void GraphicsPipeline::init(){
 
     VkGraphicsPipelineCreateInfo pipelineInfo{};
     pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.flags = usesDescriptorBuffer ? VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT : 0;
     pipelineInfo.stageCount = shaderProgram.numShaders;
     pipelineInfo.pStages = shaderProgram.vkShaderStages.data();
     pipelineInfo.pVertexInputState = &vertexInputInfo;
@@ -145,23 +215,141 @@ void GraphicsPipeline::init(){
     pipelineInfo.pViewportState = &viewportState;
     pipelineInfo.pRasterizationState = &rasterizer;
     pipelineInfo.pMultisampleState = &multisamplingInfo;
-    pipelineInfo.pDepthStencilState = nullptr; // TODO: look into
+    pipelineInfo.pDepthStencilState = &depthStencil;
     pipelineInfo.pColorBlendState = &colorBlending;
     pipelineInfo.pDynamicState = &dynamicState;
     pipelineInfo.layout = pipelineLayout;
 
-    pipelineInfo.renderPass = swapchain.renderPass.value().vkRenderPass;
+    pipelineInfo.renderPass = renderPass;
     pipelineInfo.subpass = 0;
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
     pipelineInfo.basePipelineIndex = -1;
 
-    if(vkCreateGraphicsPipelines(context.logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS){
+    if(libraries != nullptr){
+        graphicsPipeline = libraries->link(pipelineInfo, optimizeLink);
+    }
+    else if(vkCreateGraphicsPipelines(context.logicalDevice, pipelineCache, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS){
         throw std::runtime_error("Failed to create graphics pipeline!");
     }
 
     VILLAINY_VERBOSE_LOG(context.logger, "Made graphics pipeline.");
 }
 
+bool GraphicsPipeline::hasDynamicState(VkDynamicState state) const{
+    return std::find(dynamicStates.begin(), dynamicStates.end(), state) != dynamicStates.end();
+}
+
+void GraphicsPipeline::applyDynamicState(VkCommandBuffer commandBuffer, const DynamicRasterState& state) const{
+    for(VkDynamicState dynamic : dynamicStates){
+        switch(dynamic){
+        case VK_DYNAMIC_STATE_LINE_WIDTH:
+            vkCmdSetLineWidth(commandBuffer, state.lineWidth.value_or(config.lineWidth));
+            break;
+        case VK_DYNAMIC_STATE_CULL_MODE_EXT:
+            context.pfnCmdSetCullMode(commandBuffer, state.cullMode.value_or(config.cullMode));
+            break;
+        case VK_DYNAMIC_STATE_FRONT_FACE_EXT:
+            context.pfnCmdSetFrontFace(commandBuffer, state.frontFace.value_or(config.frontFace));
+            break;
+        case VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_EXT:
+            context.pfnCmdSetPrimitiveTopology(commandBuffer, state.topology.value_or(config.vertexData.topology));
+            break;
+        case VK_DYNAMIC_STATE_PRIMITIVE_RESTART_ENABLE_EXT:
+            context.pfnCmdSetPrimitiveRestartEnable(commandBuffer, state.primitiveRestart.value_or(config.vertexData.primitiveRestart));
+            break;
+        case VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT:
+            context.pfnCmdSetDepthTestEnable(commandBuffer, state.depthTest.value_or(config.depthTest));
+            break;
+        case VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT:
+            context.pfnCmdSetDepthWriteEnable(commandBuffer, state.depthWrite.value_or(config.depthWrite));
+            break;
+        case VK_DYNAMIC_STATE_DEPTH_COMPARE_OP_EXT:
+            context.pfnCmdSetDepthCompareOp(commandBuffer, state.depthCompareOp.value_or(config.depthCompareOp));
+            break;
+        case VK_DYNAMIC_STATE_POLYGON_MODE_EXT:
+            context.pfnCmdSetPolygonMode(commandBuffer, state.polygonMode.value_or(config.polygonMode));
+            break;
+        case VK_DYNAMIC_STATE_DEPTH_CLAMP_ENABLE_EXT:
+            context.pfnCmdSetDepthClampEnable(commandBuffer, state.depthClamp.value_or(config.depthClamp));
+            break;
+        default: // viewport and scissor come from the renderer, the rest has no per-draw value yet
+            break;
+        }
+    }
+}
+
+void RenderObjectBase::setCullMode(VkCullModeFlags cullMode){
+    rasterState.cullMode = cullMode;
+}
+
+void RenderObjectBase::setFrontFace(VkFrontFace frontFace){
+    rasterState.frontFace = frontFace;
+}
+
+void RenderObjectBase::setPrimitiveTopology(VkPrimitiveTopology topology){
+    rasterState.topology = topology;
+}
+
+void RenderObjectBase::setPrimitiveRestart(bool enable){
+    rasterState.primitiveRestart = enable;
+}
+
+void RenderObjectBase::setLineWidth(float width){
+    rasterState.lineWidth = width;
+}
+
+void RenderObjectBase::setDepthState(bool test, bool write, VkCompareOp compareOp){
+    rasterState.depthTest = test;
+    rasterState.depthWrite = write;
+    rasterState.depthCompareOp = compareOp;
+}
+
+void RenderObjectBase::setPolygonMode(VkPolygonMode polygonMode){
+    rasterState.polygonMode = polygonMode;
+}
+
+void RenderObjectBase::setDepthClamp(bool enable){
+    rasterState.depthClamp = enable;
+}
+
+void RenderObjectBase::setPipelineVariant(PipelineCache& cache, const GraphicsPipelineConfig& config, ShaderProgram& program){
+    variantCache = &cache;
+    variantConfig = config;
+    variantProgram = &program;
+    cache.prepare(config, program);
+}
+
+GraphicsPipeline* RenderObjectBase::selectPipeline(GraphicsPipeline& framePipeline){
+    if(variantCache == nullptr){
+        return &framePipeline;
+    }
+    return variantCache->get(variantConfig, *variantProgram);
+}
+
+DynamicRasterState RenderObjectBase::drawRasterState(const GraphicsPipeline& pipeline) const{
+    DynamicRasterState state = rasterState;
+    if(variantCache == nullptr){
+        return state;
+    }
+    const GraphicsPipelineConfig& config = variantConfig;
+    auto fill = [&pipeline](auto& value, VkDynamicState dynamic, auto configValue){
+        if(!value && pipeline.hasDynamicState(dynamic)){
+            value = configValue;
+        }
+    };
+    fill(state.cullMode, VK_DYNAMIC_STATE_CULL_MODE_EXT, config.cullMode);
+    fill(state.frontFace, VK_DYNAMIC_STATE_FRONT_FACE_EXT, config.frontFace);
+    fill(state.topology, VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_EXT, config.vertexData.topology);
+    fill(state.primitiveRestart, VK_DYNAMIC_STATE_PRIMITIVE_RESTART_ENABLE_EXT, config.vertexData.primitiveRestart);
+    fill(state.lineWidth, VK_DYNAMIC_STATE_LINE_WIDTH, config.lineWidth);
+    fill(state.depthTest, VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT, config.depthTest);
+    fill(state.depthWrite, VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT, config.depthWrite);
+    fill(state.depthCompareOp, VK_DYNAMIC_STATE_DEPTH_COMPARE_OP_EXT, config.depthCompareOp);
+    fill(state.polygonMode, VK_DYNAMIC_STATE_POLYGON_MODE_EXT, config.polygonMode);
+    fill(state.depthClamp, VK_DYNAMIC_STATE_DEPTH_CLAMP_ENABLE_EXT, config.depthClamp);
+    return state;
+}
+
 Renderer::Renderer(Context& context, Window& window, Swapchain& swapchain) : context(context), window(window),   swapchain(swapchain), commandPool(context) {
     cmdBufs = commandPool.createCommandBuffers(context, window.getConfig().maxFramesInFlight);
 }
@@ -181,6 +369,9 @@ void Renderer::drawFrame(GraphicsPipeline& pipeline){
     }
 
     vkResetFences(context.logicalDevice, 1, &swapchain.inFlightFences[currentFrame]);
+    for(FrameResource* resource : frameResources){
+        resource->prepareFrame(currentFrame);
+    }
     vkResetCommandBuffer(cmdBufs[currentFrame].vkCommandBuffer, 0);
     recordCommandBuffer(cmdBufs[currentFrame], imageIndex, pipeline);
 
@@ -247,6 +438,34 @@ void Renderer::removeRenderObject(int index){
     renderObjects.erase(renderObjects.begin() + index);
 }
 
+void Renderer::addFrameResource(FrameResource& resource){
+    frameResources.push_back(&resource);
+}
+
+void Renderer::removeFrameResource(FrameResource& resource){
+    frameResources.erase(std::remove(frameResources.begin(), frameResources.end(), &resource), frameResources.end());
+}
+
+void Renderer::setBindlessTable(BindlessTable* table, uint32_t set){
+    bindlessTable = table;
+    bindlessSet = set;
+}
+
+void Renderer::bindPipeline(VkCommandBuffer commandBuffer, GraphicsPipeline& pipeline){
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.graphicsPipeline);
+    if(pipeline.usesDescriptorBuffer){
+        if(bindlessTable != nullptr){
+            throw std::runtime_error("Bindless tables can't be bound to a descriptor buffer pipeline!");
+        }
+        // bound once, every DescriptorManager::bind after this only sets an offset into it
+        context.getDescriptorBufferHeap().bind(commandBuffer);
+    }
+    if(bindlessTable != nullptr){
+        VkDescriptorSet set = bindlessTable->getDescriptorSet(currentFrame);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipelineLayout, bindlessSet, 1, &set, 0, nullptr);
+    }
+}
+
 void Renderer::recordCommandBuffer(CommandBuffer cmdBuf, uint32_t imageIndex, GraphicsPipeline& pipeline){
     VkCommandBuffer commandBuffer = cmdBuf.vkCommandBuffer;
 
@@ -264,6 +483,11 @@ void Renderer::recordCommandBuffer(CommandBuffer cmdBuf, uint32_t imageIndex, Gr
         throw std::runtime_error("Failed to begin recording command buffer!");
     }
 
+    // transfers have to happen outside the render pass
+    for(FrameResource* resource : frameResources){
+        resource->recordFrameCommands(commandBuffer, currentFrame);
+    }
+
     VkRenderPassBeginInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
     renderPassInfo.renderPass = swapchain.renderPass->vkRenderPass;
@@ -284,7 +508,7 @@ void Renderer::recordCommandBuffer(CommandBuffer cmdBuf, uint32_t imageIndex, Gr
         command buffers will be executed.
     VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS: The render pass commands will be executed from secondary command buffers.*/
 
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.graphicsPipeline);
+    bindPipeline(commandBuffer, pipeline);
 
     VkViewport viewport{};
     viewport.x = 0.0f;
@@ -300,9 +524,19 @@ void Renderer::recordCommandBuffer(CommandBuffer cmdBuf, uint32_t imageIndex, Gr
     scissor.extent = swapchain.swapchainExtent;
     vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
+    // objects with their own variant switch pipelines, the dynamic viewport and scissor carry over
+    GraphicsPipeline* bound = &pipeline;
     for(const auto& ro : renderObjects){
         const auto& renderObject = ro.get();
-        renderObject->draw(commandBuffer, pipeline, currentFrame);
+        GraphicsPipeline* selected = renderObject->selectPipeline(pipeline);
+        if(selected == nullptr){
+            continue;
+        }
+        if(selected != bound){
+            bindPipeline(commandBuffer, *selected);
+            bound = selected;
+        }
+        renderObject->draw(commandBuffer, *selected, currentFrame);
     }
 
     vkCmdEndRenderPass(commandBuffer);
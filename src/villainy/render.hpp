@@ -10,6 +10,7 @@
 #include <string>
 #include <utility>
 #include <memory>
+#include <optional>
 
 #include "shader.hpp"
 #include "command.hpp"
@@ -17,11 +18,16 @@
 #include "renderpass.hpp"
 #include "swapchain.hpp"
 #include "window.hpp"
+#include "bindlessTable.hpp"
+#include "uniformAllocator.hpp"
+#include "descriptorManager.hpp"
 
 namespace vlny{
 
 //class Window;
 class Context;
+class PipelineCache;
+class PipelineLibraryCache;
 //class Swapchain;
 
 struct ColorVertex{
@@ -42,6 +48,9 @@ struct VertexData{
 };
 
 struct GraphicsPipelineConfig{
+    // besides the core states, the extended ones (VK_DYNAMIC_STATE_CULL_MODE_EXT, ..._POLYGON_MODE_EXT, ...) can be listed
+    // with ContextConfig::extendedDynamicState, the values below are then only the defaults a RenderObject's setters
+    // override per draw. states the device can't make dynamic are dropped and baked from the config instead
     std::vector<VkDynamicState> dynamicStates = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
     VertexData vertexData;
     // rasterizer
@@ -50,31 +59,103 @@ struct GraphicsPipelineConfig{
     float lineWidth = 1.0f;
     VkCullModeFlagBits cullMode = VK_CULL_MODE_BACK_BIT;
     VkFrontFace frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    // depth, only has an effect with a depth attachment in the render pass
+    bool depthTest = false;
+    bool depthWrite = false;
+    VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS;
+    // layout: set 0 is the shader program's own layout, these follow as set 1, 2, ... (e.g. BindlessTable::getLayout())
+    // at most one may be a push descriptor layout (a DescriptorManager with isPushed())
+    // left empty, both come from the shader program's reflection when it has one
+    std::vector<VkDescriptorSetLayout> extraSetLayouts;
+    std::vector<VkPushConstantRange> pushConstantRanges;
+    // replace vertexData's attributes with the vertex shader's inputs, in location order and tightly packed
+    bool reflectVertexInput = false;
+    // every set comes from the context's descriptor buffer (ignored when Context::supportsDescriptorBuffers() is false):
+    // set 0 gets a descriptor buffer copy of the shader program's layout and is bound through a DescriptorManager at set 0
+    // instead of the RenderObject's UniformBuffer, the extra layouts have to come from descriptor buffer DescriptorManagers,
+    // BindlessTable and UniformAllocator sets can't be used with it
+    bool descriptorBuffer = false;
+};
+
+// per-draw values for a pipeline's dynamic states, unset ones fall back to the pipeline's config
+struct DynamicRasterState{
+    std::optional<VkCullModeFlags> cullMode;
+    std::optional<VkFrontFace> frontFace;
+    std::optional<VkPrimitiveTopology> topology; // same topology class as the pipeline's
+    std::optional<bool> primitiveRestart;
+    std::optional<float> lineWidth;
+    std::optional<bool> depthTest;
+    std::optional<bool> depthWrite;
+    std::optional<VkCompareOp> depthCompareOp;
+    std::optional<VkPolygonMode> polygonMode;
+    std::optional<bool> depthClamp;
 };
 
 class GraphicsPipeline{
 public:
-    GraphicsPipeline(GraphicsPipelineConfig config, Context& context, Swapchain& swapchain, ShaderProgram& shaderProgram);
+    // with `libraries` (and Context::supportsPipelineLibraries()) the pipeline is linked from shared libraries instead of
+    // compiled whole, `optimizeLink` trades a slower link for a faster pipeline
+    GraphicsPipeline(GraphicsPipelineConfig config, Context& context, Swapchain& swapchain, ShaderProgram& shaderProgram,
+        VkPipelineCache pipelineCache = VK_NULL_HANDLE, PipelineLibraryCache* libraries = nullptr, bool optimizeLink = false);
+    // for building on a worker thread: the swapchain belongs to the main thread, so its render pass and extent are
+    // read there when the build is started and passed in by value
+    GraphicsPipeline(GraphicsPipelineConfig config, Context& context, VkRenderPass renderPass, VkExtent2D extent,
+        ShaderProgram& shaderProgram, VkPipelineCache pipelineCache = VK_NULL_HANDLE, PipelineLibraryCache* libraries = nullptr,
+        bool optimizeLink = false);
     GraphicsPipeline(Swapchain& swapchain, Context& context, ShaderProgram& shaderProgram);
     ~GraphicsPipeline();
+
+    bool hasDynamicState(VkDynamicState state) const;
+    // sets every dynamic state the pipeline has besides viewport and scissor, from `state` or the config
+    void applyDynamicState(VkCommandBuffer commandBuffer, const DynamicRasterState& state) const;
 private:
     GraphicsPipelineConfig config;
     Context& context;
-    Swapchain& swapchain;
+    VkRenderPass renderPass;
+    VkExtent2D extent;
     ShaderProgram& shaderProgram;
+    VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+    PipelineLibraryCache* libraries = nullptr; // owns the layout when set
+    bool optimizeLink = false;
 
     VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
     VkPipeline graphicsPipeline = VK_NULL_HANDLE;
+    bool usesDescriptorBuffer = false;
+    std::vector<VkDynamicState> dynamicStates; // the config's, less the ones the device doesn't support
 
     void init();
     
     friend class Renderer;
+    friend class GeometryBatch;
     template <typename V> friend struct RenderObject;
 };
 
 struct RenderObjectBase {
     virtual ~RenderObjectBase() = default;
     virtual void draw(VkCommandBuffer commandBuffer, GraphicsPipeline& pipeline, int currentFrame) = 0;
+
+    // draw with this variant instead of the frame's pipeline, while it compiles a compatible variant from the same cache
+    // stands in, and the object is skipped until one of them is ready
+    void setPipelineVariant(PipelineCache& cache, const GraphicsPipelineConfig& config, ShaderProgram& program);
+    // the pipeline to draw with this frame, nullptr to skip the draw
+    GraphicsPipeline* selectPipeline(GraphicsPipeline& framePipeline);
+    // rasterState, with the variant config's values for the states the pipeline has dynamic: the cache shares one
+    // pipeline between configs that only differ in those, so they are set per draw
+    DynamicRasterState drawRasterState(const GraphicsPipeline& pipeline) const;
+    PipelineCache* variantCache = nullptr;
+    GraphicsPipelineConfig variantConfig;
+    ShaderProgram* variantProgram = nullptr;
+
+    // per-draw raster state, applied when the pipeline lists the matching dynamic state and ignored otherwise
+    void setCullMode(VkCullModeFlags cullMode);
+    void setFrontFace(VkFrontFace frontFace);
+    void setPrimitiveTopology(VkPrimitiveTopology topology);
+    void setPrimitiveRestart(bool enable);
+    void setLineWidth(float width);
+    void setDepthState(bool test, bool write, VkCompareOp compareOp = VK_COMPARE_OP_LESS);
+    void setPolygonMode(VkPolygonMode polygonMode);
+    void setDepthClamp(bool enable);
+    DynamicRasterState rasterState;
 };
 
 template<typename Vertex>
@@ -85,6 +166,29 @@ struct RenderObject : public RenderObjectBase {
     IndexBuffer& ib;
     UniformBuffer& ub;
 
+    // pushed before the draw, e.g. the object's BindlessTable indices, needs a matching pushConstantRanges entry
+    template <typename T>
+    void setPushConstants(const T& data, VkShaderStageFlags stages = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
+    std::vector<uint8_t> pushConstants;
+    VkShaderStageFlags pushConstantStages = 0;
+
+    // `source` is copied into the allocator's frame region on every draw and bound at `set` with its dynamic offset,
+    // it has to outlive the object, update it in place instead of keeping a UniformBuffer per object
+    template <typename T>
+    void setDynamicUniform(UniformAllocator& allocator, const T& source, uint32_t set = 1);
+    UniformAllocator* dynamicUniforms = nullptr;
+    const void* dynamicSource = nullptr;
+    VkDeviceSize dynamicSize = 0;
+    uint32_t dynamicSet = 1;
+
+    // per-draw material bindings, pushed into the command buffer, bound as a set or pointed at in the descriptor buffer,
+    // whichever the manager chose; one manager per set, setting a set again replaces its manager
+    void setDrawDescriptors(DescriptorManager& descriptors, uint32_t set = 1);
+    std::vector<std::pair<DescriptorManager*, uint32_t>> drawDescriptors; // manager, set
+
+    // drawn as firstInstance, so gl_InstanceIndex picks the object's record in an ObjectTable
+    uint32_t objectIndex = 0;
+
     void draw(VkCommandBuffer commandBuffer, GraphicsPipeline& pipeline, int currentFrame) override;
 };
 
@@ -93,14 +197,27 @@ public:
     Renderer(Context& context, Window& window, Swapchain& swapchain);
 
     void drawFrame(GraphicsPipeline& pipeline);
+    // frame-in-flight slot the next drawFrame call records into
+    uint32_t getCurrentFrame() const { return currentFrame; }
 
     int addRenderObject(std::unique_ptr<RenderObjectBase> ro);
     int addRenderObjects(std::vector<std::unique_ptr<RenderObjectBase>> ros);
     template <typename Vertex>
     int addRenderObject(RenderObject<Vertex>& ro);
     void removeRenderObject(int index);
+
+    // called in registration order every frame, the renderer doesn't own them
+    void addFrameResource(FrameResource& resource);
+    void removeFrameResource(FrameResource& resource);
+
+    // bound once per frame right after the pipeline, every draw indexes into it instead of binding its own sets
+    // `set` has to match where the table's layout sits in GraphicsPipelineConfig::extraSetLayouts (+1)
+    void setBindlessTable(BindlessTable* table, uint32_t set = 1);
 private:
     std::vector<std::unique_ptr<RenderObjectBase>> renderObjects;
+    std::vector<FrameResource*> frameResources;
+    BindlessTable* bindlessTable = nullptr;
+    uint32_t bindlessSet = 1;
 
     uint32_t currentFrame = 0;
 
@@ -112,6 +229,7 @@ private:
     std::vector<CommandBuffer> cmdBufs;
 
     void recordCommandBuffer(CommandBuffer cmdBuf, uint32_t imageIndex, GraphicsPipeline& pipeline);
+    void bindPipeline(VkCommandBuffer commandBuffer, GraphicsPipeline& pipeline);
 };
 
 }
@@ -6,22 +6,69 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include <cstring>
+#include <type_traits>
+
 namespace vlny{
 
 template <typename Vertex>
 RenderObject<Vertex>::RenderObject(VertexBuffer<Vertex>& vb, IndexBuffer& ib, UniformBuffer& ub) : vb(vb), ib(ib), ub(ub) {}
 
+template <typename Vertex>
+template <typename T>
+void RenderObject<Vertex>::setPushConstants(const T& data, VkShaderStageFlags stages){
+    static_assert(std::is_trivially_copyable_v<T>, "Push constants have to be trivially copyable!");
+    pushConstants.resize(sizeof(T));
+    std::memcpy(pushConstants.data(), &data, sizeof(T));
+    pushConstantStages = stages;
+}
+
+template <typename Vertex>
+template <typename T>
+void RenderObject<Vertex>::setDynamicUniform(UniformAllocator& allocator, const T& source, uint32_t set){
+    static_assert(std::is_trivially_copyable_v<T>, "Uniform data has to be trivially copyable!");
+    dynamicUniforms = &allocator;
+    dynamicSource = &source;
+    dynamicSize = sizeof(T);
+    dynamicSet = set;
+}
+
+template <typename Vertex>
+void RenderObject<Vertex>::setDrawDescriptors(DescriptorManager& descriptors, uint32_t set){
+    for(auto& entry : drawDescriptors){
+        if(entry.second == set){
+            entry.first = &descriptors;
+            return;
+        }
+    }
+    drawDescriptors.emplace_back(&descriptors, set);
+}
+
 template <typename Vertex>
 void RenderObject<Vertex>::draw(VkCommandBuffer commandBuffer, GraphicsPipeline& pipeline, int currentFrame){
     VkBuffer vertexBuffers[] = {vb.vertexBuffer};
     VkBuffer indexBuffer = ib.indexBuffer;
-    auto& indices = ib.indices;
 
-    VkDeviceSize offsets[] = {0};
+    VkDeviceSize offsets[] = {vb.syncFrame(static_cast<uint32_t>(currentFrame))};
     vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-    vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT16);
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipelineLayout, 0, 1, &ub.getDescriptorSet(currentFrame), 0, nullptr);
-    vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
+    vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, ib.indexType);
+    pipeline.applyDynamicState(commandBuffer, drawRasterState(pipeline));
+    // descriptor buffer pipelines can't take sets, their set 0 comes from a DescriptorManager like the others
+    if(!pipeline.usesDescriptorBuffer){
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipelineLayout, 0, 1, &ub.getDescriptorSet(currentFrame), 0, nullptr);
+    }
+    for(auto& [descriptors, set] : drawDescriptors){
+        descriptors->bind(commandBuffer, pipeline.pipelineLayout, set, static_cast<uint32_t>(currentFrame));
+    }
+    if(dynamicUniforms != nullptr){
+        uint32_t offset = dynamicUniforms->push(static_cast<uint32_t>(currentFrame), dynamicSource, dynamicSize);
+        VkDescriptorSet set = dynamicUniforms->getDescriptorSet();
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipelineLayout, dynamicSet, 1, &set, 1, &offset);
+    }
+    if(!pushConstants.empty()){
+        vkCmdPushConstants(commandBuffer, pipeline.pipelineLayout, pushConstantStages, 0, static_cast<uint32_t>(pushConstants.size()), pushConstants.data());
+    }
+    vkCmdDrawIndexed(commandBuffer, ib.indexCount, 1, 0, 0, objectIndex);
 }
 
 template <typename Vertex>
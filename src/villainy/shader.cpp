@@ -4,23 +4,11 @@
 
 namespace vlny{
 
-ShaderProgram::ShaderProgram(Context& context, std::vector<ShaderLoadInfo> shaderInfos, std::vector<ShaderLayoutDescriptor> descriptorSetLayoutData) : device(context.logicalDevice){
-    numShaders = shaderInfos.size();
-    vkShaderModules.resize(numShaders);
-    vkShaderStages.resize(numShaders);
-    shaderEntrypoints.resize(numShaders);
-    for(int i = 0; i < numShaders; i++){
-        vkShaderModules[i] = makeVkShaderModule(shaderInfos[i]);
-        shaderEntrypoints[i] = shaderInfos[i].entrypoint;
-
-        vkShaderStages[i] = {};
-        vkShaderStages[i].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        vkShaderStages[i].stage = shaderInfos[i].stage;
-        vkShaderStages[i].module = vkShaderModules[i];
-        vkShaderStages[i].pName = shaderEntrypoints[i].c_str();
-        vkShaderStages[i].pSpecializationInfo = shaderInfos[i].vkSpecializationInfo;
+ShaderProgram::ShaderProgram(Context& context, std::vector<ShaderLoadInfo> shaderInfos, std::vector<ShaderLayoutDescriptor> descriptorSetLayoutData){
+    loadShaders(context, shaderInfos);
+    if(!reflected){
+        VILLAINY_VERBOSE_LOG(context.logger, "Shader reflection incomplete, pipelines only use the given layout.");
     }
-    VILLAINY_VERBOSE_LOG(context.logger, "Created shader modules & stages.");
 
     // make descriptor set layout
     int numDescriptorLayouts = descriptorSetLayoutData.size();
@@ -33,43 +21,55 @@ ShaderProgram::ShaderProgram(Context& context, std::vector<ShaderLoadInfo> shade
         descriptorSetLayoutBindings[i].stageFlags = descriptorSetLayoutData[i].stage;
     }
 
-    VkDescriptorSetLayoutCreateInfo layoutCreateInfo{};
-    layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutCreateInfo.bindingCount = scast_ui32(numDescriptorLayouts);
-    layoutCreateInfo.pBindings = descriptorSetLayoutBindings.data();
+    // shared through the context's cache, a UniformBuffer/DescriptorManager with the same bindings gets the same handle
+    descriptorSetLayout = context.getDescriptorSetLayout(descriptorSetLayoutBindings);
+    layoutBindings = std::move(descriptorSetLayoutBindings);
+}
 
-    if(vkCreateDescriptorSetLayout(context.logicalDevice, &layoutCreateInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS){
-        throw std::runtime_error("Failed to create descriptor set layout!");
-    }
+ShaderProgram::ShaderProgram(Context& context, std::vector<ShaderLoadInfo> shaderInfos) : requireReflection(true){
+    loadShaders(context, shaderInfos);
 
-    VILLAINY_VERBOSE_LOG(context.logger, "Created descriptor set layout.");
+    // only what the stages actually use, equal sets across programs still share one layout through the cache
+    layoutBindings = reflection.setBindings(0);
+    descriptorSetLayout = context.getDescriptorSetLayout(layoutBindings);
 }
 
-ShaderProgram::~ShaderProgram(){
-    if(descriptorSetLayout != VK_NULL_HANDLE){
-        vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
-        descriptorSetLayout = VK_NULL_HANDLE;
-    }
-    for(auto shaderModule : vkShaderModules){
-        if(shaderModule != VK_NULL_HANDLE){
-            vkDestroyShaderModule(device, shaderModule, nullptr);
-        }
+void ShaderProgram::loadShaders(Context& context, const std::vector<ShaderLoadInfo>& shaderInfos){
+    numShaders = shaderInfos.size();
+    shaderModules.clear();
+    shaderModules.reserve(numShaders);
+    vkShaderStages.resize(numShaders);
+    shaderEntrypoints.resize(numShaders);
+    for(int i = 0; i < numShaders; i++){
+        shaderEntrypoints[i] = shaderInfos[i].entrypoint;
+
+        vkShaderStages[i] = {};
+        vkShaderStages[i].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        vkShaderStages[i].stage = shaderInfos[i].stage;
+        vkShaderStages[i].module = makeVkShaderModule(context, shaderInfos[i]);
+        vkShaderStages[i].pName = shaderEntrypoints[i].c_str();
+        vkShaderStages[i].pSpecializationInfo = shaderInfos[i].vkSpecializationInfo;
     }
+    VILLAINY_VERBOSE_LOG(context.logger, "Created shader modules & stages.");
 }
 
-VkShaderModule ShaderProgram::makeVkShaderModule(ShaderLoadInfo shaderInfo){
-    auto shaderCode = readFile(shaderInfo.filepath);
-    
-    VkShaderModuleCreateInfo shaderCreateInfo{};
-    shaderCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    shaderCreateInfo.codeSize = shaderCode.size();
-    shaderCreateInfo.pCode = reinterpret_cast<const uint32_t*>(shaderCode.data());
+VkShaderModule ShaderProgram::makeVkShaderModule(Context& context, const ShaderLoadInfo& shaderInfo){
+    // a stage another program already loaded is only hashed, not created and validated again
+    std::shared_ptr<ShaderModule> shaderModule = context.getShaderModuleCache().load(shaderInfo.filepath);
 
-    VkShaderModule vkShaderModule;
-    if(vkCreateShaderModule(device, &shaderCreateInfo, nullptr, &vkShaderModule) != VK_SUCCESS){
-        throw std::runtime_error("Failed to create shader module!");
+    // reflection is optional for programs with a hand-written layout, anything it can't parse only turns it off
+    try{
+        reflection.merge(shaderModule->reflect(shaderInfo.stage));
+    }
+    catch(const std::runtime_error&){
+        if(requireReflection){
+            throw;
+        }
+        reflected = false;
     }
 
+    VkShaderModule vkShaderModule = shaderModule->getModule();
+    shaderModules.push_back(std::move(shaderModule));
     return vkShaderModule;
 }
 
@@ -4,11 +4,14 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include <memory>
 #include <string>
 #include <stdexcept>
 #include <vector>
 
 #include "utils.hpp"
+#include "spirvReflect.hpp"
+#include "shaderCache.hpp"
 
 namespace vlny{
 
@@ -32,17 +35,28 @@ struct ShaderLayoutDescriptor{
 class ShaderProgram{
 public:
     ShaderProgram(Context& context, std::vector<ShaderLoadInfo> shaderInfos, std::vector<ShaderLayoutDescriptor> descriptorSetLayout);
-    ~ShaderProgram();
+    // set 0 comes from the reflected SPIR-V, GraphicsPipeline also picks up the other sets, push constants and
+    // (with GraphicsPipelineConfig::reflectVertexInput) the vertex inputs
+    ShaderProgram(Context& context, std::vector<ShaderLoadInfo> shaderInfos);
+
+    // merged over every stage, only meaningful when isReflected()
+    const ShaderReflection& getReflection() const { return reflection; }
+    bool isReflected() const { return reflected; }
 
 private:
     int numShaders;
-    VkDevice device;
-    std::vector<VkShaderModule> vkShaderModules;
+    std::vector<std::shared_ptr<ShaderModule>> shaderModules; // from the context's ShaderModuleCache
     std::vector<VkPipelineShaderStageCreateInfo> vkShaderStages;
     std::vector<std::string> shaderEntrypoints;
-    VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+    VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE; // owned by the context's DescriptorLayoutCache
+    std::vector<VkDescriptorSetLayoutBinding> layoutBindings; // for pipelines that need set 0 with other layout flags
+
+    ShaderReflection reflection;
+    bool reflected = true; // false when a module uses something the reflection can't describe
+    bool requireReflection = false;
 
-    VkShaderModule makeVkShaderModule(ShaderLoadInfo shaderInfo);
+    void loadShaders(Context& context, const std::vector<ShaderLoadInfo>& shaderInfos);
+    VkShaderModule makeVkShaderModule(Context& context, const ShaderLoadInfo& shaderInfo);
 
     friend class GraphicsPipeline;
 };
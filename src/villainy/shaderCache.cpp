@@ -0,0 +1,124 @@
+#include "shaderCache.hpp"
+
+#include "context.hpp"
+
+#include <cstring>
+#include <string_view>
+
+namespace vlny{
+
+namespace{
+
+size_t hashCode(const uint32_t* code, size_t wordCount){
+    return std::hash<std::string_view>{}(std::string_view(reinterpret_cast<const char*>(code), wordCount * sizeof(uint32_t)));
+}
+
+}
+
+ShaderModule::ShaderModule(Context& context, const uint32_t* code, size_t wordCount) : context(context), code(code, code + wordCount) {
+    VkShaderModuleCreateInfo shaderCreateInfo{};
+    shaderCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    shaderCreateInfo.codeSize = wordCount * sizeof(uint32_t);
+    shaderCreateInfo.pCode = code;
+
+    if(vkCreateShaderModule(context.logicalDevice, &shaderCreateInfo, nullptr, &vkShaderModule) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create shader module!");
+    }
+}
+
+ShaderModule::~ShaderModule(){
+    if(vkShaderModule != VK_NULL_HANDLE){
+        vkDestroyShaderModule(context.logicalDevice, vkShaderModule, nullptr);
+    }
+}
+
+ShaderReflection ShaderModule::reflect(VkShaderStageFlagBits stage){
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = reflections.find(stage);
+    if(found != reflections.end()){
+        return found->second;
+    }
+    ShaderReflection reflection = reflectSpirv(code.data(), code.size(), stage);
+    reflections.emplace(stage, reflection);
+    return reflection;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+ShaderModuleCache::ShaderModuleCache(Context& context) : context(context) {}
+
+std::shared_ptr<ShaderModule> ShaderModuleCache::load(const std::string& path){
+    MappedFile file(path);
+    if(file.size() == 0 || file.size() % sizeof(uint32_t) != 0){
+        throw std::runtime_error("Shader " + path + " is not SPIR-V!");
+    }
+    // mappings are page aligned
+    return get(reinterpret_cast<const uint32_t*>(file.data()), file.size() / sizeof(uint32_t));
+}
+
+std::shared_ptr<ShaderModule> ShaderModuleCache::get(const uint32_t* code, size_t wordCount){
+    size_t hash = hashCode(code, wordCount);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(auto module = find(hash, code, wordCount)){
+            return module;
+        }
+    }
+
+    // validated by the driver without holding the lock
+    auto module = std::make_shared<ShaderModule>(context, code, wordCount);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if(auto existing = find(hash, code, wordCount)){
+        return existing;
+    }
+    modules[hash].push_back(module);
+    count++;
+    VILLAINY_VERBOSE_LOG(context.logger, "Cached shader module (" + std::to_string(count) + " cached).");
+    return module;
+}
+
+std::shared_ptr<ShaderModule> ShaderModuleCache::find(size_t hash, const uint32_t* code, size_t wordCount) const{
+    auto bucket = modules.find(hash);
+    if(bucket == modules.end()){
+        return nullptr;
+    }
+    for(const auto& module : bucket->second){
+        const std::vector<uint32_t>& cached = module->getCode();
+        if(cached.size() == wordCount && std::memcmp(cached.data(), code, wordCount * sizeof(uint32_t)) == 0){
+            return module;
+        }
+    }
+    return nullptr;
+}
+
+void ShaderModuleCache::trim(){
+    std::lock_guard<std::mutex> lock(mutex);
+    for(auto it = modules.begin(); it != modules.end();){
+        auto& bucket = it->second;
+        for(size_t i = 0; i < bucket.size();){
+            if(bucket[i].use_count() == 1){
+                bucket[i] = std::move(bucket.back());
+                bucket.pop_back();
+                count--;
+            }
+            else{
+                i++;
+            }
+        }
+        it = bucket.empty() ? modules.erase(it) : std::next(it);
+    }
+}
+
+void ShaderModuleCache::clear(){
+    std::lock_guard<std::mutex> lock(mutex);
+    modules.clear();
+    count = 0;
+}
+
+size_t ShaderModuleCache::size() const{
+    std::lock_guard<std::mutex> lock(mutex);
+    return count;
+}
+
+}
@@ -0,0 +1,74 @@
+#ifndef VILLAINY_SHADER_CACHE
+#define VILLAINY_SHADER_CACHE
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "spirvReflect.hpp"
+
+namespace vlny{
+
+class Context;
+
+// one VkShaderModule, shared by every ShaderProgram built from the same SPIR-V, destroyed with its last handle
+class ShaderModule{
+public:
+    ShaderModule(Context& context, const uint32_t* code, size_t wordCount);
+    ~ShaderModule();
+
+    ShaderModule(const ShaderModule&) = delete;
+    ShaderModule& operator=(const ShaderModule&) = delete;
+
+    VkShaderModule getModule() const { return vkShaderModule; }
+    const std::vector<uint32_t>& getCode() const { return code; }
+    // parsed once per stage, throws like reflectSpirv when the module uses something it can't describe
+    ShaderReflection reflect(VkShaderStageFlagBits stage);
+private:
+    Context& context;
+    VkShaderModule vkShaderModule = VK_NULL_HANDLE;
+    std::vector<uint32_t> code; // kept to tell hash collisions apart and for reflecting other stages
+
+    std::map<VkShaderStageFlagBits, ShaderReflection> reflections;
+    std::mutex mutex;
+};
+
+// de-duplicates shader modules by content, so programs sharing a stage (or two files with the same SPIR-V) create and
+// validate it once. files are memory mapped, a hit only hashes the mapping and never copies it
+// the cache keeps its own reference, trim() lets go of the modules no program uses anymore
+class ShaderModuleCache{
+public:
+    ShaderModuleCache(Context& context);
+
+    ShaderModuleCache(const ShaderModuleCache&) = delete;
+    ShaderModuleCache& operator=(const ShaderModuleCache&) = delete;
+
+    std::shared_ptr<ShaderModule> load(const std::string& path);
+    std::shared_ptr<ShaderModule> get(const uint32_t* code, size_t wordCount);
+
+    // a PipelineLibraryCache keys its libraries on module handles, don't trim while one built from them is alive
+    void trim();
+    void clear();
+
+    size_t size() const;
+private:
+    Context& context;
+
+    // content hash -> modules that landed in it, compared on lookup
+    std::unordered_map<size_t, std::vector<std::shared_ptr<ShaderModule>>> modules;
+    size_t count = 0;
+
+    mutable std::mutex mutex;
+
+    std::shared_ptr<ShaderModule> find(size_t hash, const uint32_t* code, size_t wordCount) const;
+};
+
+}
+
+#endif
@@ -0,0 +1,393 @@
+#include "spirvReflect.hpp"
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace vlny{
+
+namespace{
+
+// the few SPIR-V enums reflection needs, values from the SPIR-V specification
+constexpr uint32_t spirvMagic = 0x07230203;
+
+constexpr uint32_t OpExecutionMode = 16;
+constexpr uint32_t OpTypeInt = 21;
+constexpr uint32_t OpTypeFloat = 22;
+constexpr uint32_t OpTypeVector = 23;
+constexpr uint32_t OpTypeMatrix = 24;
+constexpr uint32_t OpTypeImage = 25;
+constexpr uint32_t OpTypeSampler = 26;
+constexpr uint32_t OpTypeSampledImage = 27;
+constexpr uint32_t OpTypeArray = 28;
+constexpr uint32_t OpTypeRuntimeArray = 29;
+constexpr uint32_t OpTypeStruct = 30;
+constexpr uint32_t OpTypePointer = 32;
+constexpr uint32_t OpConstant = 43;
+constexpr uint32_t OpSpecConstant = 50;
+constexpr uint32_t OpFunction = 54;
+constexpr uint32_t OpVariable = 59;
+constexpr uint32_t OpDecorate = 71;
+constexpr uint32_t OpMemberDecorate = 72;
+constexpr uint32_t OpTypeAccelerationStructureKHR = 5341;
+
+constexpr uint32_t DecorationBufferBlock = 3;
+constexpr uint32_t DecorationArrayStride = 6;
+constexpr uint32_t DecorationMatrixStride = 7;
+constexpr uint32_t DecorationLocation = 30;
+constexpr uint32_t DecorationBinding = 33;
+constexpr uint32_t DecorationDescriptorSet = 34;
+constexpr uint32_t DecorationOffset = 35;
+
+constexpr uint32_t StorageUniformConstant = 0;
+constexpr uint32_t StorageInput = 1;
+constexpr uint32_t StorageUniform = 2;
+constexpr uint32_t StoragePushConstant = 9;
+constexpr uint32_t StorageStorageBuffer = 12;
+
+constexpr uint32_t ExecutionModeLocalSize = 17;
+constexpr uint32_t DimBuffer = 5;
+constexpr uint32_t DimSubpassData = 6;
+
+struct Instruction{
+    uint32_t opcode;
+    const uint32_t* operands; // everything after the opcode word
+    uint32_t count;
+};
+
+struct Module{
+    std::unordered_map<uint32_t, Instruction> types; // types and constants by result id
+    std::unordered_map<uint32_t, std::map<uint32_t, uint32_t>> decorations; // id -> decoration -> first literal
+    std::map<std::pair<uint32_t, uint32_t>, std::map<uint32_t, uint32_t>> memberDecorations; // (struct, member) -> ...
+    std::vector<Instruction> variables; // module scope only
+    std::set<uint32_t> referenced; // every word used inside a function, literals included, so it may over-report
+    uint32_t workgroupSize[3] = {1, 1, 1};
+
+    const Instruction& type(uint32_t id) const{
+        auto it = types.find(id);
+        if(it == types.end()){
+            throw std::runtime_error("SPIR-V references an undefined type!");
+        }
+        return it->second;
+    }
+    bool has(uint32_t id, uint32_t decoration) const{
+        auto it = decorations.find(id);
+        return it != decorations.end() && it->second.count(decoration) > 0;
+    }
+    uint32_t get(uint32_t id, uint32_t decoration) const{
+        auto it = decorations.find(id);
+        if(it == decorations.end() || it->second.count(decoration) == 0){
+            return 0;
+        }
+        return it->second.at(decoration);
+    }
+    uint32_t getMember(uint32_t structId, uint32_t member, uint32_t decoration) const{
+        auto it = memberDecorations.find({structId, member});
+        if(it == memberDecorations.end() || it->second.count(decoration) == 0){
+            return 0;
+        }
+        return it->second.at(decoration);
+    }
+    uint32_t constant(uint32_t id) const{
+        const Instruction& c = type(id);
+        if(c.opcode != OpConstant && c.opcode != OpSpecConstant){
+            throw std::runtime_error("SPIR-V array length isn't a constant!");
+        }
+        return c.operands[2]; // spec constants report their default
+    }
+};
+
+bool isTypeDeclaration(uint32_t opcode){
+    return (opcode >= 19 && opcode <= 39) || opcode == OpTypeAccelerationStructureKHR; // OpTypeVoid .. OpTypeForwardPointer
+}
+
+Module parse(const uint32_t* code, size_t wordCount){
+    if(wordCount < 5 || code[0] != spirvMagic){
+        throw std::runtime_error("Not a SPIR-V module!");
+    }
+
+    Module module;
+    bool inFunctions = false;
+    size_t i = 5;
+    while(i < wordCount){
+        uint32_t words = code[i] >> 16;
+        uint32_t opcode = code[i] & 0xffff;
+        if(words == 0 || i + words > wordCount){
+            throw std::runtime_error("Malformed SPIR-V module!");
+        }
+        Instruction inst{opcode, code + i + 1, words - 1};
+        const uint32_t* o = inst.operands;
+
+        if(opcode == OpFunction){
+            inFunctions = true;
+        }
+        if(inFunctions){
+            module.referenced.insert(o, o + inst.count);
+        }
+        else if(opcode == OpDecorate && inst.count >= 2){
+            module.decorations[o[0]][o[1]] = inst.count >= 3 ? o[2] : 0;
+        }
+        else if(opcode == OpMemberDecorate && inst.count >= 3){
+            module.memberDecorations[{o[0], o[1]}][o[2]] = inst.count >= 4 ? o[3] : 0;
+        }
+        else if(opcode == OpExecutionMode && inst.count >= 5 && o[1] == ExecutionModeLocalSize){
+            std::copy(o + 2, o + 5, module.workgroupSize);
+        }
+        else if(isTypeDeclaration(opcode) && inst.count >= 1){
+            module.types[o[0]] = inst;
+        }
+        else if((opcode == OpConstant || opcode == OpSpecConstant) && inst.count >= 3){
+            module.types[o[1]] = inst;
+        }
+        else if(opcode == OpVariable && inst.count >= 3){
+            module.variables.push_back(inst);
+        }
+        i += words;
+    }
+    return module;
+}
+
+uint32_t typeSize(const Module& module, uint32_t id, uint32_t matrixStride);
+
+uint32_t structSize(const Module& module, uint32_t id){
+    const Instruction& t = module.type(id);
+    uint32_t size = 0;
+    for(uint32_t m = 1; m < t.count; m++){
+        uint32_t offset = module.getMember(id, m - 1, DecorationOffset);
+        uint32_t stride = module.getMember(id, m - 1, DecorationMatrixStride);
+        size = std::max(size, offset + typeSize(module, t.operands[m], stride));
+    }
+    return size;
+}
+
+uint32_t typeSize(const Module& module, uint32_t id, uint32_t matrixStride){
+    const Instruction& t = module.type(id);
+    const uint32_t* o = t.operands;
+    switch(t.opcode){
+        case OpTypeInt:
+        case OpTypeFloat:
+            return o[1] / 8;
+        case OpTypeVector:
+            return o[2] * typeSize(module, o[1], 0);
+        case OpTypeMatrix:
+            return o[2] * (matrixStride != 0 ? matrixStride : typeSize(module, o[1], 0));
+        case OpTypeArray:{
+            uint32_t stride = module.get(id, DecorationArrayStride);
+            return module.constant(o[2]) * (stride != 0 ? stride : typeSize(module, o[1], matrixStride));
+        }
+        case OpTypeRuntimeArray:
+            return 0;
+        case OpTypeStruct:
+            return structSize(module, id);
+        default:
+            throw std::runtime_error("Unsupported type inside a SPIR-V block!");
+    }
+}
+
+VkDescriptorType descriptorType(const Module& module, uint32_t typeId, uint32_t storageClass){
+    const Instruction& t = module.type(typeId);
+    const uint32_t* o = t.operands;
+    switch(t.opcode){
+        case OpTypeStruct:
+            return (storageClass == StorageStorageBuffer || module.has(typeId, DecorationBufferBlock)) ?
+                VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        case OpTypeSampledImage:
+            return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        case OpTypeSampler:
+            return VK_DESCRIPTOR_TYPE_SAMPLER;
+        case OpTypeImage:{
+            uint32_t dim = o[2];
+            uint32_t sampled = o[6]; // 1 = sampled, 2 = storage
+            if(dim == DimSubpassData){
+                return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+            }
+            if(dim == DimBuffer){
+                return sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+            }
+            return sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        }
+        case OpTypeAccelerationStructureKHR:
+            return VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+        default:
+            throw std::runtime_error("Unsupported SPIR-V resource type!");
+    }
+}
+
+VkFormat vertexFormat(const Module& module, uint32_t typeId, uint32_t& size){
+    const Instruction& t = module.type(typeId);
+    uint32_t components = 1;
+    uint32_t scalarId = typeId;
+    if(t.opcode == OpTypeVector){
+        components = t.operands[2];
+        scalarId = t.operands[1];
+    }
+    const Instruction& scalar = module.type(scalarId);
+    if((scalar.opcode != OpTypeFloat && scalar.opcode != OpTypeInt) || scalar.operands[1] != 32 || components > 4){
+        throw std::runtime_error("Only 32 bit scalar and vector vertex inputs can be reflected!");
+    }
+
+    static const VkFormat floats[4] = {VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT};
+    static const VkFormat sints[4] = {VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT};
+    static const VkFormat uints[4] = {VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT};
+    size = 4 * components;
+    if(scalar.opcode == OpTypeFloat){
+        return floats[components - 1];
+    }
+    return scalar.operands[2] == 1 ? sints[components - 1] : uints[components - 1];
+}
+
+}
+
+ShaderReflection reflectSpirv(const uint32_t* code, size_t wordCount, VkShaderStageFlagBits stage){
+    Module module = parse(code, wordCount);
+
+    ShaderReflection reflection;
+    reflection.stages = stage;
+    if(stage == VK_SHADER_STAGE_COMPUTE_BIT){
+        std::copy(module.workgroupSize, module.workgroupSize + 3, reflection.workgroupSize);
+    }
+
+    for(const Instruction& variable : module.variables){
+        uint32_t id = variable.operands[1];
+        uint32_t storageClass = variable.operands[2];
+        const Instruction& pointer = module.type(variable.operands[0]);
+        if(pointer.opcode != OpTypePointer){
+            continue;
+        }
+        uint32_t typeId = pointer.operands[2];
+
+        if(storageClass == StorageInput){
+            // builtins (gl_VertexIndex, ...) carry no location
+            if(stage != VK_SHADER_STAGE_VERTEX_BIT || !module.has(id, DecorationLocation)){
+                continue;
+            }
+            uint32_t location = module.get(id, DecorationLocation);
+            const Instruction& t = module.type(typeId);
+            // matrices take one location per column
+            uint32_t columns = t.opcode == OpTypeMatrix ? t.operands[2] : 1;
+            uint32_t columnType = t.opcode == OpTypeMatrix ? t.operands[1] : typeId;
+            for(uint32_t c = 0; c < columns; c++){
+                ReflectedVertexInput input{};
+                input.location = location + c;
+                input.format = vertexFormat(module, columnType, input.size);
+                reflection.vertexInputs.push_back(input);
+            }
+        }
+        else if(storageClass == StoragePushConstant){
+            if(module.referenced.count(id) == 0){
+                continue;
+            }
+            const Instruction& block = module.type(typeId);
+            uint32_t start = UINT32_MAX;
+            for(uint32_t m = 1; m < block.count; m++){
+                start = std::min(start, module.getMember(typeId, m - 1, DecorationOffset));
+            }
+            uint32_t end = structSize(module, typeId);
+            if(start < end){
+                reflection.pushConstants.stageFlags = stage;
+                reflection.pushConstants.offset = start;
+                reflection.pushConstants.size = end - start;
+            }
+        }
+        else if(storageClass == StorageUniformConstant || storageClass == StorageUniform || storageClass == StorageStorageBuffer){
+            if(module.referenced.count(id) == 0 || !module.has(id, DecorationBinding)){
+                continue;
+            }
+            ReflectedBinding binding{};
+            binding.set = module.get(id, DecorationDescriptorSet);
+            binding.binding = module.get(id, DecorationBinding);
+            binding.stages = stage;
+            binding.descriptorCount = 1;
+            const Instruction* t = &module.type(typeId);
+            while(t->opcode == OpTypeArray || t->opcode == OpTypeRuntimeArray){
+                if(t->opcode == OpTypeArray){
+                    binding.descriptorCount *= module.constant(t->operands[2]);
+                }
+                typeId = t->operands[1];
+                t = &module.type(typeId);
+            }
+            binding.type = descriptorType(module, typeId, storageClass);
+            reflection.bindings.push_back(binding);
+        }
+    }
+
+    std::sort(reflection.bindings.begin(), reflection.bindings.end(), [](const ReflectedBinding& a, const ReflectedBinding& b){
+        return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+    });
+    std::sort(reflection.vertexInputs.begin(), reflection.vertexInputs.end(), [](const ReflectedVertexInput& a, const ReflectedVertexInput& b){
+        return a.location < b.location;
+    });
+    return reflection;
+}
+
+uint32_t ShaderReflection::setCount() const{
+    uint32_t count = 0;
+    for(const ReflectedBinding& binding : bindings){
+        count = std::max(count, binding.set + 1);
+    }
+    return count;
+}
+
+std::vector<VkDescriptorSetLayoutBinding> ShaderReflection::setBindings(uint32_t set) const{
+    std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+    for(const ReflectedBinding& binding : bindings){
+        if(binding.set != set){
+            continue;
+        }
+        VkDescriptorSetLayoutBinding layoutBinding{};
+        layoutBinding.binding = binding.binding;
+        layoutBinding.descriptorType = binding.type;
+        layoutBinding.descriptorCount = binding.descriptorCount;
+        layoutBinding.stageFlags = binding.stages;
+        layoutBindings.push_back(layoutBinding);
+    }
+    return layoutBindings;
+}
+
+void ShaderReflection::merge(const ShaderReflection& other){
+    for(const ReflectedBinding& binding : other.bindings){
+        auto it = std::find_if(bindings.begin(), bindings.end(), [&](const ReflectedBinding& existing){
+            return existing.set == binding.set && existing.binding == binding.binding;
+        });
+        if(it == bindings.end()){
+            bindings.push_back(binding);
+            continue;
+        }
+        if(it->type != binding.type){
+            throw std::runtime_error("Shader stages disagree on set " + std::to_string(binding.set) +
+                ", binding " + std::to_string(binding.binding) + "!");
+        }
+        it->stages |= binding.stages;
+        it->descriptorCount = std::max(it->descriptorCount, binding.descriptorCount);
+    }
+    std::sort(bindings.begin(), bindings.end(), [](const ReflectedBinding& a, const ReflectedBinding& b){
+        return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+    });
+
+    // one range covering every stage, pushes then use the union of the stage flags
+    if(other.pushConstants.size != 0){
+        if(pushConstants.size == 0){
+            pushConstants = other.pushConstants;
+        }
+        else{
+            uint32_t start = std::min(pushConstants.offset, other.pushConstants.offset);
+            uint32_t end = std::max(pushConstants.offset + pushConstants.size, other.pushConstants.offset + other.pushConstants.size);
+            pushConstants.offset = start;
+            pushConstants.size = end - start;
+            pushConstants.stageFlags |= other.pushConstants.stageFlags;
+        }
+    }
+
+    if(other.stages & VK_SHADER_STAGE_VERTEX_BIT){
+        vertexInputs = other.vertexInputs;
+    }
+    if(other.stages & VK_SHADER_STAGE_COMPUTE_BIT){
+        std::copy(other.workgroupSize, other.workgroupSize + 3, workgroupSize);
+    }
+    stages |= other.stages;
+}
+
+}
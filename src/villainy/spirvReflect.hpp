@@ -0,0 +1,47 @@
+#ifndef VILLAINY_SPIRV_REFLECT
+#define VILLAINY_SPIRV_REFLECT
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace vlny{
+
+struct ReflectedBinding{
+    uint32_t set;
+    uint32_t binding;
+    VkDescriptorType type;
+    uint32_t descriptorCount = 1; // runtime sized arrays report 1, size those layouts by hand
+    VkShaderStageFlags stages = 0;
+};
+
+struct ReflectedVertexInput{
+    uint32_t location;
+    VkFormat format;
+    uint32_t size; // bytes
+};
+
+// what a set of SPIR-V modules expects from the pipeline, gathered from decorations alone (no shader compiler needed)
+// resources are only listed when a function actually references them, so unused declarations don't grow the layouts
+struct ShaderReflection{
+    VkShaderStageFlags stages = 0;
+    std::vector<ReflectedBinding> bindings; // sorted by set, then binding
+    VkPushConstantRange pushConstants{}; // size 0 when no stage has push constants
+    std::vector<ReflectedVertexInput> vertexInputs; // vertex stage only, sorted by location
+    uint32_t workgroupSize[3] = {1, 1, 1}; // compute stage only
+
+    uint32_t setCount() const;
+    std::vector<VkDescriptorSetLayoutBinding> setBindings(uint32_t set) const;
+    // stages using the same binding are or'ed together, push constant ranges grow to cover every stage
+    void merge(const ShaderReflection& other);
+};
+
+ShaderReflection reflectSpirv(const uint32_t* code, size_t wordCount, VkShaderStageFlagBits stage);
+
+}
+
+#endif
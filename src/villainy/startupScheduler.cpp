@@ -0,0 +1,207 @@
+#include "startupScheduler.hpp"
+
+#include "utils.hpp"
+
+#include <sstream>
+#include <stdexcept>
+
+namespace vlny{
+
+namespace{
+
+std::string escapeJson(const std::string& text){
+    std::string escaped;
+    for(char c : text){
+        if(c == '"' || c == '\\'){
+            escaped += '\\';
+        }
+        escaped += (c == '\n' || c == '\t') ? ' ' : c;
+    }
+    return escaped;
+}
+
+}
+
+StartupScheduler::StartupScheduler(uint32_t threadCount) : origin(std::chrono::steady_clock::now()), pool(threadCount) {}
+
+StartupScheduler::TaskId StartupScheduler::addTask(const std::string& name, std::function<void()> task, const std::vector<TaskId>& dependencies){
+    return add(name, std::move(task), dependencies, false);
+}
+
+StartupScheduler::TaskId StartupScheduler::addMainThreadTask(const std::string& name, std::function<void()> task, const std::vector<TaskId>& dependencies){
+    return add(name, std::move(task), dependencies, true);
+}
+
+StartupScheduler::TaskId StartupScheduler::add(const std::string& name, std::function<void()> task, const std::vector<TaskId>& dependencies, bool mainThread){
+    std::lock_guard<std::mutex> lock(mutex);
+    TaskId id = tasks.size();
+    Task entry;
+    entry.name = name;
+    entry.task = std::move(task);
+    entry.mainThread = mainThread;
+    for(TaskId dependency : dependencies){
+        if(dependency >= id){
+            throw std::runtime_error("Startup task " + name + " depends on a task that doesn't exist yet!");
+        }
+        Task& before = tasks[dependency];
+        if(before.failed){
+            entry.failed = true;
+        }
+        if(!before.finished){
+            before.dependents.push_back(id);
+            entry.remaining++;
+        }
+    }
+    tasks.push_back(std::move(entry));
+    return id;
+}
+
+void StartupScheduler::run(){
+    std::unique_lock<std::mutex> lock(mutex);
+    threadIndices[std::this_thread::get_id()] = 0;
+    firstError = nullptr;
+
+    std::vector<TaskId> ready;
+    for(TaskId id = 0; id < tasks.size(); id++){
+        if(!tasks[id].scheduled && !tasks[id].finished){
+            unfinished++;
+            if(tasks[id].remaining == 0){
+                ready.push_back(id);
+            }
+        }
+    }
+    for(TaskId id : ready){
+        if(tasks[id].failed){
+            finish(id, true);
+        }
+        else{
+            dispatch(id);
+        }
+    }
+
+    while(unfinished > 0){
+        if(!mainThreadQueue.empty()){
+            TaskId id = mainThreadQueue.front();
+            mainThreadQueue.pop_front();
+            lock.unlock();
+            execute(id);
+            lock.lock();
+            continue;
+        }
+        progress.wait(lock);
+    }
+
+    if(firstError){
+        std::exception_ptr error = firstError;
+        firstError = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+// with the lock held
+void StartupScheduler::dispatch(TaskId id){
+    tasks[id].scheduled = true;
+    if(tasks[id].mainThread){
+        mainThreadQueue.push_back(id);
+        progress.notify_all();
+    }
+    else{
+        pool.submit([this, id](){ execute(id); });
+    }
+}
+
+void StartupScheduler::execute(TaskId id){
+    double start = elapsed();
+    bool failed = false;
+    try{
+        tasks[id].task();
+    }
+    catch(...){
+        failed = true;
+        std::lock_guard<std::mutex> lock(mutex);
+        if(!firstError){
+            firstError = std::current_exception();
+        }
+    }
+    double end = elapsed();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    timeline.push_back({tasks[id].name, threadIndex(), start, end});
+    finish(id, failed);
+}
+
+// with the lock held, unblocks the dependents and skips them when `failed`
+void StartupScheduler::finish(TaskId id, bool failed){
+    Task& task = tasks[id];
+    task.finished = true;
+    task.failed = task.failed || failed;
+    if(task.failed && !task.scheduled){
+        double now = elapsed();
+        StartupEvent event{task.name, 0, now, now};
+        event.skipped = true;
+        timeline.push_back(event);
+    }
+    task.task = nullptr; // whatever it captured goes now
+
+    for(TaskId dependentId : task.dependents){
+        Task& dependent = tasks[dependentId];
+        dependent.failed = dependent.failed || task.failed;
+        if(--dependent.remaining == 0 && !dependent.scheduled){
+            if(dependent.failed){
+                finish(dependentId, true);
+            }
+            else{
+                dispatch(dependentId);
+            }
+        }
+    }
+    unfinished--;
+    progress.notify_all();
+}
+
+// with the lock held
+uint32_t StartupScheduler::threadIndex(){
+    auto [it, inserted] = threadIndices.emplace(std::this_thread::get_id(), static_cast<uint32_t>(threadIndices.size()));
+    return it->second;
+}
+
+void StartupScheduler::mark(const std::string& name){
+    double now = elapsed();
+    std::lock_guard<std::mutex> lock(mutex);
+    timeline.push_back({name, threadIndex(), now, now});
+}
+
+double StartupScheduler::elapsed() const{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - origin).count();
+}
+
+std::vector<StartupEvent> StartupScheduler::getTimeline() const{
+    std::lock_guard<std::mutex> lock(mutex);
+    return timeline;
+}
+
+std::string StartupScheduler::timelineJson() const{
+    std::vector<StartupEvent> events = getTimeline();
+    std::ostringstream json;
+    json << "{\"traceEvents\":[";
+    for(size_t i = 0; i < events.size(); i++){
+        const StartupEvent& event = events[i];
+        std::string name = escapeJson(event.name) + (event.skipped ? " (skipped)" : "");
+        json << (i > 0 ? "," : "") << "{\"name\":\"" << name << "\",\"pid\":0,\"tid\":" << event.thread
+             << ",\"ts\":" << static_cast<uint64_t>(event.start * 1000.0);
+        if(event.end > event.start){
+            json << ",\"ph\":\"X\",\"dur\":" << static_cast<uint64_t>((event.end - event.start) * 1000.0) << "}";
+        }
+        else{
+            json << ",\"ph\":\"i\",\"s\":\"g\"}";
+        }
+    }
+    json << "]}";
+    return json.str();
+}
+
+void StartupScheduler::writeTimeline(const std::string& path) const{
+    saveToFile(path, timelineJson());
+}
+
+}
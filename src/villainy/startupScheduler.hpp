@@ -0,0 +1,93 @@
+#ifndef VILLAINY_STARTUP_SCHEDULER
+#define VILLAINY_STARTUP_SCHEDULER
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "threadPool.hpp"
+
+namespace vlny{
+
+struct StartupEvent{
+    std::string name;
+    uint32_t thread; // 0 is the thread that called run(), workers count up from 1
+    double start; // milliseconds since the scheduler was created
+    double end; // equal to start for marks
+    bool skipped = false; // a dependency threw, the task never ran
+};
+
+// runs application startup as a dependency graph: independent pieces (shader programs, pipeline builds, texture decodes)
+// go to a thread pool as soon as what they depend on is done, while the pieces that need the main thread (GLFW windows,
+// anything using the vulkan queues or command pools, e.g. buffer uploads) run on the thread calling run()
+// every task is timed, together with mark() that gives a timeline from process start to first frame that can be
+// logged or loaded into chrome://tracing / Perfetto with writeTimeline()
+//
+// add tasks before run(), not from inside them
+class StartupScheduler{
+public:
+    using TaskId = size_t;
+
+    explicit StartupScheduler(uint32_t threadCount = 0); // 0 = hardware concurrency
+
+    StartupScheduler(const StartupScheduler&) = delete;
+    StartupScheduler& operator=(const StartupScheduler&) = delete;
+
+    TaskId addTask(const std::string& name, std::function<void()> task, const std::vector<TaskId>& dependencies = {});
+    TaskId addMainThreadTask(const std::string& name, std::function<void()> task, const std::vector<TaskId>& dependencies = {});
+
+    // blocks until every task added so far ran, tasks added afterwards can go through another run()
+    // the first exception a task throws comes out here once the running ones finished, its dependents are skipped
+    void run();
+
+    // an instant on the timeline, e.g. "first frame"
+    void mark(const std::string& name);
+    double elapsed() const; // milliseconds since the scheduler was created
+
+    std::vector<StartupEvent> getTimeline() const;
+    std::string timelineJson() const; // chrome trace event format
+    void writeTimeline(const std::string& path) const;
+private:
+    struct Task{
+        std::string name;
+        std::function<void()> task;
+        bool mainThread;
+        std::vector<TaskId> dependents;
+        uint32_t remaining = 0; // dependencies not finished yet
+        bool scheduled = false;
+        bool finished = false;
+        bool failed = false; // threw, or a dependency did
+    };
+    std::vector<Task> tasks;
+
+    std::chrono::steady_clock::time_point origin;
+    std::vector<StartupEvent> timeline;
+    std::map<std::thread::id, uint32_t> threadIndices;
+
+    std::deque<TaskId> mainThreadQueue;
+    size_t unfinished = 0;
+    std::exception_ptr firstError;
+
+    mutable std::mutex mutex;
+    std::condition_variable progress;
+
+    ThreadPool pool; // declared last, its destructor drains it before the rest goes
+
+    TaskId add(const std::string& name, std::function<void()> task, const std::vector<TaskId>& dependencies, bool mainThread);
+    void dispatch(TaskId id);
+    void execute(TaskId id);
+    void finish(TaskId id, bool failed);
+    uint32_t threadIndex();
+};
+
+}
+
+#endif
@@ -65,6 +65,7 @@ private:
     friend class GraphicsPipeline;
     friend class Renderer;
     friend class MultiRenderer;
+    friend class PipelineCache;
 };
 
 }
@@ -1,6 +1,10 @@
 #include "texture.hpp"
 #include "context.hpp"
 #include "buffer.hpp"
+#include "mipmap.hpp"
+#include "textureFile.hpp"
+
+#include <algorithm>
 
 namespace vlny{
 
@@ -8,6 +12,12 @@ Sampler::Sampler(SamplerConfig config, Context& context) : config(config), conte
     init();
 }
 
+Sampler::~Sampler(){
+    if(vkSampler != VK_NULL_HANDLE){
+        vkDestroySampler(context.logicalDevice, vkSampler, nullptr);
+    }
+}
+
 void Sampler::init(){
     VkSamplerCreateInfo samplerInfo{};
     samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -29,11 +39,10 @@ void Sampler::init(){
     // unnormalized: [0, width/height)  |  normalized: [0, 1)
     samplerInfo.compareEnable = config.compareEnable;
     samplerInfo.compareOp = config.compareOp;
-    // TODO: make configs for the rest of these
-    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-    samplerInfo.mipLodBias = 0.0f;
-    samplerInfo.minLod = 0.0f;
-    samplerInfo.maxLod = 0.0f;
+    samplerInfo.mipmapMode = config.mipmapMode;
+    samplerInfo.mipLodBias = config.mipLodBias;
+    samplerInfo.minLod = config.minLod;
+    samplerInfo.maxLod = config.maxLod;
 
     if(vkCreateSampler(context.logicalDevice, &samplerInfo, nullptr, &vkSampler) != VK_SUCCESS){
         throw std::runtime_error("Failed to create sampler!");
@@ -43,88 +52,245 @@ void Sampler::init(){
 
 // ------------------------------------------------------------------------------------------------------------------------
 
-Texture::Texture(Context& context, std::string imagepath) : context(context), imagepath(imagepath.c_str()) {
+TextureSource loadTextureSource(Context& context, const std::string& path, const TextureConfig& config){
+    TextureSource source;
+
+    if(isTextureContainerFile(path)){
+        // .ktx2/.dds: block compressed payload with its mips already baked, uploaded as-is
+        TextureFileData file = loadTextureFile(path);
+
+        VkFormatProperties props;
+        vkGetPhysicalDeviceFormatProperties(context.physicalDevice, file.format, &props);
+        if(!(props.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)){
+            throw std::runtime_error(path + ": block compressed format is not supported by this GPU!");
+        }
+
+        source.format = file.format;
+        source.width = file.width;
+        source.height = file.height;
+        source.mipLevels = file.mipLevels;
+        source.data = std::move(file.data);
+        for(uint32_t i = 0; i < source.mipLevels; i++){
+            VkBufferImageCopy region{};
+            region.bufferOffset = file.levelOffsets[i];
+            region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.imageSubresource.mipLevel = i;
+            region.imageSubresource.baseArrayLayer = 0;
+            region.imageSubresource.layerCount = 1;
+            region.imageOffset = {0, 0, 0};
+            // extent is in texels, the copy handles the partial blocks of the small levels
+            region.imageExtent = {std::max(1u, file.width >> i), std::max(1u, file.height >> i), 1};
+            source.regions.push_back(region);
+        }
+        return source;
+    }
+
+    int texWidth, texHeight, texChannels;
+    stbi_uc* pixels = stbi_load(path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+    if(!pixels){
+        throw std::runtime_error(std::string("Failed to load image ") + path);
+    }
+    source.format = config.format;
+    source.width = scast_ui32(texWidth);
+    source.height = scast_ui32(texHeight);
+
+    source.mipLevels = 1;
+    if(config.generateMipmaps){
+        source.mipLevels = computeMipLevels(source.width, source.height);
+        if(config.maxMipLevels > 0){
+            source.mipLevels = std::min(source.mipLevels, config.maxMipLevels);
+        }
+    }
+    // blit on the gpu when the format allows linear filtering, otherwise downsample on the cpu before upload
+    source.gpuMipmaps = source.mipLevels > 1 && !config.forceCpuMipmaps && formatSupportsLinearBlit(context, source.format);
+    uint32_t uploadLevels = source.gpuMipmaps ? 1 : source.mipLevels;
+
+    source.data.resize(mipChainSize(source.width, source.height, uploadLevels, 4));
+    memcpy(source.data.data(), pixels, static_cast<size_t>(source.width) * source.height * 4);
+    stbi_image_free(pixels);
+    if(uploadLevels > 1){
+        bool srgb = source.format == VK_FORMAT_R8G8B8A8_SRGB;
+        generateMipChainRGBA8(source.data.data(), source.width, source.height, uploadLevels, srgb);
+    }
+
+    for(uint32_t i = 0; i < uploadLevels; i++){
+        VkBufferImageCopy region{};
+        region.bufferOffset = mipLevelOffset(source.width, source.height, i, 4);
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = i;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = {0, 0, 0};
+        region.imageExtent = {std::max(1u, source.width >> i), std::max(1u, source.height >> i), 1};
+        source.regions.push_back(region);
+    }
+    return source;
+}
+
+void createStagingBuffer(Context& context, const TextureSource& source, VkBuffer& buffer, VkDeviceMemory& memory){
+    VkDeviceSize size = source.data.size();
+    createBuffer(context, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer, memory);
+
+    void* data;
+    vkMapMemory(context.logicalDevice, memory, 0, size, 0, &data);
+    memcpy(data, source.data.data(), source.data.size());
+    vkUnmapMemory(context.logicalDevice, memory);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+Texture::Texture(Context& context, std::string imagepath, TextureConfig config) : context(context), config(config), imagepath(imagepath) {
     init();    
 }
+Texture::Texture(Context& context, const TextureSource& source) : context(context), imagepath("<memory>") {
+    upload(source);
+}
+Texture::Texture(Context& context, uint32_t width, uint32_t height, VkFormat format) : context(context), imagepath("<dynamic>") {
+    TextureSource blank;
+    blank.format = format;
+    blank.width = width;
+    blank.height = height;
+    createImage(blank);
+
+    CommandBuffer cmdBuf(context, context.getTransientCommandPool());
+    cmdBuf.beginSingletimeCommands();
+    recordImageBarrier(cmdBuf.vkCommandBuffer, image, 0, 1, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+    VkClearColorValue black{};
+    VkImageSubresourceRange range{VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    vkCmdClearColorImage(cmdBuf.vkCommandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &black, 1, &range);
+
+    recordImageBarrier(cmdBuf.vkCommandBuffer, image, 0, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+    cmdBuf.endSingletimeCommands();
+
+    imageView = makeImageView(context, image, format, 1);
+}
+Texture::Texture(Context& context, std::string imagepath, TextureConfig config, std::shared_ptr<Texture> placeholder) : context(context), config(config), imagepath(imagepath), placeholder(placeholder) {
+    // borrow the placeholder's view until the real image is resident, see TextureLoader
+    resident = false;
+    format = placeholder->format;
+    texWidth = placeholder->texWidth;
+    texHeight = placeholder->texHeight;
+    mipLevels = placeholder->mipLevels;
+    imageView = placeholder->imageView;
+}
 Texture::~Texture(){
     if(!cleaned){ cleanup(); }
 }
 void Texture::cleanup(){
     cleaned = true;
-    vkDestroyImageView(context.logicalDevice, imageView, nullptr);
+    if(resident){
+        vkDestroyImageView(context.logicalDevice, imageView, nullptr);
+    }
     vkDestroyImage(context.logicalDevice, image, nullptr);
     vkFreeMemory(context.logicalDevice, imageMemory, nullptr);
 }
 
 void Texture::init(){
-    stbi_uc* pixels = stbi_load(imagepath, &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-    if(!pixels){
-        throw std::runtime_error(std::string("Failed to load image ") + std::string(imagepath));
-    }
-    VkDeviceSize imageSize = texWidth * texHeight * 4;
-    
+    upload(loadTextureSource(context, imagepath, config));
+}
+
+void Texture::upload(const TextureSource& source){
     VkBuffer stagingBuffer;
     VkDeviceMemory stagingBufferMemory;
-    createBuffer(context, imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-    
-    void* data;
-    vkMapMemory(context.logicalDevice, stagingBufferMemory, 0, imageSize, 0, &data);
-    memcpy(data, pixels, static_cast<size_t>(imageSize));
-    vkUnmapMemory(context.logicalDevice, stagingBufferMemory);
+    createStagingBuffer(context, source, stagingBuffer, stagingBufferMemory);
 
-    stbi_image_free(pixels);
+    createImage(source);
 
-    VkImageCreateInfo imageInfo{};
-    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-    imageInfo.imageType = VK_IMAGE_TYPE_2D;
-    imageInfo.extent.width = scast_ui32(texWidth);
-    imageInfo.extent.height = scast_ui32(texHeight);
-    imageInfo.extent.depth = 1;
-    imageInfo.mipLevels = 1;
-    imageInfo.arrayLayers = 1;
-    imageInfo.format = VK_FORMAT_R8G8B8A8_SRGB;
-    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-    /*VK_IMAGE_TILING_LINEAR: Texels are laid out in row-major order like our pixels array
-    VK_IMAGE_TILING_OPTIMAL: Texels are laid out in an implementation defined order for optimal access*/
-    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    /*VK_IMAGE_LAYOUT_UNDEFINED: Not usable by the GPU and the very first transition will discard the texels.
-    VK_IMAGE_LAYOUT_PREINITIALIZED: Not usable by the GPU, but the first transition will preserve the texels.*/
-    imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT; // TODO: multisampling
-    
-    if(vkCreateImage(context.logicalDevice, &imageInfo, nullptr, &image) != VK_SUCCESS){
-        throw std::runtime_error("Failed to create image!");
-    }
+    // upload + mip generation all go in one submit
+    CommandBuffer cmdBuf(context, context.getTransientCommandPool());
+    cmdBuf.beginSingletimeCommands();
+    recordUpload(cmdBuf.vkCommandBuffer, source, stagingBuffer);
+    cmdBuf.endSingletimeCommands();
 
-    VkMemoryRequirements memRequirements;
-    vkGetImageMemoryRequirements(context.logicalDevice, image, &memRequirements);
+    vkDestroyBuffer(context.logicalDevice, stagingBuffer, nullptr);
+    vkFreeMemory(context.logicalDevice, stagingBufferMemory, nullptr);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(context.physicalDevice, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    VILLAINY_VERBOSE_LOG(context.logger, "Created image with " + std::to_string(mipLevels) + " mip level(s).");
 
-    if(vkAllocateMemory(context.logicalDevice, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS){
-        throw std::runtime_error("Failed to allocate image memory!");
+    imageView = makeImageView(context, image, format, mipLevels);
+}
+
+void Texture::makeResident(){
+    imageView = makeImageView(context, image, format, mipLevels);
+    resident = true;
+    placeholder.reset();
+    generation++;
+}
+
+void Texture::createImage(const TextureSource& source){
+    format = source.format;
+    texWidth = static_cast<int>(source.width);
+    texHeight = static_cast<int>(source.height);
+    mipLevels = source.mipLevels;
+
+    // transfer src for the gpu mip blits and so TextureStreamer can copy resident levels into a resized image
+    VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    memorySize = vlny::createImage(context, source.width, source.height, mipLevels, format, usage, image, imageMemory);
+}
+
+void Texture::recordUpload(VkCommandBuffer commandBuffer, const TextureSource& source, VkBuffer stagingBuffer){
+    recordImageBarrier(commandBuffer, image, 0, mipLevels, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+    vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        scast_ui32(source.regions.size()), source.regions.data());
+
+    if(source.gpuMipmaps){
+        recordMipmapBlits(commandBuffer);
     }
+    else{
+        recordImageBarrier(commandBuffer, image, 0, mipLevels, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+    }
+}
 
-    vkBindImageMemory(context.logicalDevice, image, imageMemory, 0);
+void Texture::recordMipmapBlits(VkCommandBuffer commandBuffer){
+    int32_t mipWidth = texWidth;
+    int32_t mipHeight = texHeight;
 
-    transitionImageLayout(context, image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    copyBufferToImage(context, context.getTransientCommandPool(), stagingBuffer, image, scast_ui32(texWidth), scast_ui32(texHeight));
-    transitionImageLayout(context, image, VK_FORMAT_R8G8B8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    for(uint32_t i = 1; i < mipLevels; i++){
+        // previous level becomes the blit source
+        recordImageBarrier(commandBuffer, image, i - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
 
-    vkDestroyBuffer(context.logicalDevice, stagingBuffer, nullptr);
-    vkFreeMemory(context.logicalDevice, stagingBufferMemory, nullptr);
+        int32_t nextWidth = mipWidth > 1 ? mipWidth / 2 : 1;
+        int32_t nextHeight = mipHeight > 1 ? mipHeight / 2 : 1;
+
+        VkImageBlit blit{};
+        blit.srcOffsets[0] = {0, 0, 0};
+        blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
+        blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.srcSubresource.mipLevel = i - 1;
+        blit.srcSubresource.baseArrayLayer = 0;
+        blit.srcSubresource.layerCount = 1;
+        blit.dstOffsets[0] = {0, 0, 0};
+        blit.dstOffsets[1] = {nextWidth, nextHeight, 1};
+        blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit.dstSubresource.mipLevel = i;
+        blit.dstSubresource.baseArrayLayer = 0;
+        blit.dstSubresource.layerCount = 1;
+
+        vkCmdBlitImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            1, &blit, VK_FILTER_LINEAR);
 
-    VILLAINY_VERBOSE_LOG(context.logger, "Created image.");
+        // done reading from it, hand it to the shaders
+        recordImageBarrier(commandBuffer, image, i - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+        mipWidth = nextWidth;
+        mipHeight = nextHeight;
+    }
 
-    imageView = makeImageView(context, image, VK_FORMAT_R8G8B8A8_SRGB);
+    // last level was only ever written to
+    recordImageBarrier(commandBuffer, image, mipLevels - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
 }
 
-void transitionImageLayout(Context& context, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout){
+void transitionImageLayout(Context& context, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels){
     CommandBuffer cmdBuf(context, context.getTransientCommandPool());
     cmdBuf.beginSingletimeCommands();
 
@@ -137,7 +303,7 @@ void transitionImageLayout(Context& context, VkImage image, VkFormat format, VkI
     barrier.image = image;
     barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.levelCount = mipLevels;
     barrier.subresourceRange.baseArrayLayer = 0;
     barrier.subresourceRange.layerCount = 1;
     //barrier.srcAccessMask = 0;
@@ -169,7 +335,7 @@ void transitionImageLayout(Context& context, VkImage image, VkFormat format, VkI
     cmdBuf.endSingletimeCommands();
 }
 
-VkImageView makeImageView(Context& context, VkImage image, VkFormat format){
+VkImageView makeImageView(Context& context, VkImage image, VkFormat format, uint32_t mipLevels){
     VkImageViewCreateInfo viewInfo{};
     viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
     viewInfo.image = image;
@@ -177,8 +343,8 @@ VkImageView makeImageView(Context& context, VkImage image, VkFormat format){
     viewInfo.format = format;
 
     viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    viewInfo.subresourceRange.baseMipLevel = 0; // TODO: mips & levels
-    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = mipLevels;
     viewInfo.subresourceRange.baseArrayLayer = 0;
     viewInfo.subresourceRange.layerCount = 1;
 
@@ -190,4 +356,104 @@ VkImageView makeImageView(Context& context, VkImage image, VkFormat format){
     return imageView;
 }
 
+bool formatSupportsLinearBlit(Context& context, VkFormat format){
+    VkFormatProperties props;
+    vkGetPhysicalDeviceFormatProperties(context.physicalDevice, format, &props);
+
+    VkFormatFeatureFlags required = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+        VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    return (props.optimalTilingFeatures & required) == required;
+}
+
+VkDeviceSize createImage(Context& context, uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format,
+    VkImageUsageFlags usage, VkImage& image, VkDeviceMemory& memory){
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent.width = width;
+    imageInfo.extent.height = height;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = mipLevels;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = format;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    /*VK_IMAGE_TILING_LINEAR: Texels are laid out in row-major order like our pixels array
+    VK_IMAGE_TILING_OPTIMAL: Texels are laid out in an implementation defined order for optimal access*/
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    /*VK_IMAGE_LAYOUT_UNDEFINED: Not usable by the GPU and the very first transition will discard the texels.
+    VK_IMAGE_LAYOUT_PREINITIALIZED: Not usable by the GPU, but the first transition will preserve the texels.*/
+    imageInfo.usage = usage;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT; // TODO: multisampling
+    
+    if(vkCreateImage(context.logicalDevice, &imageInfo, nullptr, &image) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create image!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(context.logicalDevice, image, &memRequirements);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(context.physicalDevice, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if(vkAllocateMemory(context.logicalDevice, &allocInfo, nullptr, &memory) != VK_SUCCESS){
+        vkDestroyImage(context.logicalDevice, image, nullptr);
+        throw std::runtime_error("Failed to allocate image memory!");
+    }
+
+    vkBindImageMemory(context.logicalDevice, image, memory, 0);
+    return memRequirements.size;
+}
+
+uint32_t formatTexelBytes(VkFormat format){
+    switch(format){
+        case VK_FORMAT_R8_UNORM:
+        case VK_FORMAT_R8_SRGB:
+            return 1;
+        case VK_FORMAT_R8G8_UNORM:
+        case VK_FORMAT_R8G8_SRGB:
+        case VK_FORMAT_R16_SFLOAT:
+        case VK_FORMAT_R16_UNORM:
+            return 2;
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+        case VK_FORMAT_B8G8R8A8_UNORM:
+        case VK_FORMAT_B8G8R8A8_SRGB:
+        case VK_FORMAT_R16G16_SFLOAT:
+        case VK_FORMAT_R32_SFLOAT:
+            return 4;
+        case VK_FORMAT_R16G16B16A16_SFLOAT:
+        case VK_FORMAT_R16G16B16A16_UNORM:
+        case VK_FORMAT_R32G32_SFLOAT:
+            return 8;
+        case VK_FORMAT_R32G32B32A32_SFLOAT:
+            return 16;
+        default:
+            return 0;
+    }
+}
+
+void recordImageBarrier(VkCommandBuffer commandBuffer, VkImage image, uint32_t baseMipLevel, uint32_t levelCount,
+    VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccess, VkAccessFlags dstAccess,
+    VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage){
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = baseMipLevel;
+    barrier.subresourceRange.levelCount = levelCount;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = dstAccess;
+
+    vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
 }
\ No newline at end of file
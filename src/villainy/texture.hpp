@@ -6,6 +6,9 @@
 
 #include <string>
 #include <stdexcept>
+#include <cstdint>
+#include <memory>
+#include <vector>
 
 #include <stb/stb_image.h>
 
@@ -21,45 +24,120 @@ struct SamplerConfig{
     bool anisotropy = true;
     bool compareEnable = false; // color comparison, used for shadow maps usually
     VkCompareOp compareOp = VK_COMPARE_OP_ALWAYS;
+    // mipmapping
+    VkSamplerMipmapMode mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR; // linear = trilinear filtering
+    float mipLodBias = 0.0f;
+    float minLod = 0.0f;
+    float maxLod = VK_LOD_CLAMP_NONE; // use every level the image view has
 };  
 
+struct TextureConfig{
+    VkFormat format = VK_FORMAT_R8G8B8A8_SRGB; // ignored for .ktx2/.dds, use VK_FORMAT_R8G8B8A8_UNORM for non-color data (normal maps etc)
+    bool generateMipmaps = true;
+    uint32_t maxMipLevels = 0; // 0 = full chain down to 1x1
+    bool forceCpuMipmaps = false; // skip the vkCmdBlitImage path even when the format supports it
+};
+
+// cpu side of a texture, everything the gpu upload needs
+struct TextureSource{
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t mipLevels = 1;
+    bool gpuMipmaps = false; // `data` only holds level 0, the rest is blitted after the copy
+
+    std::vector<uint8_t> data;
+    std::vector<VkBufferImageCopy> regions; // one per level stored in `data`
+};
+
+// decodes/reads the file and builds the cpu mips, only touches the physical device's format caps so any thread can call it
+TextureSource loadTextureSource(Context& context, const std::string& path, const TextureConfig& config);
+void createStagingBuffer(Context& context, const TextureSource& source, VkBuffer& buffer, VkDeviceMemory& memory);
+
 class Sampler{
 public:
     Sampler(SamplerConfig config, Context& context);
+    ~Sampler();
+
+    Sampler(const Sampler&) = delete;
+    Sampler& operator=(const Sampler&) = delete;
 private:
     SamplerConfig config;
     Context& context;
 
-    VkSampler vkSampler;
+    VkSampler vkSampler = VK_NULL_HANDLE;
 
     void init();
 
     friend class DescriptorManager;
+    friend class BindlessTable;
 };
 
 class Texture{
 public:
-    Texture(Context& context, std::string imagepath);
+    // .ktx2/.dds files (BC1/BC3/BC4/BC5/BC7) are uploaded as-is with their own mips, anything else goes through stb
+    Texture(Context& context, std::string imagepath, TextureConfig config = {});
     ~Texture();
     void cleanup();
+
+    uint32_t getMipLevels() const { return mipLevels; }
+    // device memory backing the image, 0 while a streamed texture isn't resident yet
+    VkDeviceSize getMemorySize() const { return memorySize; }
+    // false while a TextureLoader handle still points at the placeholder
+    bool isResident() const { return resident; }
+    // bumped every time imageView changes, descriptors written with an older generation are stale
+    uint32_t getGeneration() const { return generation; }
 private:
+    // uploads an already decoded image (placeholders, generated data)
+    Texture(Context& context, const TextureSource& source);
+    // blank single level image cleared to zero, contents are written later (DynamicTexture)
+    Texture(Context& context, uint32_t width, uint32_t height, VkFormat format);
+    // pending handle, shares the placeholder's view until the loader calls makeResident()
+    Texture(Context& context, std::string imagepath, TextureConfig config, std::shared_ptr<Texture> placeholder);
+
     bool cleaned = false;
     Context& context;
+    TextureConfig config;
+
+    std::string imagepath;
+    int texWidth = 0, texHeight = 0;
+    uint32_t mipLevels = 1;
+    VkFormat format = VK_FORMAT_UNDEFINED;
 
-    const char* imagepath;
-    int texWidth, texHeight, texChannels;
+    bool resident = true;
+    uint32_t generation = 0;
+    std::shared_ptr<Texture> placeholder; // keeps the borrowed view alive while not resident
 
-    VkImage image;
-    VkImageView imageView;
-    VkDeviceMemory imageMemory;
+    VkImage image = VK_NULL_HANDLE;
+    VkImageView imageView = VK_NULL_HANDLE;
+    VkDeviceMemory imageMemory = VK_NULL_HANDLE;
+    VkDeviceSize memorySize = 0;
 
     void init();
+    void upload(const TextureSource& source);
+    void createImage(const TextureSource& source);
+    void recordUpload(VkCommandBuffer commandBuffer, const TextureSource& source, VkBuffer stagingBuffer);
+    void recordMipmapBlits(VkCommandBuffer commandBuffer);
+    void makeResident();
 
     friend class DescriptorManager;
+    friend class TextureLoader;
+    friend class DynamicTexture;
+    friend class TextureStreamer;
+    friend class BindlessTable;
 };
 
-void transitionImageLayout(Context& context, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
-VkImageView makeImageView(Context& context, VkImage image, VkFormat format);
+void transitionImageLayout(Context& context, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels = 1);
+VkImageView makeImageView(Context& context, VkImage image, VkFormat format, uint32_t mipLevels = 1);
+// optimal tiled, device local 2D image with its own allocation, returns the allocation size
+VkDeviceSize createImage(Context& context, uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format,
+    VkImageUsageFlags usage, VkImage& image, VkDeviceMemory& memory);
+bool formatSupportsLinearBlit(Context& context, VkFormat format);
+// bytes per texel of common uncompressed color formats, 0 for anything else
+uint32_t formatTexelBytes(VkFormat format);
+void recordImageBarrier(VkCommandBuffer commandBuffer, VkImage image, uint32_t baseMipLevel, uint32_t levelCount,
+    VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccess, VkAccessFlags dstAccess,
+    VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage);
 
 }
 
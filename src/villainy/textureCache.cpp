@@ -0,0 +1,148 @@
+#include "textureCache.hpp"
+
+#include "context.hpp"
+
+namespace vlny{
+
+bool operator==(const SamplerConfig& a, const SamplerConfig& b){
+    return a.filter == b.filter && a.addressModeU == b.addressModeU && a.addressModeV == b.addressModeV &&
+        a.addressModeW == b.addressModeW && a.anisotropy == b.anisotropy && a.compareEnable == b.compareEnable &&
+        a.compareOp == b.compareOp && a.mipmapMode == b.mipmapMode && a.mipLodBias == b.mipLodBias &&
+        a.minLod == b.minLod && a.maxLod == b.maxLod;
+}
+
+size_t hashSamplerConfig(const SamplerConfig& config){
+    size_t seed = 0;
+    hashCombine(seed, config.filter);
+    hashCombine(seed, config.addressModeU);
+    hashCombine(seed, config.addressModeV);
+    hashCombine(seed, config.addressModeW);
+    hashCombine(seed, config.anisotropy);
+    hashCombine(seed, config.compareEnable);
+    hashCombine(seed, config.compareOp);
+    hashCombine(seed, config.mipmapMode);
+    hashCombine(seed, config.mipLodBias);
+    hashCombine(seed, config.minLod);
+    hashCombine(seed, config.maxLod);
+    return seed;
+}
+
+std::string textureCacheKey(const std::string& path, const TextureConfig& config){
+    return path + "|" + std::to_string(config.format) + "|" + std::to_string(config.generateMipmaps) + "|" +
+        std::to_string(config.maxMipLevels) + "|" + std::to_string(config.forceCpuMipmaps);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+TextureCache::TextureCache(Context& context, VkDeviceSize budget) : context(context), budget(budget) {}
+
+std::shared_ptr<Texture> TextureCache::load(const std::string& path, const TextureConfig& config){
+    std::string key = textureCacheKey(path, config);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(key);
+        if(it != entries.end()){
+            lru.splice(lru.begin(), lru, it->second.lruPos);
+            return it->second.texture;
+        }
+    }
+
+    // decode + upload without holding the lock, the upload goes through the transient command pool and graphics queue,
+    // so like any other upload this has to run on the thread that owns them (TextureLoader covers background loads)
+    auto texture = std::make_shared<Texture>(context, path, config);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(key);
+    if(it != entries.end()){
+        // someone else loaded the same key while we were busy, keep theirs
+        lru.splice(lru.begin(), lru, it->second.lruPos);
+        return it->second.texture;
+    }
+
+    lru.push_front(key);
+    Entry entry{texture, texture->getMemorySize(), lru.begin()};
+    usage += entry.size;
+    entries.emplace(key, std::move(entry));
+    VILLAINY_VERBOSE_LOG(context.logger, "Cached texture " + path + " (" + std::to_string(usage) + " bytes cached).");
+
+    trimLocked();
+    return texture;
+}
+
+void TextureCache::setBudget(VkDeviceSize newBudget){
+    std::lock_guard<std::mutex> lock(mutex);
+    budget = newBudget;
+    trimLocked();
+}
+
+void TextureCache::trim(){
+    std::lock_guard<std::mutex> lock(mutex);
+    trimLocked();
+}
+
+void TextureCache::clear(){
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    lru.clear();
+    usage = 0;
+}
+
+VkDeviceSize TextureCache::getMemoryUsage() const{
+    std::lock_guard<std::mutex> lock(mutex);
+    return usage;
+}
+
+size_t TextureCache::size() const{
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+void TextureCache::trimLocked(){
+    // oldest first, skip anything that still has handles outside the cache
+    auto it = lru.end();
+    while(usage > budget && it != lru.begin()){
+        --it;
+        auto entry = entries.find(*it);
+        if(entry->second.texture.use_count() > 1){
+            continue;
+        }
+        usage -= entry->second.size;
+        VILLAINY_VERBOSE_LOG(context.logger, "Evicted texture " + *it + " from the cache.");
+        entries.erase(entry);
+        it = lru.erase(it);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------------------------------
+
+SamplerCache::SamplerCache(Context& context) : context(context) {}
+
+std::shared_ptr<Sampler> SamplerCache::get(const SamplerConfig& config){
+    size_t hash = hashSamplerConfig(config);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& bucket = samplers[hash];
+    for(auto& [cfg, sampler] : bucket){
+        if(cfg == config){
+            return sampler;
+        }
+    }
+
+    auto sampler = std::make_shared<Sampler>(config, context);
+    bucket.emplace_back(config, sampler);
+    count++;
+    return sampler;
+}
+
+void SamplerCache::clear(){
+    std::lock_guard<std::mutex> lock(mutex);
+    samplers.clear();
+    count = 0;
+}
+
+size_t SamplerCache::size() const{
+    std::lock_guard<std::mutex> lock(mutex);
+    return count;
+}
+
+}
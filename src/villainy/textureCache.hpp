@@ -0,0 +1,88 @@
+#ifndef VILLAINY_TEXTURE_CACHE
+#define VILLAINY_TEXTURE_CACHE
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "texture.hpp"
+
+namespace vlny{
+
+class Context;
+
+bool operator==(const SamplerConfig& a, const SamplerConfig& b);
+size_t hashSamplerConfig(const SamplerConfig& config);
+// path + every load parameter, two loads with the same key share one image
+std::string textureCacheKey(const std::string& path, const TextureConfig& config);
+
+// de-duplicates textures by path and load parameters, handles are plain shared_ptrs so the refcount is the use count
+// once the cached images go over `budget` bytes the least recently requested ones nobody else holds are dropped,
+// referenced textures are never evicted (freeing the cache's reference wouldn't free any memory anyway)
+// load() uploads through the shared command pool and queue, call it on the main thread only
+class TextureCache{
+public:
+    TextureCache(Context& context, VkDeviceSize budget);
+
+    TextureCache(const TextureCache&) = delete;
+    TextureCache& operator=(const TextureCache&) = delete;
+
+    std::shared_ptr<Texture> load(const std::string& path, const TextureConfig& config = {});
+
+    void setBudget(VkDeviceSize newBudget);
+    // evicts unreferenced entries (least recently used first) until usage fits the budget
+    void trim();
+    // forgets every entry, textures still held elsewhere stay alive until their last handle goes
+    void clear();
+
+    VkDeviceSize getMemoryUsage() const;
+    size_t size() const;
+private:
+    Context& context;
+    VkDeviceSize budget;
+    VkDeviceSize usage = 0;
+
+    struct Entry{
+        std::shared_ptr<Texture> texture;
+        VkDeviceSize size;
+        std::list<std::string>::iterator lruPos;
+    };
+    std::unordered_map<std::string, Entry> entries;
+    std::list<std::string> lru; // front = most recently requested
+
+    mutable std::mutex mutex;
+
+    void trimLocked();
+};
+
+// one VkSampler per distinct SamplerConfig, samplers are tiny so they live until clear()
+class SamplerCache{
+public:
+    SamplerCache(Context& context);
+
+    SamplerCache(const SamplerCache&) = delete;
+    SamplerCache& operator=(const SamplerCache&) = delete;
+
+    std::shared_ptr<Sampler> get(const SamplerConfig& config = {});
+    void clear();
+
+    size_t size() const;
+private:
+    Context& context;
+
+    // hash -> configs that landed in it, compared on lookup so collisions can't alias two samplers
+    std::unordered_map<size_t, std::vector<std::pair<SamplerConfig, std::shared_ptr<Sampler>>>> samplers;
+    size_t count = 0;
+
+    mutable std::mutex mutex;
+};
+
+}
+
+#endif
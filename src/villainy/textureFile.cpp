@@ -0,0 +1,402 @@
+#include "textureFile.hpp"
+#include "mipmap.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace vlny{
+
+namespace{
+
+const uint8_t ktx2Identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+constexpr uint32_t fourCC(char a, char b, char c, char d){
+    return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) | (static_cast<uint32_t>(c) << 16) | (static_cast<uint32_t>(d) << 24);
+}
+
+std::vector<uint8_t> readBinaryFile(const std::string& path){
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+    if(!file.is_open()){
+        throw std::runtime_error("Failed to open texture file " + path);
+    }
+    size_t size = static_cast<size_t>(file.tellg());
+    std::vector<uint8_t> bytes(size);
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(bytes.data()), size);
+    return bytes;
+}
+
+void writeBinaryFile(const std::string& path, const std::vector<uint8_t>& bytes){
+    std::ofstream file(path, std::ios::binary);
+    if(!file.is_open()){
+        throw std::runtime_error("Failed to open " + path + " for writing");
+    }
+    file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+template<typename T>
+T readLE(const std::vector<uint8_t>& bytes, size_t offset){
+    if(offset + sizeof(T) > bytes.size()){
+        throw std::runtime_error("Texture file is truncated!");
+    }
+    T value = 0;
+    for(size_t i = 0; i < sizeof(T); i++){
+        value |= static_cast<T>(bytes[offset + i]) << (8 * i);
+    }
+    return value;
+}
+
+template<typename T>
+void appendLE(std::vector<uint8_t>& bytes, T value){
+    for(size_t i = 0; i < sizeof(T); i++){
+        bytes.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+// the header is trusted for nothing that sizes an allocation
+void checkLevels(const std::string& path, const TextureFileData& tex){
+    if(tex.width == 0 || tex.height == 0){
+        throw std::runtime_error(path + ": texture has no size!");
+    }
+    if(tex.mipLevels > computeMipLevels(tex.width, tex.height)){
+        throw std::runtime_error(path + ": more mip levels than the base size has!");
+    }
+}
+
+// fills offsets/sizes for a chain stored largest level first
+void layoutLevels(TextureFileData& tex){
+    tex.levelOffsets.resize(tex.mipLevels);
+    tex.levelSizes.resize(tex.mipLevels);
+    size_t offset = 0;
+    for(uint32_t i = 0; i < tex.mipLevels; i++){
+        tex.levelOffsets[i] = offset;
+        tex.levelSizes[i] = compressedLevelSize(tex.format, std::max(1u, tex.width >> i), std::max(1u, tex.height >> i));
+        offset += tex.levelSizes[i];
+    }
+    tex.data.resize(offset);
+}
+
+VkFormat dxgiToVkFormat(uint32_t dxgi){
+    switch(dxgi){
+        case 71: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+        case 72: return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+        case 77: return VK_FORMAT_BC3_UNORM_BLOCK;
+        case 78: return VK_FORMAT_BC3_SRGB_BLOCK;
+        case 80: return VK_FORMAT_BC4_UNORM_BLOCK;
+        case 81: return VK_FORMAT_BC4_SNORM_BLOCK;
+        case 83: return VK_FORMAT_BC5_UNORM_BLOCK;
+        case 84: return VK_FORMAT_BC5_SNORM_BLOCK;
+        case 98: return VK_FORMAT_BC7_UNORM_BLOCK;
+        case 99: return VK_FORMAT_BC7_SRGB_BLOCK;
+        default: return VK_FORMAT_UNDEFINED;
+    }
+}
+
+uint32_t vkFormatToDxgi(VkFormat format){
+    switch(format){
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK: return 71;
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK: return 72;
+        case VK_FORMAT_BC3_UNORM_BLOCK: return 77;
+        case VK_FORMAT_BC3_SRGB_BLOCK: return 78;
+        case VK_FORMAT_BC4_UNORM_BLOCK: return 80;
+        case VK_FORMAT_BC4_SNORM_BLOCK: return 81;
+        case VK_FORMAT_BC5_UNORM_BLOCK: return 83;
+        case VK_FORMAT_BC5_SNORM_BLOCK: return 84;
+        case VK_FORMAT_BC7_UNORM_BLOCK: return 98;
+        case VK_FORMAT_BC7_SRGB_BLOCK: return 99;
+        default: return 0;
+    }
+}
+
+bool isSrgbFormat(VkFormat format){
+    return format == VK_FORMAT_BC1_RGB_SRGB_BLOCK || format == VK_FORMAT_BC1_RGBA_SRGB_BLOCK ||
+        format == VK_FORMAT_BC3_SRGB_BLOCK || format == VK_FORMAT_BC7_SRGB_BLOCK;
+}
+
+bool isSnormFormat(VkFormat format){
+    return format == VK_FORMAT_BC4_SNORM_BLOCK || format == VK_FORMAT_BC5_SNORM_BLOCK;
+}
+
+// khr data format descriptor (basic block) for the BCn formats, required by every ktx2 file
+std::vector<uint8_t> makeDfd(VkFormat format){
+    struct Sample{ uint32_t bitOffset, bitLength, channel; };
+    uint32_t colorModel = 0;
+    std::vector<Sample> samples;
+    switch(format){
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            colorModel = 128; samples = {{0, 64, 0}}; break;
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+            colorModel = 128; samples = {{0, 64, 1}}; break;
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+            colorModel = 130; samples = {{0, 64, 15}, {64, 64, 0}}; break;
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+        case VK_FORMAT_BC4_SNORM_BLOCK:
+            colorModel = 131; samples = {{0, 64, 0}}; break;
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+        case VK_FORMAT_BC5_SNORM_BLOCK:
+            colorModel = 132; samples = {{0, 64, 0}, {64, 64, 1}}; break;
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            colorModel = 134; samples = {{0, 128, 0}}; break;
+        default:
+            throw std::runtime_error("No data format descriptor for this format!");
+    }
+
+    uint32_t blockSize = 24 + 16 * static_cast<uint32_t>(samples.size());
+    std::vector<uint8_t> dfd;
+    appendLE<uint32_t>(dfd, 4 + blockSize); // dfdTotalSize
+    appendLE<uint32_t>(dfd, 0); // vendorId = khronos, descriptorType = basic
+    appendLE<uint32_t>(dfd, 2 | (blockSize << 16)); // versionNumber | descriptorBlockSize
+    uint32_t transfer = isSrgbFormat(format) ? 2 : 1;
+    appendLE<uint32_t>(dfd, colorModel | (1 << 8) | (transfer << 16)); // model | bt709 primaries | transfer | flags
+    appendLE<uint32_t>(dfd, 3 | (3 << 8)); // 4x4x1x1 texel block
+    appendLE<uint32_t>(dfd, formatBlockBytes(format)); // bytesPlane0
+    appendLE<uint32_t>(dfd, 0);
+    bool snorm = isSnormFormat(format);
+    for(const auto& sample : samples){
+        uint32_t channelType = sample.channel | (snorm ? 0x40 : 0);
+        appendLE<uint32_t>(dfd, sample.bitOffset | ((sample.bitLength - 1) << 16) | (channelType << 24));
+        appendLE<uint32_t>(dfd, 0); // sample position
+        appendLE<uint32_t>(dfd, snorm ? 0x80000000u : 0u);
+        appendLE<uint32_t>(dfd, snorm ? 0x7FFFFFFFu : 0xFFFFFFFFu);
+    }
+    return dfd;
+}
+
+}
+
+uint32_t formatBlockBytes(VkFormat format){
+    switch(format){
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+        case VK_FORMAT_BC4_SNORM_BLOCK:
+            return 8;
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+        case VK_FORMAT_BC5_SNORM_BLOCK:
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            return 16;
+        default:
+            return 0;
+    }
+}
+
+size_t compressedLevelSize(VkFormat format, uint32_t width, uint32_t height){
+    size_t blocksX = (std::max(1u, width) + 3) / 4;
+    size_t blocksY = (std::max(1u, height) + 3) / 4;
+    return blocksX * blocksY * formatBlockBytes(format);
+}
+
+bool isTextureContainerFile(const std::string& path){
+    std::string lower = path;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c){ return static_cast<char>(std::tolower(c)); });
+    auto endsWith = [&](const std::string& ext){
+        return lower.size() >= ext.size() && lower.compare(lower.size() - ext.size(), ext.size(), ext) == 0;
+    };
+    return endsWith(".ktx2") || endsWith(".dds");
+}
+
+TextureFileData loadTextureFile(const std::string& path){
+    std::string lower = path;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c){ return static_cast<char>(std::tolower(c)); });
+    if(lower.size() >= 5 && lower.compare(lower.size() - 5, 5, ".ktx2") == 0){
+        return loadKtx2(path);
+    }
+    return loadDds(path);
+}
+
+TextureFileData loadKtx2(const std::string& path){
+    std::vector<uint8_t> bytes = readBinaryFile(path);
+    if(bytes.size() < 80 || std::memcmp(bytes.data(), ktx2Identifier, sizeof(ktx2Identifier)) != 0){
+        throw std::runtime_error(path + " is not a KTX2 file!");
+    }
+
+    TextureFileData tex;
+    tex.format = static_cast<VkFormat>(readLE<uint32_t>(bytes, 12));
+    tex.width = readLE<uint32_t>(bytes, 20);
+    tex.height = readLE<uint32_t>(bytes, 24);
+    uint32_t depth = readLE<uint32_t>(bytes, 28);
+    uint32_t layerCount = readLE<uint32_t>(bytes, 32);
+    uint32_t faceCount = readLE<uint32_t>(bytes, 36);
+    uint32_t levelCount = readLE<uint32_t>(bytes, 40);
+    uint32_t supercompression = readLE<uint32_t>(bytes, 44);
+
+    if(supercompression != 0){
+        throw std::runtime_error(path + ": supercompressed KTX2 (basis/zstd) is not supported!");
+    }
+    if(formatBlockBytes(tex.format) == 0){
+        throw std::runtime_error(path + ": unsupported KTX2 format, expected BC1/BC3/BC4/BC5/BC7!");
+    }
+    if(depth > 1 || layerCount > 1 || faceCount != 1){
+        throw std::runtime_error(path + ": only single 2D images are supported!");
+    }
+
+    tex.mipLevels = std::max(1u, levelCount);
+    checkLevels(path, tex);
+    layoutLevels(tex);
+
+    // level index follows the 80 byte header, one {offset, length, uncompressedLength} per level, level 0 first
+    for(uint32_t i = 0; i < tex.mipLevels; i++){
+        size_t entry = 80 + 24 * static_cast<size_t>(i);
+        uint64_t offset = readLE<uint64_t>(bytes, entry);
+        uint64_t length = readLE<uint64_t>(bytes, entry + 8);
+        if(length != tex.levelSizes[i] || offset + length > bytes.size()){
+            throw std::runtime_error(path + ": corrupt KTX2 level index!");
+        }
+        std::memcpy(tex.data.data() + tex.levelOffsets[i], bytes.data() + offset, static_cast<size_t>(length));
+    }
+
+    return tex;
+}
+
+TextureFileData loadDds(const std::string& path){
+    std::vector<uint8_t> bytes = readBinaryFile(path);
+    if(bytes.size() < 128 || readLE<uint32_t>(bytes, 0) != fourCC('D', 'D', 'S', ' ')){
+        throw std::runtime_error(path + " is not a DDS file!");
+    }
+
+    // offsets are relative to the start of the file (4 byte magic + 124 byte header)
+    TextureFileData tex;
+    tex.height = readLE<uint32_t>(bytes, 12);
+    tex.width = readLE<uint32_t>(bytes, 16);
+    tex.mipLevels = std::max(1u, readLE<uint32_t>(bytes, 28));
+    uint32_t pfFourCC = readLE<uint32_t>(bytes, 84);
+    size_t dataOffset = 128;
+
+    switch(pfFourCC){
+        case fourCC('D', 'X', 'T', '1'): tex.format = VK_FORMAT_BC1_RGBA_UNORM_BLOCK; break;
+        case fourCC('D', 'X', 'T', '5'): tex.format = VK_FORMAT_BC3_UNORM_BLOCK; break;
+        case fourCC('A', 'T', 'I', '1'):
+        case fourCC('B', 'C', '4', 'U'): tex.format = VK_FORMAT_BC4_UNORM_BLOCK; break;
+        case fourCC('B', 'C', '4', 'S'): tex.format = VK_FORMAT_BC4_SNORM_BLOCK; break;
+        case fourCC('A', 'T', 'I', '2'):
+        case fourCC('B', 'C', '5', 'U'): tex.format = VK_FORMAT_BC5_UNORM_BLOCK; break;
+        case fourCC('B', 'C', '5', 'S'): tex.format = VK_FORMAT_BC5_SNORM_BLOCK; break;
+        case fourCC('D', 'X', '1', '0'):{
+            tex.format = dxgiToVkFormat(readLE<uint32_t>(bytes, 128));
+            uint32_t arraySize = readLE<uint32_t>(bytes, 140);
+            if(arraySize > 1){
+                throw std::runtime_error(path + ": DDS texture arrays are not supported!");
+            }
+            dataOffset += 20;
+            break;
+        }
+        default: break;
+    }
+
+    if(formatBlockBytes(tex.format) == 0){
+        throw std::runtime_error(path + ": unsupported DDS format, expected BC1/BC3/BC4/BC5/BC7!");
+    }
+
+    checkLevels(path, tex);
+    layoutLevels(tex);
+    if(dataOffset + tex.data.size() > bytes.size()){
+        throw std::runtime_error(path + ": DDS file is truncated!");
+    }
+    std::memcpy(tex.data.data(), bytes.data() + dataOffset, tex.data.size());
+
+    return tex;
+}
+
+void writeKtx2(const std::string& path, const TextureFileData& tex){
+    std::vector<uint8_t> dfd = makeDfd(tex.format);
+    size_t blockBytes = formatBlockBytes(tex.format);
+
+    size_t levelIndexOffset = 80;
+    size_t dfdOffset = levelIndexOffset + 24 * static_cast<size_t>(tex.mipLevels);
+    size_t dataStart = dfdOffset + dfd.size();
+
+    // levels are stored smallest first, each aligned to the block size
+    std::vector<uint64_t> fileOffsets(tex.mipLevels);
+    size_t cursor = dataStart;
+    for(uint32_t i = tex.mipLevels; i-- > 0;){
+        cursor = (cursor + blockBytes - 1) / blockBytes * blockBytes;
+        fileOffsets[i] = cursor;
+        cursor += tex.levelSizes[i];
+    }
+
+    std::vector<uint8_t> bytes(ktx2Identifier, ktx2Identifier + sizeof(ktx2Identifier));
+    appendLE<uint32_t>(bytes, static_cast<uint32_t>(tex.format));
+    appendLE<uint32_t>(bytes, 1); // typeSize
+    appendLE<uint32_t>(bytes, tex.width);
+    appendLE<uint32_t>(bytes, tex.height);
+    appendLE<uint32_t>(bytes, 0); // pixelDepth
+    appendLE<uint32_t>(bytes, 0); // layerCount
+    appendLE<uint32_t>(bytes, 1); // faceCount
+    appendLE<uint32_t>(bytes, tex.mipLevels);
+    appendLE<uint32_t>(bytes, 0); // supercompressionScheme
+    appendLE<uint32_t>(bytes, static_cast<uint32_t>(dfdOffset));
+    appendLE<uint32_t>(bytes, static_cast<uint32_t>(dfd.size()));
+    appendLE<uint32_t>(bytes, 0); // no key/value data
+    appendLE<uint32_t>(bytes, 0);
+    appendLE<uint64_t>(bytes, 0); // no supercompression global data
+    appendLE<uint64_t>(bytes, 0);
+
+    for(uint32_t i = 0; i < tex.mipLevels; i++){
+        appendLE<uint64_t>(bytes, fileOffsets[i]);
+        appendLE<uint64_t>(bytes, tex.levelSizes[i]);
+        appendLE<uint64_t>(bytes, tex.levelSizes[i]);
+    }
+    bytes.insert(bytes.end(), dfd.begin(), dfd.end());
+
+    bytes.resize(cursor, 0);
+    for(uint32_t i = 0; i < tex.mipLevels; i++){
+        std::memcpy(bytes.data() + fileOffsets[i], tex.data.data() + tex.levelOffsets[i], tex.levelSizes[i]);
+    }
+
+    writeBinaryFile(path, bytes);
+}
+
+void writeDds(const std::string& path, const TextureFileData& tex){
+    uint32_t dxgi = vkFormatToDxgi(tex.format);
+    if(dxgi == 0){
+        throw std::runtime_error("Format can't be written to DDS!");
+    }
+
+    std::vector<uint8_t> bytes;
+    appendLE<uint32_t>(bytes, fourCC('D', 'D', 'S', ' '));
+    appendLE<uint32_t>(bytes, 124); // header size
+    appendLE<uint32_t>(bytes, 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000); // caps | height | width | pixelformat | mipcount | linearsize
+    appendLE<uint32_t>(bytes, tex.height);
+    appendLE<uint32_t>(bytes, tex.width);
+    appendLE<uint32_t>(bytes, static_cast<uint32_t>(tex.levelSizes[0]));
+    appendLE<uint32_t>(bytes, 0); // depth
+    appendLE<uint32_t>(bytes, tex.mipLevels);
+    for(int i = 0; i < 11; i++){ appendLE<uint32_t>(bytes, 0); }
+    // pixel format: fourcc only, the real format lives in the DX10 header
+    appendLE<uint32_t>(bytes, 32);
+    appendLE<uint32_t>(bytes, 0x4);
+    appendLE<uint32_t>(bytes, fourCC('D', 'X', '1', '0'));
+    for(int i = 0; i < 5; i++){ appendLE<uint32_t>(bytes, 0); }
+    uint32_t caps = 0x1000;
+    if(tex.mipLevels > 1){
+        caps |= 0x8 | 0x400000; // complex | mipmap
+    }
+    appendLE<uint32_t>(bytes, caps);
+    for(int i = 0; i < 4; i++){ appendLE<uint32_t>(bytes, 0); }
+
+    // DX10 header
+    appendLE<uint32_t>(bytes, dxgi);
+    appendLE<uint32_t>(bytes, 3); // texture 2D
+    appendLE<uint32_t>(bytes, 0);
+    appendLE<uint32_t>(bytes, 1); // array size
+    appendLE<uint32_t>(bytes, 0);
+
+    bytes.insert(bytes.end(), tex.data.begin(), tex.data.end());
+    writeBinaryFile(path, bytes);
+}
+
+}
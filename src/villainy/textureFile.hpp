@@ -0,0 +1,40 @@
+#ifndef VILLAINY_TEXTURE_FILE
+#define VILLAINY_TEXTURE_FILE
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vlny{
+
+// block compressed image + pre-baked mips as stored in a .ktx2 or .dds container
+struct TextureFileData{
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t mipLevels = 0;
+
+    std::vector<uint8_t> data; // every level tightly packed, largest first
+    std::vector<size_t> levelOffsets;
+    std::vector<size_t> levelSizes;
+};
+
+// true for .ktx2 / .dds paths (case insensitive)
+bool isTextureContainerFile(const std::string& path);
+
+TextureFileData loadTextureFile(const std::string& path);
+TextureFileData loadKtx2(const std::string& path);
+TextureFileData loadDds(const std::string& path);
+
+void writeKtx2(const std::string& path, const TextureFileData& texture);
+void writeDds(const std::string& path, const TextureFileData& texture);
+
+// BC1/BC3/BC4/BC5/BC7, 0 for anything else
+uint32_t formatBlockBytes(VkFormat format);
+size_t compressedLevelSize(VkFormat format, uint32_t width, uint32_t height);
+
+}
+
+#endif
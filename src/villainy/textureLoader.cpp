@@ -0,0 +1,107 @@
+#include "textureLoader.hpp"
+
+#include "context.hpp"
+
+#include <chrono>
+
+namespace vlny{
+
+TextureLoader::TextureLoader(Context& context, uint32_t threadCount) : context(context), pool(threadCount), uploads(context) {
+    TextureSource grey;
+    grey.format = VK_FORMAT_R8G8B8A8_UNORM;
+    grey.width = 1;
+    grey.height = 1;
+    grey.data = {128, 128, 128, 255};
+
+    VkBufferImageCopy region{};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = {1, 1, 1};
+    grey.regions.push_back(region);
+
+    placeholder = std::shared_ptr<Texture>(new Texture(context, grey));
+}
+
+TextureLoader::~TextureLoader(){
+    // futures still reference the pool, drain them before it goes away
+    pool.waitIdle();
+    decoding.clear();
+    uploads.flush();
+}
+
+std::shared_ptr<Texture> TextureLoader::load(const std::string& path, TextureConfig config){
+    std::shared_ptr<Texture> texture(new Texture(context, path, config, placeholder));
+
+    Context* ctx = &context;
+    Request request;
+    request.texture = texture;
+    request.source = pool.submit([ctx, path, config](){
+        return loadTextureSource(*ctx, path, config);
+    });
+    decoding.push_back(std::move(request));
+    return texture;
+}
+
+void TextureLoader::update(){
+    uploads.poll();
+
+    VkDeviceSize uploaded = 0;
+    for(size_t i = 0; i < decoding.size();){
+        Request& request = decoding[i];
+        if(request.source.wait_for(std::chrono::seconds(0)) != std::future_status::ready){
+            i++;
+            continue;
+        }
+
+        TextureSource source;
+        try{
+            source = request.source.get();
+        }
+        catch(const std::exception& e){
+            // keeps sampling the placeholder forever
+            context.logger.log(ERROR, std::string("Streaming texture failed: ") + e.what());
+            decoding.erase(decoding.begin() + i);
+            continue;
+        }
+
+        if(uploaded > 0 && uploaded + source.data.size() > maxUploadBytesPerUpdate){
+            // put the decoded data back for the next update, the first one always goes through however large it is
+            std::promise<TextureSource> promise;
+            promise.set_value(std::move(source));
+            request.source = promise.get_future();
+            break;
+        }
+        uploaded += source.data.size();
+
+        std::shared_ptr<Texture> texture = std::move(request.texture);
+        decoding.erase(decoding.begin() + i);
+        startUpload(std::move(texture), std::move(source));
+    }
+}
+
+void TextureLoader::waitAll(){
+    while(!decoding.empty()){
+        pool.waitIdle();
+        update();
+    }
+    uploads.flush();
+}
+
+void TextureLoader::startUpload(std::shared_ptr<Texture> texture, TextureSource source){
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    createStagingBuffer(context, source, stagingBuffer, stagingBufferMemory);
+
+    texture->createImage(source);
+
+    VkDevice device = context.logicalDevice;
+    uploads.submit([&](VkCommandBuffer commandBuffer){
+        texture->recordUpload(commandBuffer, source, stagingBuffer);
+    }, [texture, device, stagingBuffer, stagingBufferMemory](){
+        vkDestroyBuffer(device, stagingBuffer, nullptr);
+        vkFreeMemory(device, stagingBufferMemory, nullptr);
+        texture->makeResident();
+    });
+}
+
+}
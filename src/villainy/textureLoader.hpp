@@ -0,0 +1,67 @@
+#ifndef VILLAINY_TEXTURE_LOADER
+#define VILLAINY_TEXTURE_LOADER
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "command.hpp"
+#include "texture.hpp"
+#include "threadPool.hpp"
+#include "uploadQueue.hpp"
+
+namespace vlny{
+
+class Context;
+
+// streams textures in the background: decode + cpu mips on worker threads, staging copy + transfer through an UploadQueue
+// load() hands back a usable texture right away that samples a 1x1 placeholder until the real image is resident,
+// DescriptorManager notices the generation change and rewrites its descriptors (see DescriptorManager::refreshTextures)
+//
+// everything except the decoding happens in update(), which has to run on the thread that submits frames,
+// registering the loader with Renderer::addFrameResource does that automatically
+class TextureLoader : public FrameResource{
+public:
+    TextureLoader(Context& context, uint32_t threadCount = 0);
+    ~TextureLoader();
+
+    TextureLoader(const TextureLoader&) = delete;
+    TextureLoader& operator=(const TextureLoader&) = delete;
+
+    std::shared_ptr<Texture> load(const std::string& path, TextureConfig config = {});
+
+    // starts uploads for decoded images and swaps in the ones the gpu has finished with, never blocks
+    void update();
+    // blocks until every texture requested so far is resident (or failed)
+    void waitAll();
+
+    size_t pendingCount() const { return decoding.size() + uploads.inFlight(); }
+    std::shared_ptr<Texture> getPlaceholder() const { return placeholder; }
+
+    void prepareFrame(uint32_t) override { update(); }
+private:
+    Context& context;
+    ThreadPool pool;
+    UploadQueue uploads;
+
+    std::shared_ptr<Texture> placeholder;
+
+    struct Request{
+        std::shared_ptr<Texture> texture;
+        std::future<TextureSource> source;
+    };
+    std::vector<Request> decoding;
+
+    // staging caps per update() so a burst of finished decodes doesn't turn into one giant frame hitch
+    static constexpr size_t maxUploadBytesPerUpdate = 64ull * 1024 * 1024;
+
+    void startUpload(std::shared_ptr<Texture> texture, TextureSource source);
+};
+
+}
+
+#endif
@@ -0,0 +1,322 @@
+#include "textureStreamer.hpp"
+
+#include "context.hpp"
+#include "buffer.hpp"
+#include "textureFile.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace vlny{
+
+TextureStreamer::TextureStreamer(Context& context, Window& window, TextureStreamerConfig config) :
+    context(context), maxFramesInFlight(window.getConfig().maxFramesInFlight), config(config),
+    decodePool(std::max(1u, config.decodeThreads)), uploads(context) {}
+
+TextureStreamer::~TextureStreamer(){
+    decodePool.waitIdle();
+    uploads.flush();
+    context.waitIdle();
+    destroyRetired(true);
+}
+
+void TextureStreamer::track(std::shared_ptr<Texture> texture){
+    if(!texture->isResident()){
+        throw std::invalid_argument("Only resident textures can be streamed!");
+    }
+    if(texture->imagepath.empty() || texture->imagepath.front() == '<'){
+        throw std::invalid_argument("Streamed textures need a file to re-read their levels from!");
+    }
+    if(texture->mipLevels < 2){
+        VILLAINY_VERBOSE_LOG(context.logger, texture->imagepath + " has a single mip level, nothing to stream.");
+        return;
+    }
+
+    Tracked t;
+    t.texture = texture;
+    t.fullWidth = scast_ui32(texture->texWidth);
+    t.fullHeight = scast_ui32(texture->texHeight);
+    t.fullLevels = texture->mipLevels;
+    t.tailBase = 0;
+    while(t.tailBase + 1 < t.fullLevels && std::max(t.fullWidth >> t.tailBase, t.fullHeight >> t.tailBase) > config.tailSize){
+        t.tailBase++;
+    }
+    t.residentBase = 0;
+    t.wantedBase = 0;
+    t.lastRequestFrame = frameIndex;
+    tracked.emplace(texture.get(), std::move(t));
+}
+
+void TextureStreamer::untrack(const std::shared_ptr<Texture>& texture){
+    // an in-flight rebuild still swaps the texture's image when it lands, it just isn't followed anymore
+    tracked.erase(texture.get());
+}
+
+void TextureStreamer::requestScreenSize(const std::shared_ptr<Texture>& texture, float screenPixels){
+    auto it = tracked.find(texture.get());
+    if(it == tracked.end()){
+        return;
+    }
+    const Tracked& t = it->second;
+    // one mip level per halving of texels per pixel
+    float ratio = static_cast<float>(std::max(t.fullWidth, t.fullHeight)) / std::max(screenPixels, 1.0f);
+    float lod = std::log2(ratio) + config.lodBias;
+    requestMipLevel(texture, lod <= 0.0f ? 0 : static_cast<uint32_t>(std::floor(lod)));
+}
+
+void TextureStreamer::requestMipLevel(const std::shared_ptr<Texture>& texture, uint32_t level){
+    auto it = tracked.find(texture.get());
+    if(it == tracked.end()){
+        return;
+    }
+    Tracked& t = it->second;
+    t.requestedBase = std::min(t.requestedBase, std::min(level, t.tailBase));
+    t.lastRequestFrame = frameIndex;
+}
+
+void TextureStreamer::update(){
+    frameIndex++;
+    uploads.poll();
+    destroyRetired(false);
+
+    // finer levels that finished decoding
+    for(auto& [key, t] : tracked){
+        if(!t.source.valid() || t.source.wait_for(std::chrono::seconds(0)) != std::future_status::ready){
+            continue;
+        }
+        try{
+            TextureSource source = t.source.get();
+            if(source.mipLevels != t.fullLevels || source.regions.size() != t.fullLevels){
+                throw std::runtime_error("file changed since it was loaded");
+            }
+            rebuild(t, t.pendingBase, &source);
+        }
+        catch(const std::exception& e){
+            context.logger.log(ERROR, "Streaming mips of " + t.texture->imagepath + " failed: " + e.what());
+            t.busy = false;
+        }
+    }
+
+    std::vector<std::pair<Tracked*, uint32_t>> targets;
+    chooseTargets(targets);
+
+    uint32_t started = 0;
+    for(auto& [t, base] : targets){
+        if(started >= config.maxRebuildsPerFrame){
+            break;
+        }
+        if(t->busy || base == t->residentBase){
+            continue;
+        }
+        started++;
+
+        if(base > t->residentBase){
+            // dropping levels, everything needed is already on the gpu
+            rebuild(*t, base, nullptr);
+            continue;
+        }
+
+        // forceCpuMipmaps so every level comes back in the source, not just the base
+        TextureConfig cfg = t->texture->config;
+        cfg.forceCpuMipmaps = true;
+        std::string path = t->texture->imagepath;
+        Context* ctx = &context;
+        t->busy = true;
+        t->pendingBase = base;
+        t->source = decodePool.submit([ctx, path, cfg](){
+            return loadTextureSource(*ctx, path, cfg);
+        });
+    }
+}
+
+VkDeviceSize TextureStreamer::getResidentBytes() const{
+    VkDeviceSize total = 0;
+    for(const auto& [key, t] : tracked){
+        total += t.texture->memorySize;
+    }
+    return total;
+}
+
+uint32_t TextureStreamer::getResidentBaseLevel(const std::shared_ptr<Texture>& texture) const{
+    auto it = tracked.find(texture.get());
+    return it == tracked.end() ? 0 : it->second.residentBase;
+}
+
+VkDeviceSize TextureStreamer::levelRangeBytes(const Tracked& t, uint32_t baseLevel) const{
+    VkFormat format = t.texture->format;
+    uint32_t texelBytes = std::max(1u, formatTexelBytes(format));
+    VkDeviceSize total = 0;
+    for(uint32_t l = baseLevel; l < t.fullLevels; l++){
+        uint32_t w = std::max(1u, t.fullWidth >> l);
+        uint32_t h = std::max(1u, t.fullHeight >> l);
+        total += formatBlockBytes(format) ? compressedLevelSize(format, w, h) : static_cast<VkDeviceSize>(w) * h * texelBytes;
+    }
+    return total;
+}
+
+void TextureStreamer::chooseTargets(std::vector<std::pair<Tracked*, uint32_t>>& targets){
+    targets.clear();
+    VkDeviceSize total = 0;
+    for(auto& [key, t] : tracked){
+        if(t.requestedBase != UINT32_MAX){
+            t.wantedBase = t.requestedBase;
+            t.requestedBase = UINT32_MAX;
+        }
+        else if(frameIndex - t.lastRequestFrame > config.idleFrames){
+            t.wantedBase = t.tailBase;
+        }
+        // finer levels only get dropped under budget pressure, keeps textures from thrashing as the camera moves
+        uint32_t base = std::min(t.wantedBase, t.residentBase);
+        targets.emplace_back(&t, base);
+        total += levelRangeBytes(t, base);
+    }
+
+    // least recently requested first
+    std::sort(targets.begin(), targets.end(), [](const auto& a, const auto& b){
+        return a.first->lastRequestFrame < b.first->lastRequestFrame;
+    });
+
+    // first drop the surplus levels nobody asked for, then eat into what was asked for, coarsest first
+    for(auto& [t, base] : targets){
+        if(total <= config.budget){
+            break;
+        }
+        if(base < t->wantedBase){
+            total -= levelRangeBytes(*t, base) - levelRangeBytes(*t, t->wantedBase);
+            base = t->wantedBase;
+        }
+    }
+    bool progress = true;
+    while(total > config.budget && progress){
+        progress = false;
+        for(auto& [t, base] : targets){
+            if(total <= config.budget){
+                break;
+            }
+            if(base < t->tailBase){
+                total -= levelRangeBytes(*t, base) - levelRangeBytes(*t, base + 1);
+                base++;
+                progress = true;
+            }
+        }
+    }
+    if(total > config.budget){
+        VILLAINY_VERBOSE_LOG(context.logger, "Texture streaming budget exceeded by the mip tails alone.");
+    }
+
+    // most recently requested get their rebuilds started first
+    std::reverse(targets.begin(), targets.end());
+}
+
+void TextureStreamer::rebuild(Tracked& t, uint32_t newBase, const TextureSource* source){
+    Texture& tex = *t.texture;
+    uint32_t oldBase = t.residentBase;
+    uint32_t newLevels = t.fullLevels - newBase;
+    uint32_t newWidth = std::max(1u, t.fullWidth >> newBase);
+    uint32_t newHeight = std::max(1u, t.fullHeight >> newBase);
+
+    VkImage newImage;
+    VkDeviceMemory newMemory;
+    VkDeviceSize newSize = createImage(context, newWidth, newHeight, newLevels, tex.format,
+        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, newImage, newMemory);
+
+    // levels finer than what's resident come from the decoded file, only that byte range gets staged
+    VkBuffer stagingBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory stagingMemory = VK_NULL_HANDLE;
+    std::vector<VkBufferImageCopy> uploadRegions;
+    if(source && newBase < oldBase){
+        VkDeviceSize begin = source->regions[newBase].bufferOffset;
+        VkDeviceSize end = source->regions[oldBase].bufferOffset;
+        createBuffer(context, end - begin, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingMemory);
+
+        void* data;
+        vkMapMemory(context.logicalDevice, stagingMemory, 0, end - begin, 0, &data);
+        memcpy(data, source->data.data() + begin, static_cast<size_t>(end - begin));
+        vkUnmapMemory(context.logicalDevice, stagingMemory);
+
+        for(uint32_t l = newBase; l < oldBase; l++){
+            VkBufferImageCopy region = source->regions[l];
+            region.bufferOffset -= begin;
+            region.imageSubresource.mipLevel = l - newBase;
+            uploadRegions.push_back(region);
+        }
+    }
+
+    // levels both images have, the tail is never dropped so there's always at least one
+    uint32_t firstShared = std::max(newBase, oldBase);
+    uint32_t sharedCount = t.fullLevels - firstShared;
+    std::vector<VkImageCopy> copies;
+    for(uint32_t l = firstShared; l < t.fullLevels; l++){
+        VkImageCopy copy{};
+        copy.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, l - oldBase, 0, 1};
+        copy.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, l - newBase, 0, 1};
+        copy.extent = {std::max(1u, t.fullWidth >> l), std::max(1u, t.fullHeight >> l), 1};
+        copies.push_back(copy);
+    }
+
+    VkImage oldImage = tex.image;
+    uploads.submit([&](VkCommandBuffer commandBuffer){
+        recordImageBarrier(commandBuffer, newImage, 0, newLevels, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+        // frames in flight keep sampling the old image, so it goes back to shader read right after the copy
+        recordImageBarrier(commandBuffer, oldImage, firstShared - oldBase, sharedCount, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+        vkCmdCopyImage(commandBuffer, oldImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, newImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            scast_ui32(copies.size()), copies.data());
+        recordImageBarrier(commandBuffer, oldImage, firstShared - oldBase, sharedCount, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+        if(!uploadRegions.empty()){
+            vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, newImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                scast_ui32(uploadRegions.size()), uploadRegions.data());
+        }
+
+        recordImageBarrier(commandBuffer, newImage, 0, newLevels, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+    }, [this, texture = t.texture, newImage, newMemory, newSize, newLevels, newWidth, newHeight, newBase, stagingBuffer, stagingMemory](){
+        if(stagingBuffer != VK_NULL_HANDLE){
+            vkDestroyBuffer(context.logicalDevice, stagingBuffer, nullptr);
+            vkFreeMemory(context.logicalDevice, stagingMemory, nullptr);
+        }
+
+        retired.push_back({texture->image, texture->imageView, texture->imageMemory, frameIndex});
+        texture->image = newImage;
+        texture->imageMemory = newMemory;
+        texture->memorySize = newSize;
+        texture->mipLevels = newLevels;
+        texture->texWidth = static_cast<int>(newWidth);
+        texture->texHeight = static_cast<int>(newHeight);
+        texture->imageView = makeImageView(context, newImage, texture->format, newLevels);
+        texture->generation++;
+
+        auto it = tracked.find(texture.get());
+        if(it != tracked.end()){
+            it->second.residentBase = newBase;
+            it->second.busy = false;
+        }
+    });
+    t.busy = true;
+
+    VILLAINY_VERBOSE_LOG(context.logger, "Streaming " + tex.imagepath + " from mip " + std::to_string(oldBase) + " to mip " + std::to_string(newBase) + ".");
+}
+
+void TextureStreamer::destroyRetired(bool all){
+    // every frame slot has waited on its fence and rewritten its descriptors since these were swapped out
+    auto stale = [&](const Retired& r){ return all || frameIndex - r.frame > maxFramesInFlight; };
+    for(const Retired& r : retired){
+        if(stale(r)){
+            vkDestroyImageView(context.logicalDevice, r.view, nullptr);
+            vkDestroyImage(context.logicalDevice, r.image, nullptr);
+            vkFreeMemory(context.logicalDevice, r.memory, nullptr);
+        }
+    }
+    retired.erase(std::remove_if(retired.begin(), retired.end(), stale), retired.end());
+}
+
+}
@@ -0,0 +1,105 @@
+#ifndef VILLAINY_TEXTURE_STREAMER
+#define VILLAINY_TEXTURE_STREAMER
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "command.hpp"
+#include "texture.hpp"
+#include "threadPool.hpp"
+#include "uploadQueue.hpp"
+#include "window.hpp"
+
+namespace vlny{
+
+class Context;
+
+struct TextureStreamerConfig{
+    VkDeviceSize budget = 256ull * 1024 * 1024; // bytes of mip levels resident across every tracked texture
+    uint32_t tailSize = 64; // levels this size (longest side) and smaller are never dropped
+    uint32_t idleFrames = 120; // no requests for this long and a texture falls back to its tail
+    uint32_t maxRebuildsPerFrame = 2;
+    float lodBias = 0.0f; // > 0 keeps coarser mips than the screen size asks for
+    uint32_t decodeThreads = 1; // finer levels are re-read from the texture's file on these
+};
+
+// keeps only the mips each texture actually needs resident
+// every frame, report how large each texture shows up on screen (or the level a feedback pass asked for), the streamer
+// then rebuilds images with fewer or more levels: levels both images share are copied on the gpu, newly needed finer
+// ones are re-decoded from the file on a worker and uploaded, all through an UploadQueue so nothing stalls the frame
+//
+// a rebuilt texture gets a new image + view and a bumped generation, DescriptorManager picks the new view up on its own
+// old images are destroyed once every frame in flight is past them
+// register with Renderer::addFrameResource ahead of the descriptor managers
+class TextureStreamer : public FrameResource{
+public:
+    TextureStreamer(Context& context, Window& window, TextureStreamerConfig config = {});
+    ~TextureStreamer();
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // texture has to be resident, come from a file and have more than one mip level
+    void track(std::shared_ptr<Texture> texture);
+    void untrack(const std::shared_ptr<Texture>& texture);
+
+    // longest on-screen extent in pixels of something drawn with the texture this frame
+    void requestScreenSize(const std::shared_ptr<Texture>& texture, float screenPixels);
+    // finest level the texture needs this frame (e.g. read back from a sampler feedback pass)
+    void requestMipLevel(const std::shared_ptr<Texture>& texture, uint32_t level);
+
+    // retires finished rebuilds and starts new ones, runs from prepareFrame when registered
+    void update();
+    void prepareFrame(uint32_t) override { update(); }
+
+    void setBudget(VkDeviceSize budget) { config.budget = budget; }
+    VkDeviceSize getResidentBytes() const;
+    // first resident level of the full chain (0 = full resolution)
+    uint32_t getResidentBaseLevel(const std::shared_ptr<Texture>& texture) const;
+private:
+    Context& context;
+    uint32_t maxFramesInFlight;
+    TextureStreamerConfig config;
+
+    ThreadPool decodePool;
+    UploadQueue uploads;
+
+    struct Tracked{
+        std::shared_ptr<Texture> texture;
+        uint32_t fullWidth, fullHeight, fullLevels;
+        uint32_t tailBase; // coarsest base level it may fall back to
+        uint32_t residentBase;
+        uint32_t wantedBase; // from the latest requests
+        uint32_t requestedBase = UINT32_MAX; // finest requested since the last update
+        uint64_t lastRequestFrame = 0;
+        bool busy = false;
+        std::future<TextureSource> source; // valid while finer levels are being decoded
+        uint32_t pendingBase = 0;
+    };
+    std::unordered_map<Texture*, Tracked> tracked;
+
+    struct Retired{
+        VkImage image;
+        VkImageView view;
+        VkDeviceMemory memory;
+        uint64_t frame;
+    };
+    std::vector<Retired> retired;
+
+    uint64_t frameIndex = 0;
+
+    VkDeviceSize levelRangeBytes(const Tracked& t, uint32_t baseLevel) const;
+    void chooseTargets(std::vector<std::pair<Tracked*, uint32_t>>& targets);
+    void rebuild(Tracked& t, uint32_t newBase, const TextureSource* source);
+    void destroyRetired(bool all);
+};
+
+}
+
+#endif
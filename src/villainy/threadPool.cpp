@@ -0,0 +1,59 @@
+#include "threadPool.hpp"
+
+#include <algorithm>
+
+namespace vlny{
+
+ThreadPool::ThreadPool(uint32_t threadCount){
+    if(threadCount == 0){
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    workers.reserve(threadCount);
+    for(uint32_t i = 0; i < threadCount; i++){
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool(){
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    taskAvailable.notify_all();
+    for(auto& worker : workers){
+        worker.join();
+    }
+}
+
+void ThreadPool::waitIdle(){
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this](){ return tasks.empty() && active == 0; });
+}
+
+void ThreadPool::workerLoop(){
+    while(true){
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            taskAvailable.wait(lock, [this](){ return stopping || !tasks.empty(); });
+            if(tasks.empty()){
+                return; // stopping and drained
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+            active++;
+        }
+
+        task(); // packaged_task catches, nothing escapes here
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            active--;
+            if(tasks.empty() && active == 0){
+                idle.notify_all();
+            }
+        }
+    }
+}
+
+}
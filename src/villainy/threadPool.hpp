@@ -0,0 +1,51 @@
+#ifndef VILLAINY_THREAD_POOL
+#define VILLAINY_THREAD_POOL
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace vlny{
+
+// fixed set of worker threads pulling from one fifo queue
+// anything submitted here must not touch the vulkan queues or command pools, those stay on the thread that owns them
+class ThreadPool{
+public:
+    explicit ThreadPool(uint32_t threadCount = 0); // 0 = hardware concurrency
+    ~ThreadPool(); // finishes whatever is still queued
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // exceptions thrown by the task come out of the future's get()
+    template<typename F>
+    std::future<std::invoke_result_t<std::decay_t<F>>> submit(F&& task);
+
+    // blocks until the queue is empty and no worker is busy
+    void waitIdle();
+    uint32_t size() const { return static_cast<uint32_t>(workers.size()); }
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+
+    std::mutex mutex;
+    std::condition_variable taskAvailable;
+    std::condition_variable idle;
+    uint32_t active = 0;
+    bool stopping = false;
+
+    void workerLoop();
+};
+
+}
+
+#include "threadPool.ipp"
+
+#endif
@@ -0,0 +1,20 @@
+#include "threadPool.hpp"
+
+namespace vlny{
+
+template<typename F>
+std::future<std::invoke_result_t<std::decay_t<F>>> ThreadPool::submit(F&& task){
+    using Result = std::invoke_result_t<std::decay_t<F>>;
+
+    // std::function needs something copyable, packaged_task isn't
+    auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+    std::future<Result> result = packaged->get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.emplace_back([packaged](){ (*packaged)(); });
+    }
+    taskAvailable.notify_one();
+    return result;
+}
+
+}
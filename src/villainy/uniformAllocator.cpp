@@ -0,0 +1,88 @@
+#include "uniformAllocator.hpp"
+
+#include "context.hpp"
+#include "buffer.hpp"
+
+#include <algorithm>
+
+namespace vlny{
+
+UniformAllocator::UniformAllocator(Context& context, Window& window, UniformAllocatorConfig config) :
+    context(context), config(config), maxFramesInFlight(window.getConfig().maxFramesInFlight) {
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(context.physicalDevice, &properties);
+    alignment = std::max<VkDeviceSize>(1, properties.limits.minUniformBufferOffsetAlignment);
+    this->config.range = std::min<VkDeviceSize>(config.range, properties.limits.maxUniformBufferRange);
+
+    // frame regions start aligned, and the last allocation of the last frame still has `range` bytes behind it
+    frameStride = (config.bytesPerFrame + alignment - 1) / alignment * alignment;
+    VkDeviceSize bufferSize = frameStride * maxFramesInFlight + this->config.range;
+    createBuffer(context, bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer, memory);
+    void* data;
+    vkMapMemory(context.logicalDevice, memory, 0, bufferSize, 0, &data);
+    mapped = static_cast<uint8_t*>(data);
+    heads.assign(maxFramesInFlight, 0);
+
+    VkDescriptorSetLayoutBinding binding{};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    binding.descriptorCount = 1;
+    binding.stageFlags = config.stageFlags;
+    layout = context.getDescriptorSetLayout({binding});
+    descriptorSet = context.getDescriptorAllocator().allocate(layout);
+
+    // one descriptor for every frame, the dynamic offset picks the frame region and the allocation
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = buffer;
+    bufferInfo.offset = 0;
+    bufferInfo.range = this->config.range;
+
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = descriptorSet;
+    write.dstBinding = 0;
+    write.dstArrayElement = 0;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    write.descriptorCount = 1;
+    write.pBufferInfo = &bufferInfo;
+    vkUpdateDescriptorSets(context.logicalDevice, 1, &write, 0, nullptr);
+}
+
+UniformAllocator::~UniformAllocator(){
+    // after vlny::cleanup the allocator's pools are gone and the set went with them
+    if(descriptorSet != VK_NULL_HANDLE && context.descriptorAllocator.has_value()){
+        context.getDescriptorAllocator().free(descriptorSet);
+    }
+    if(mapped != nullptr){
+        vkUnmapMemory(context.logicalDevice, memory);
+    }
+    if(buffer != VK_NULL_HANDLE){
+        vkDestroyBuffer(context.logicalDevice, buffer, nullptr);
+    }
+    if(memory != VK_NULL_HANDLE){
+        vkFreeMemory(context.logicalDevice, memory, nullptr);
+    }
+}
+
+UniformAllocation UniformAllocator::allocate(uint32_t frame, VkDeviceSize size){
+    if(size > config.range){
+        throw std::runtime_error("Uniform allocation is larger than the allocator's range!");
+    }
+    VkDeviceSize offset = (heads[frame] + alignment - 1) / alignment * alignment;
+    if(offset + size > config.bytesPerFrame){
+        throw std::runtime_error("Uniform allocator ran out of space for this frame!");
+    }
+    heads[frame] = offset + size;
+
+    VkDeviceSize absolute = frameStride * frame + offset;
+    return {mapped + absolute, static_cast<uint32_t>(absolute)};
+}
+
+uint32_t UniformAllocator::push(uint32_t frame, const void* data, VkDeviceSize size){
+    UniformAllocation allocation = allocate(frame, size);
+    std::memcpy(allocation.data, data, static_cast<size_t>(size));
+    return allocation.offset;
+}
+
+}
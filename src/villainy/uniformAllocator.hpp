@@ -0,0 +1,77 @@
+#ifndef VILLAINY_UNIFORM_ALLOCATOR
+#define VILLAINY_UNIFORM_ALLOCATOR
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "command.hpp"
+#include "window.hpp"
+
+namespace vlny{
+
+class Context;
+
+struct UniformAllocatorConfig{
+    VkDeviceSize bytesPerFrame = 4ull * 1024 * 1024;
+    VkDeviceSize range = 1024; // largest single allocation, the size the dynamic descriptor covers
+    VkShaderStageFlags stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+};
+
+struct UniformAllocation{
+    void* data = nullptr;
+    uint32_t offset = 0; // dynamic offset to bind with
+};
+
+// per-frame bump allocator over one persistently mapped uniform buffer
+// every frame in flight owns a `bytesPerFrame` region that is rewound in prepareFrame, allocations are aligned to
+// minUniformBufferOffsetAlignment and addressed through one UNIFORM_BUFFER_DYNAMIC descriptor (binding 0 of getLayout())
+// so per-draw data costs a memcpy and a dynamic offset instead of its own buffer and sets
+//
+// register with Renderer::addFrameResource before anything that allocates, then only allocate for a frame between its
+// prepareFrame and the end of its recording (RenderObject::setDynamicUniform does that from draw())
+class UniformAllocator : public FrameResource{
+public:
+    UniformAllocator(Context& context, Window& window, UniformAllocatorConfig config = {});
+    ~UniformAllocator();
+
+    UniformAllocator(const UniformAllocator&) = delete;
+    UniformAllocator& operator=(const UniformAllocator&) = delete;
+
+    UniformAllocation allocate(uint32_t frame, VkDeviceSize size);
+    // copies `data` in and returns the dynamic offset
+    uint32_t push(uint32_t frame, const void* data, VkDeviceSize size);
+    template <typename T>
+    uint32_t push(uint32_t frame, const T& data) { return push(frame, &data, sizeof(T)); }
+
+    void prepareFrame(uint32_t frame) override { heads[frame] = 0; }
+
+    VkDescriptorSetLayout getLayout() const { return layout; }
+    VkDescriptorSet getDescriptorSet() const { return descriptorSet; }
+    // for DescriptorManager::addExternalBuffer(..., VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, getBuffer(), getRange())
+    VkBuffer getBuffer() const { return buffer; }
+    VkDeviceSize getRange() const { return config.range; }
+    VkDeviceSize getUsed(uint32_t frame) const { return heads[frame]; }
+private:
+    Context& context;
+    UniformAllocatorConfig config;
+    uint32_t maxFramesInFlight;
+    VkDeviceSize alignment = 1;
+    VkDeviceSize frameStride = 0;
+
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    uint8_t* mapped = nullptr;
+
+    VkDescriptorSetLayout layout = VK_NULL_HANDLE; // owned by the context's DescriptorLayoutCache
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+
+    std::vector<VkDeviceSize> heads;
+};
+
+}
+
+#endif
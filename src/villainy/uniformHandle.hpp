@@ -0,0 +1,99 @@
+#ifndef VILLAINY_UNIFORM_HANDLE
+#define VILLAINY_UNIFORM_HANDLE
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace vlny{
+
+namespace std140{
+
+// base alignment of a C++ member type inside a std140 block, 0 when it has no matching GLSL layout
+// (bool, glm::vec3 arrays, matrices with fewer than 4 rows whose columns std140 pads to 16 bytes, ...)
+template <typename T, typename = void>
+struct Alignment{ static constexpr size_t value = 0; };
+
+template <> struct Alignment<float>{ static constexpr size_t value = 4; };
+template <> struct Alignment<int32_t>{ static constexpr size_t value = 4; };
+template <> struct Alignment<uint32_t>{ static constexpr size_t value = 4; };
+template <> struct Alignment<double>{ static constexpr size_t value = 8; };
+template <> struct Alignment<glm::vec2>{ static constexpr size_t value = 8; };
+template <> struct Alignment<glm::ivec2>{ static constexpr size_t value = 8; };
+template <> struct Alignment<glm::uvec2>{ static constexpr size_t value = 8; };
+template <> struct Alignment<glm::vec3>{ static constexpr size_t value = 16; };
+template <> struct Alignment<glm::ivec3>{ static constexpr size_t value = 16; };
+template <> struct Alignment<glm::uvec3>{ static constexpr size_t value = 16; };
+template <> struct Alignment<glm::vec4>{ static constexpr size_t value = 16; };
+template <> struct Alignment<glm::ivec4>{ static constexpr size_t value = 16; };
+template <> struct Alignment<glm::uvec4>{ static constexpr size_t value = 16; };
+template <> struct Alignment<glm::mat4>{ static constexpr size_t value = 16; };
+template <> struct Alignment<glm::mat2x4>{ static constexpr size_t value = 16; };
+template <> struct Alignment<glm::mat3x4>{ static constexpr size_t value = 16; };
+template <> struct Alignment<glm::mat2>{ static constexpr size_t value = 0; };
+template <> struct Alignment<glm::mat3>{ static constexpr size_t value = 0; };
+
+// array elements are padded to 16 bytes, so only element types that already are 16 byte multiples match
+template <typename T, size_t N>
+struct Alignment<T[N]>{
+    static constexpr size_t value = (Alignment<T>::value != 0 && sizeof(T) % 16 == 0) ? 16 : 0;
+};
+
+// glm types not listed above (mat4x3, mat4x2, dvec, ...) are classes too but must not pass as nested structs
+template <typename T>
+struct IsGlmType : std::false_type{};
+template <glm::length_t L, typename T, glm::qualifier Q>
+struct IsGlmType<glm::vec<L, T, Q>> : std::true_type{};
+template <glm::length_t C, glm::length_t R, typename T, glm::qualifier Q>
+struct IsGlmType<glm::mat<C, R, T, Q>> : std::true_type{};
+
+// nested structs are aligned to 16 and their size rounds up to 16
+template <typename T>
+struct Alignment<T, std::enable_if_t<std::is_class_v<T> && std::is_standard_layout_v<T> && !IsGlmType<T>::value>>{
+    static constexpr size_t value = sizeof(T) % 16 == 0 ? 16 : 0;
+};
+
+}
+
+template <typename T>
+inline constexpr size_t std140Alignment = std140::Alignment<T>::value;
+
+// checks one member of a uniform block against std140 at compile time, list every member after the struct:
+//   struct Camera { glm::mat4 viewProj; glm::vec3 position; float exposure; };
+//   VILLAINY_STD140_MEMBER(Camera, viewProj);
+//   VILLAINY_STD140_MEMBER(Camera, position);
+//   VILLAINY_STD140_MEMBER(Camera, exposure);
+#define VILLAINY_STD140_MEMBER(Type, member) \
+    static_assert(::vlny::std140Alignment<decltype(Type::member)> != 0, \
+        #Type "::" #member " has no std140 equivalent, use vec4/mat4 or pad it"); \
+    static_assert(offsetof(Type, member) % ::vlny::std140Alignment<decltype(Type::member)> == 0, \
+        #Type "::" #member " is not std140 aligned, add padding or alignas(16)")
+
+// typed view of a uniform buffer binding, one mapped pointer per frame in flight resolved once when the handle is made
+// writes are a plain copy into the frame's mapping, no lookups or size searches
+// get it from DescriptorManager::getUniformHandle<T>(binding) after build(), it stays valid as long as the manager
+template <typename T>
+class UniformHandle{
+    static_assert(std::is_trivially_copyable_v<T>, "Uniform blocks have to be trivially copyable!");
+    static_assert(std::is_standard_layout_v<T>, "Uniform blocks need a standard layout to match the shader!");
+    static_assert(alignof(T) <= 16, "Uniform blocks can't need more than 16 byte alignment!");
+public:
+    UniformHandle() = default;
+    explicit UniformHandle(std::vector<void*> mapped) : mapped(std::move(mapped)) {}
+
+    void write(uint32_t frame, const T& data) { std::memcpy(mapped[frame], &data, sizeof(T)); }
+    // in-place access to the frame's copy, only touch frames the gpu is done with
+    T& operator[](uint32_t frame) { return *static_cast<T*>(mapped[frame]); }
+
+    bool valid() const { return !mapped.empty(); }
+private:
+    std::vector<void*> mapped;
+};
+
+}
+
+#endif
@@ -0,0 +1,100 @@
+#include "uploadQueue.hpp"
+
+#include "context.hpp"
+
+namespace vlny{
+
+UploadQueue::UploadQueue(Context& context) : context(context), commandPool(context) {}
+
+UploadQueue::~UploadQueue(){
+    flush();
+    for(VkFence fence : freeFences){
+        vkDestroyFence(context.logicalDevice, fence, nullptr);
+    }
+}
+
+void UploadQueue::submit(const std::function<void(VkCommandBuffer)>& record, std::function<void()> onComplete){
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = commandPool.vkCommandPool;
+    allocInfo.commandBufferCount = 1;
+
+    Submission submission{};
+    if(vkAllocateCommandBuffers(context.logicalDevice, &allocInfo, &submission.commandBuffer) != VK_SUCCESS){
+        throw std::runtime_error("Failed to allocate upload command buffer!");
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(submission.commandBuffer, &beginInfo);
+
+    record(submission.commandBuffer);
+
+    vkEndCommandBuffer(submission.commandBuffer);
+
+    submission.fence = acquireFence();
+    submission.onComplete = std::move(onComplete);
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &submission.commandBuffer;
+
+    if(vkQueueSubmit(context.graphicsQueue, 1, &submitInfo, submission.fence) != VK_SUCCESS){
+        vkFreeCommandBuffers(context.logicalDevice, commandPool.vkCommandPool, 1, &submission.commandBuffer);
+        freeFences.push_back(submission.fence);
+        throw std::runtime_error("Failed to submit upload command buffer!");
+    }
+    submissions.push_back(std::move(submission));
+}
+
+void UploadQueue::poll(){
+    // same queue, so submissions finish in order, stop at the first one still running
+    while(!submissions.empty()){
+        if(vkGetFenceStatus(context.logicalDevice, submissions.front().fence) != VK_SUCCESS){
+            break;
+        }
+        Submission submission = std::move(submissions.front());
+        submissions.pop_front();
+        retire(submission);
+    }
+}
+
+void UploadQueue::flush(){
+    while(!submissions.empty()){
+        Submission submission = std::move(submissions.front());
+        submissions.pop_front();
+        vkWaitForFences(context.logicalDevice, 1, &submission.fence, VK_TRUE, UINT64_MAX);
+        retire(submission);
+    }
+}
+
+VkFence UploadQueue::acquireFence(){
+    if(!freeFences.empty()){
+        VkFence fence = freeFences.back();
+        freeFences.pop_back();
+        vkResetFences(context.logicalDevice, 1, &fence);
+        return fence;
+    }
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    VkFence fence;
+    if(vkCreateFence(context.logicalDevice, &fenceInfo, nullptr, &fence) != VK_SUCCESS){
+        throw std::runtime_error("Failed to create upload fence!");
+    }
+    return fence;
+}
+
+void UploadQueue::retire(Submission& submission){
+    vkFreeCommandBuffers(context.logicalDevice, commandPool.vkCommandPool, 1, &submission.commandBuffer);
+    freeFences.push_back(submission.fence);
+    if(submission.onComplete){
+        submission.onComplete();
+    }
+}
+
+}
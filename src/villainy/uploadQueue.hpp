@@ -0,0 +1,54 @@
+#ifndef VILLAINY_UPLOAD_QUEUE
+#define VILLAINY_UPLOAD_QUEUE
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include "command.hpp"
+
+namespace vlny{
+
+class Context;
+
+// fire and forget one-shot command buffers, each submit gets a fence instead of a vkQueueWaitIdle
+// owned and driven by one thread (the same one that submits frames), call poll() once a frame to retire finished work
+class UploadQueue{
+public:
+    UploadQueue(Context& context);
+    ~UploadQueue(); // waits for everything still in flight
+
+    UploadQueue(const UploadQueue&) = delete;
+    UploadQueue& operator=(const UploadQueue&) = delete;
+
+    // `record` fills the command buffer, `onComplete` runs from poll()/flush() once the gpu is done with it
+    void submit(const std::function<void(VkCommandBuffer)>& record, std::function<void()> onComplete = nullptr);
+
+    // retires every finished submission in order, never blocks
+    void poll();
+    // blocks until everything submitted so far is done, then retires it
+    void flush();
+
+    size_t inFlight() const { return submissions.size(); }
+private:
+    Context& context;
+    CommandPool commandPool;
+
+    struct Submission{
+        VkCommandBuffer commandBuffer;
+        VkFence fence;
+        std::function<void()> onComplete;
+    };
+    std::deque<Submission> submissions;
+    std::vector<VkFence> freeFences;
+
+    VkFence acquireFence();
+    void retire(Submission& submission);
+};
+
+}
+
+#endif
@@ -6,6 +6,17 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace vlny{
 
 std::vector<char> readFile(const std::string& filename){
@@ -25,6 +36,99 @@ std::vector<char> readFile(const std::string& filename){
     return buffer;
 }
 
+MappedFile::MappedFile(const std::string& filename){
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(file == INVALID_HANDLE_VALUE){
+        throw std::runtime_error("Failed to open file!");
+    }
+    LARGE_INTEGER fileSize;
+    if(!GetFileSizeEx(file, &fileSize)){
+        CloseHandle(file);
+        throw std::runtime_error("Failed to open file!");
+    }
+    length = static_cast<size_t>(fileSize.QuadPart);
+    if(length > 0){
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if(mapping != nullptr){
+            mapped = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        }
+    }
+    CloseHandle(file);
+    if(length > 0 && mapped == nullptr){
+        unmap();
+        throw std::runtime_error("Failed to map file!");
+    }
+#else
+    int fd = open(filename.c_str(), O_RDONLY);
+    if(fd < 0){
+        throw std::runtime_error("Failed to open file!");
+    }
+    struct stat info;
+    if(fstat(fd, &info) != 0){
+        close(fd);
+        throw std::runtime_error("Failed to open file!");
+    }
+    length = static_cast<size_t>(info.st_size);
+    if(length > 0){
+        void* view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(view == MAP_FAILED){
+            close(fd);
+            throw std::runtime_error("Failed to map file!");
+        }
+        mapped = static_cast<const char*>(view);
+    }
+    // the mapping holds its own reference to the file
+    close(fd);
+#endif
+}
+
+MappedFile::~MappedFile(){
+    unmap();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept : mapped(other.mapped), length(other.length) {
+    other.mapped = nullptr;
+    other.length = 0;
+#ifdef _WIN32
+    mapping = other.mapping;
+    other.mapping = nullptr;
+#endif
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept{
+    if(this != &other){
+        unmap();
+        mapped = other.mapped;
+        length = other.length;
+        other.mapped = nullptr;
+        other.length = 0;
+#ifdef _WIN32
+        mapping = other.mapping;
+        other.mapping = nullptr;
+#endif
+    }
+    return *this;
+}
+
+void MappedFile::unmap(){
+#ifdef _WIN32
+    if(mapped != nullptr){
+        UnmapViewOfFile(mapped);
+    }
+    if(mapping != nullptr){
+        CloseHandle(mapping);
+        mapping = nullptr;
+    }
+#else
+    if(mapped != nullptr){
+        munmap(const_cast<char*>(mapped), length);
+    }
+#endif
+    mapped = nullptr;
+    length = 0;
+}
+
 void saveToFile(std::string filename, std::string data){
     std::ofstream f(filename);
 
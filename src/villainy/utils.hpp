@@ -4,9 +4,11 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include <array>
 #include <iostream>
 #include <vector>
 #include <fstream>
+#include <functional>
 
 namespace vlny{
 
@@ -14,6 +16,29 @@ namespace vlny{
 
 std::vector<char> readFile(const std::string& filename);
 
+// read-only memory mapping of a whole file, the pages are shared with the OS file cache instead of copied out of it
+class MappedFile{
+public:
+    explicit MappedFile(const std::string& filename);
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return mapped; } // page aligned, nullptr for an empty file
+    size_t size() const { return length; }
+private:
+    const char* mapped = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void* mapping = nullptr; // the file mapping handle, the view keeps the file itself open
+#endif
+
+    void unmap();
+};
+
 void saveToFile(std::string filename, std::string data);
 
 // C++ utils
@@ -23,6 +48,33 @@ uint32_t scast_ui32(T in){
     return static_cast<uint32_t>(in);
 }
 
+// read-only view of contiguous elements, std::span<const T> for as long as we're on C++17
+template<typename T>
+class ArrayView{
+public:
+    ArrayView() = default;
+    ArrayView(const T* data, size_t size) : ptr(data), count(size) {}
+    ArrayView(const std::vector<T>& vector) : ptr(vector.data()), count(vector.size()) {}
+    template<size_t N>
+    ArrayView(const std::array<T, N>& array) : ptr(array.data()), count(N) {}
+
+    const T* data() const { return ptr; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const T* begin() const { return ptr; }
+    const T* end() const { return ptr + count; }
+    const T& operator[](size_t i) const { return ptr[i]; }
+private:
+    const T* ptr = nullptr;
+    size_t count = 0;
+};
+
+// boost style, for cache keys built from config structs
+template<typename T>
+void hashCombine(size_t& seed, const T& value){
+    seed ^= std::hash<T>{}(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
 // Vulkan utils
 VkImageView createImageView(VkImage image, VkFormat format);
 
@@ -17,6 +17,14 @@ void cleanup(Window* windows, int windowCount, Context& context){
         }
     }
 
+    // the caches own vulkan objects, release them while the device is still alive
+    context.textureCache.reset();
+    context.samplerCache.reset();
+    context.shaderModuleCache.reset();
+    context.descriptorBufferHeap.reset();
+    context.descriptorAllocator.reset();
+    context.descriptorLayoutCache.reset();
+
     if(context.transientCommandPool.has_value()){
         context.transientCommandPool.reset();
     }
@@ -45,6 +53,14 @@ void cleanup(Window& window, Context& context){
         window.swapchain.reset();
     }
 
+    // the caches own vulkan objects, release them while the device is still alive
+    context.textureCache.reset();
+    context.samplerCache.reset();
+    context.shaderModuleCache.reset();
+    context.descriptorBufferHeap.reset();
+    context.descriptorAllocator.reset();
+    context.descriptorLayoutCache.reset();
+
     if(context.transientCommandPool.has_value()){
         context.transientCommandPool.reset();
     }
@@ -0,0 +1,138 @@
+// offline texture compressor: png/jpg/tga/... -> BCn .dds/.ktx2 with a baked mip chain
+//
+// usage: villainy_texcompress <input> <output.dds|output.ktx2> [options]
+//   --format bc1|bc3|bc4|bc5|bc7   (default bc7)
+//   --linear                       store as UNORM instead of SRGB (normal maps, masks, ...)
+//   --no-mips                      only write the base level
+//   --threads N                    encoder threads (default: all cores)
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+
+#include "bcEncoder.hpp"
+#include "mipmap.hpp"
+#include "textureFile.hpp"
+
+namespace{
+
+struct Options{
+    std::string input;
+    std::string output;
+    vlny::BCFormat format = vlny::BCFormat::BC7;
+    bool srgb = true;
+    bool mips = true;
+    uint32_t threads = 0;
+};
+
+void printUsage(){
+    std::cerr << "usage: villainy_texcompress <input> <output.dds|output.ktx2> [--format bc1|bc3|bc4|bc5|bc7] [--linear] [--no-mips] [--threads N]" << std::endl;
+}
+
+Options parseArgs(int argc, char** argv){
+    if(argc < 3){
+        printUsage();
+        throw std::invalid_argument("Missing input/output path!");
+    }
+
+    Options opts;
+    opts.input = argv[1];
+    opts.output = argv[2];
+    for(int i = 3; i < argc; i++){
+        std::string arg = argv[i];
+        if(arg == "--format" && i + 1 < argc){
+            std::string f = argv[++i];
+            if(f == "bc1"){ opts.format = vlny::BCFormat::BC1; }
+            else if(f == "bc3"){ opts.format = vlny::BCFormat::BC3; }
+            else if(f == "bc4"){ opts.format = vlny::BCFormat::BC4; }
+            else if(f == "bc5"){ opts.format = vlny::BCFormat::BC5; }
+            else if(f == "bc7"){ opts.format = vlny::BCFormat::BC7; }
+            else{ throw std::invalid_argument("Unknown format " + f); }
+        }
+        else if(arg == "--linear"){ opts.srgb = false; }
+        else if(arg == "--no-mips"){ opts.mips = false; }
+        else if(arg == "--threads" && i + 1 < argc){ opts.threads = static_cast<uint32_t>(std::stoul(argv[++i])); }
+        else{
+            printUsage();
+            throw std::invalid_argument("Unknown argument " + arg);
+        }
+    }
+    return opts;
+}
+
+VkFormat toVkFormat(vlny::BCFormat format, bool srgb){
+    switch(format){
+        case vlny::BCFormat::BC1: return srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+        case vlny::BCFormat::BC3: return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+        case vlny::BCFormat::BC4: return VK_FORMAT_BC4_UNORM_BLOCK; // single/dual channel data is never srgb
+        case vlny::BCFormat::BC5: return VK_FORMAT_BC5_UNORM_BLOCK;
+        case vlny::BCFormat::BC7: return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+    }
+    return VK_FORMAT_UNDEFINED;
+}
+
+bool endsWith(const std::string& s, const std::string& ext){
+    return s.size() >= ext.size() && s.compare(s.size() - ext.size(), ext.size(), ext) == 0;
+}
+
+}
+
+int main(int argc, char** argv){
+    try{
+        Options opts = parseArgs(argc, argv);
+        auto start = std::chrono::high_resolution_clock::now();
+
+        int w, h, channels;
+        stbi_uc* pixels = stbi_load(opts.input.c_str(), &w, &h, &channels, STBI_rgb_alpha);
+        if(!pixels){
+            throw std::runtime_error("Failed to load image " + opts.input);
+        }
+        uint32_t width = static_cast<uint32_t>(w);
+        uint32_t height = static_cast<uint32_t>(h);
+
+        vlny::TextureFileData tex;
+        tex.format = toVkFormat(opts.format, opts.srgb);
+        tex.width = width;
+        tex.height = height;
+        tex.mipLevels = opts.mips ? vlny::computeMipLevels(width, height) : 1;
+
+        bool srgbFilter = opts.srgb && (opts.format == vlny::BCFormat::BC1 || opts.format == vlny::BCFormat::BC3 || opts.format == vlny::BCFormat::BC7);
+        std::vector<uint8_t> chain(vlny::mipChainSize(width, height, tex.mipLevels, 4));
+        std::copy(pixels, pixels + static_cast<size_t>(width) * height * 4, chain.begin());
+        stbi_image_free(pixels);
+        vlny::generateMipChainRGBA8(chain.data(), width, height, tex.mipLevels, srgbFilter);
+
+        for(uint32_t i = 0; i < tex.mipLevels; i++){
+            uint32_t lw = std::max(1u, width >> i);
+            uint32_t lh = std::max(1u, height >> i);
+            const uint8_t* level = chain.data() + vlny::mipLevelOffset(width, height, i, 4);
+
+            std::vector<uint8_t> blocks = vlny::compressImageBC(level, lw, lh, opts.format, opts.threads);
+            tex.levelOffsets.push_back(tex.data.size());
+            tex.levelSizes.push_back(blocks.size());
+            tex.data.insert(tex.data.end(), blocks.begin(), blocks.end());
+        }
+
+        if(endsWith(opts.output, ".ktx2")){
+            vlny::writeKtx2(opts.output, tex);
+        }
+        else{
+            vlny::writeDds(opts.output, tex);
+        }
+
+        float seconds = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+        std::cout << opts.input << " -> " << opts.output << " (" << width << "x" << height << ", " << tex.mipLevels
+            << " mips, " << tex.data.size() << " bytes) in " << seconds << "s" << std::endl;
+    }
+    catch(const std::exception& e){
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}